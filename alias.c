@@ -68,7 +68,8 @@ void
 initialize_aliases ()
 {
   if (aliases == 0)
-    aliases = hash_create (ALIAS_HASH_BUCKETS);
+    /* BASH_ALIASES lists this table in hash order; see assoc_create */
+    aliases = hash_create_flags (ALIAS_HASH_BUCKETS, HASH_FNVKEYS|HASH_CHAINORDER);
 }
 
 /* Scan the list of aliases looking for one with NAME.  Return NULL
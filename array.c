@@ -3,7 +3,9 @@
  *	     of strings.
  *
  * Arrays are sparse doubly-linked lists.  An element's index is stored
- * with it.
+ * with it.  While the indices are dense, an array also keeps a vector
+ * indexed by element index, so that references and assignments to
+ * a[i] don't have to search the list.
  *
  * Chet Ramey
  * chet@ins.cwru.edu
@@ -80,6 +82,124 @@ do { \
 	lastref = 0; \
 } while (0)
 
+/*
+ * An array keeps its vector only while at least one slot in ARRAY_SPREAD
+ * would be in use.  A slot takes less memory than a list element, so the
+ * vector costs at most a few words per element.  Indices below
+ * ARRAY_MIN_SLOTS always fit.
+ */
+#define ARRAY_MIN_SLOTS	16
+#define ARRAY_SPREAD	4
+
+#define ARRAY_DENSE(a, i) \
+	((i) >= 0 && ((i) < ARRAY_MIN_SLOTS || (i) < ARRAY_SPREAD * ((arrayind_t)(a)->num_elements + 1)))
+
+/*
+ * An array that went back to the list gets its vector again once the
+ * vector would be a third fuller than ARRAY_DENSE requires.  Without the
+ * difference, an array whose indices stay near the limit would rebuild
+ * its vector on every assignment.
+ */
+#define ARRAY_REDENSE(a) \
+	(array_max_index(a) < (ARRAY_SPREAD * (arrayind_t)(a)->num_elements * 3) / 4)
+
+static void array_free_vector __P((ARRAY *));
+static void array_grow_vector __P((ARRAY *, arrayind_t));
+static void array_shrink_vector __P((ARRAY *));
+static void array_index_elements __P((ARRAY *));
+static ARRAY_ELEMENT *array_vector_next __P((ARRAY *, arrayind_t));
+
+static void
+array_free_vector(a)
+ARRAY	*a;
+{
+	FREE(a->elements);
+	a->elements = (ARRAY_ELEMENT **)NULL;
+	a->alloc_size = 0;
+}
+
+/*
+ * Make the vector of array A big enough to hold index I.
+ */
+static void
+array_grow_vector(a, i)
+ARRAY	*a;
+arrayind_t	i;
+{
+	arrayind_t	n, size;
+
+	for (size = a->alloc_size ? a->alloc_size : ARRAY_MIN_SLOTS; size <= i; size <<= 1)
+		;
+	a->elements = (ARRAY_ELEMENT **)xrealloc(a->elements, size * sizeof(ARRAY_ELEMENT *));
+	for (n = a->alloc_size; n < size; n++)
+		a->elements[n] = (ARRAY_ELEMENT *)NULL;
+	a->alloc_size = size;
+}
+
+/*
+ * Called after an element of array A has been removed.  Give up the
+ * vector if the array has become too sparse for it, and make it smaller
+ * once its highest index uses less than a quarter of it.
+ */
+static void
+array_shrink_vector(a)
+ARRAY	*a;
+{
+	arrayind_t	size;
+
+	if (ARRAY_DENSE(a, array_max_index(a)) == 0) {
+		array_free_vector(a);
+		return;
+	}
+	if (a->alloc_size <= ARRAY_MIN_SLOTS || array_max_index(a) >= a->alloc_size / 4)
+		return;
+	for (size = a->alloc_size; size > ARRAY_MIN_SLOTS && array_max_index(a) < size / 2; size >>= 1)
+		;
+	a->elements = (ARRAY_ELEMENT **)xrealloc(a->elements, size * sizeof(ARRAY_ELEMENT *));
+	a->alloc_size = size;
+}
+
+/*
+ * Rebuild the vector of array A after elements have been renumbered or
+ * added to the list directly.  A sparse array gets no vector.
+ */
+static void
+array_index_elements(a)
+ARRAY	*a;
+{
+	register ARRAY_ELEMENT *ae;
+
+	array_free_vector(a);
+	if (array_empty(a) || element_index(element_forw(a->head)) < 0 ||
+	    ARRAY_DENSE(a, array_max_index(a)) == 0)
+		return;
+	array_grow_vector(a, array_max_index(a));
+	for (ae = element_forw(a->head); ae != a->head; ae = element_forw(ae))
+		a->elements[element_index(ae)] = ae;
+}
+
+/*
+ * Return the element that a new element with index I, whose slot in the
+ * vector is empty, goes before in the list.  Look outward from I for the
+ * nearest element, so that filling in a hole doesn't scan the whole vector.
+ */
+static ARRAY_ELEMENT *
+array_vector_next(a, i)
+ARRAY	*a;
+arrayind_t	i;
+{
+	arrayind_t	lo, hi;
+
+	if (i > array_max_index(a))
+		return (a->head);
+	for (lo = i - 1, hi = i + 1; ; lo--, hi++) {
+		if (hi <= array_max_index(a) && a->elements[hi])
+			return (a->elements[hi]);
+		if (lo >= 0 && a->elements[lo])
+			return (element_forw(a->elements[lo]));
+	}
+}
+
 ARRAY *
 array_create()
 {
@@ -93,6 +213,8 @@ array_create()
 	head = array_create_element(-1, (char *)NULL);	/* dummy head */
 	head->prev = head->next = head;
 	r->head = head;
+	r->elements = (ARRAY_ELEMENT **)NULL;
+	r->alloc_size = 0;
 	return(r);
 }
 
@@ -112,6 +234,7 @@ ARRAY	*a;
 	a->head->next = a->head->prev = a->head;
 	a->max_index = -1;
 	a->num_elements = 0;
+	array_free_vector(a);
 	INVALIDATE_LASTREF(a);
 }
 
@@ -143,6 +266,7 @@ ARRAY	*a;
 		new = array_create_element(element_index(ae), element_value(ae));
 		ADD_BEFORE(a1->head, new);
 	}
+	array_index_elements(a1);
 	return(a1);
 }
 
@@ -170,6 +294,7 @@ ARRAY_ELEMENT	*s, *e;
 	}
 	a->num_elements = i;
 	a->max_index = mi;
+	array_index_elements(a);
 	return a;
 }
 
@@ -226,6 +351,7 @@ int	n, flags;
 		a->head->next = a->head->prev = a->head;
 		a->max_index = -1;
 		a->num_elements = 0;
+		array_free_vector(a);
 		return ret;
 	}
 	/*
@@ -242,6 +368,7 @@ int	n, flags;
 
 	a->num_elements -= n;		/* modify bookkeeping information */
 	a->max_index = element_index(a->head->prev);
+	array_index_elements(a);
 
 	if (flags & AS_DISPOSE) {
 		for (ae = ret; ae; ) {
@@ -280,6 +407,7 @@ char	*s;
 		a->num_elements++;
 		if (array_num_elements(a) == 1)	{	/* array was empty */
 			a->max_index = 0;
+			array_index_elements(a);
 			return 1;
 		}
 	}
@@ -291,6 +419,7 @@ char	*s;
 		element_index(ae) += n;
 
 	a->max_index = element_index(a->head->prev);
+	array_index_elements(a);
 
 	INVALIDATE_LASTREF(a);
 	return (a->num_elements);
@@ -614,6 +743,27 @@ char	*v;
 
 	if (a == 0)
 		return(-1);
+	if (a->elements || array_empty(a)) {
+		if (i >= a->alloc_size && ARRAY_DENSE(a, i))
+			array_grow_vector(a, i);
+		if (i >= 0 && i < a->alloc_size) {
+			if (ae = a->elements[i]) {
+				free(element_value(ae));
+				ae->value = v ? savestring(v) : (char *)NULL;
+				return(0);
+			}
+			new = array_create_element(i, v);
+			ae = array_vector_next(a, i);
+			ADD_BEFORE(ae, new);
+			a->elements[i] = new;
+			if (i > array_max_index(a))
+				a->max_index = i;
+			a->num_elements++;
+			return(0);
+		}
+		/* Too sparse for the vector; use the list from now on. */
+		array_free_vector(a);
+	}
 	new = array_create_element(i, v);
 	if (i > array_max_index(a)) {
 		/*
@@ -625,12 +775,19 @@ char	*v;
 		a->max_index = i;
 		a->num_elements++;
 		SET_LASTREF(a, new);
+		if (ARRAY_REDENSE(a))
+			array_index_elements(a);
 		return(0);
 	}
 	/*
-	 * Otherwise we search for the spot to insert it.
+	 * Otherwise we search for the spot to insert it, starting from the
+	 * roving pointer if it isn't past the spot.
 	 */
-	for (ae = element_forw(a->head); ae != a->head; ae = element_forw(ae)) {
+	if (lastref && IS_LASTREF(a) && element_index(lastref) <= i)
+		ae = lastref;
+	else
+		ae = element_forw(a->head);
+	for ( ; ae != a->head; ae = element_forw(ae)) {
 		if (element_index(ae) == i) {
 			/*
 			 * Replacing an existing element.
@@ -644,6 +801,8 @@ char	*v;
 			ADD_BEFORE(ae, new);
 			a->num_elements++;
 			SET_LASTREF(a, new);
+			if (ARRAY_REDENSE(a))
+				array_index_elements(a);
 			return(0);
 		}
 	}
@@ -664,6 +823,19 @@ arrayind_t	i;
 
 	if (a == 0 || array_empty(a))
 		return((ARRAY_ELEMENT *) NULL);
+	if (a->elements) {
+		if (i < 0 || i >= a->alloc_size || (ae = a->elements[i]) == 0)
+			return((ARRAY_ELEMENT *) NULL);
+		a->elements[i] = (ARRAY_ELEMENT *)NULL;
+		ae->next->prev = ae->prev;
+		ae->prev->next = ae->next;
+		a->num_elements--;
+		if (i == array_max_index(a))
+			a->max_index = element_index(ae->prev);
+		INVALIDATE_LASTREF(a);
+		array_shrink_vector(a);
+		return(ae);
+	}
 	for (ae = element_forw(a->head); ae != a->head; ae = element_forw(ae))
 		if (element_index(ae) == i) {
 			ae->next->prev = ae->prev;
@@ -691,6 +863,10 @@ arrayind_t	i;
 		return((char *) NULL);
 	if (i > array_max_index(a))
 		return((char *)NULL);
+	if (a->elements) {
+		ae = (i >= 0 && i < a->alloc_size) ? a->elements[i] : 0;
+		return (ae ? element_value(ae) : (char *)NULL);
+	}
 	/* Keep roving pointer into array to optimize sequential access */
 	if (lastref && IS_LASTREF(a))
 		ae = (i >= element_index(lastref)) ? lastref : element_forw(a->head);
@@ -29,11 +29,18 @@ typedef intmax_t	arrayind_t;
 
 enum atype {array_indexed, array_assoc};
 
+/*
+ * While an array's indices are dense enough, ELEMENTS is a vector with
+ * one slot for each index from 0 to ALLOC_SIZE - 1, so elements can be
+ * found without walking the list.  A sparse array has no vector.
+ */
 typedef struct array {
 	enum atype	type;
 	arrayind_t	max_index;
 	int		num_elements;
 	struct array_element *head;
+	struct array_element **elements;
+	arrayind_t	alloc_size;
 } ARRAY;
 
 typedef struct array_element {
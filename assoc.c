@@ -46,7 +46,7 @@
 
 static WORD_LIST *assoc_to_word_list_internal __P((HASH_TABLE *, int));
 
-/* assoc_create == hash_create */
+/* assoc_create == hash_create_flags (n, HASH_FNVKEYS|HASH_CHAINORDER) */
 
 void
 assoc_dispose (hash)
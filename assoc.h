@@ -28,7 +28,9 @@
 #define assoc_empty(h)		((h)->nentries == 0)
 #define assoc_num_elements(h)	((h)->nentries)
 
-#define assoc_create(n)		(hash_create((n)))
+/* Associative arrays are listed in hash order.  They keep the old hash
+   function and the old chains, so that the order doesn't change. */
+#define assoc_create(n)		(hash_create_flags((n), HASH_FNVKEYS|HASH_CHAINORDER))
 
 #define assoc_copy(h)		(hash_copy((h), 0))
 
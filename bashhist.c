@@ -31,6 +31,7 @@
 
 #include "bashtypes.h"
 #include <stdio.h>
+#include <signal.h>
 #include <errno.h>
 #include "bashansi.h"
 #include "posixstat.h"
@@ -392,6 +393,40 @@ maybe_append_history (filename)
   return (result);
 }
 
+/* Truncate the history file FILENAME to LINES entries.  An append-only
+   history file is left alone until it is worth compacting, and is then
+   compacted by a child process so that neither shell startup nor exit
+   waits for it. */
+void
+maybe_truncate_history_file (filename, lines)
+     char *filename;
+     int lines;
+{
+  pid_t pid;
+
+  if (history_append_only == 0)
+    {
+      history_truncate_file (filename, lines);
+      return;
+    }
+
+  if (history_file_oversized (filename, lines) == 0)
+    return;
+
+  pid = fork ();
+  if (pid == 0)
+    {
+      set_signal_handler (SIGINT, SIG_IGN);
+      set_signal_handler (SIGQUIT, SIG_IGN);
+      set_signal_handler (SIGHUP, SIG_IGN);
+      set_signal_handler (SIGTERM, SIG_IGN);
+      history_truncate_file (filename, lines);
+      _exit (0);
+    }
+  else if (pid < 0)
+    history_truncate_file (filename, lines);
+}
+
 /* If this is an interactive shell, then append the lines executed
    this session to the history file. */
 int
@@ -407,20 +442,21 @@ maybe_save_shell_history ()
 
       if (hf && *hf)
 	{
-	  /* If the file doesn't exist, then create it. */
+	  /* If the file doesn't exist, then create it.  Another shell
+	     sharing an append-only history file may have just done so. */
 	  if (file_exists (hf) == 0)
 	    {
 	      int file;
-	      file = open (hf, O_CREAT | O_TRUNC | O_WRONLY, 0600);
+	      file = open (hf, history_append_only ? O_CREAT | O_WRONLY : O_CREAT | O_TRUNC | O_WRONLY, 0600);
 	      if (file != -1)
 		close (file);
 	    }
 
 	  /* Now actually append the lines if the history hasn't been
 	     stifled.  If the history has been stifled, rewrite the
-	     history file. */
+	     history file, unless other shells may be appending to it. */
 	  using_history ();
-	  if (history_lines_this_session <= where_history () || force_append_history)
+	  if (history_lines_this_session <= where_history () || force_append_history || history_append_only)
 	    {
 	      result = append_history (history_lines_this_session, hf);
 	      history_lines_in_file += history_lines_this_session;
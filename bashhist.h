@@ -58,6 +58,7 @@ extern void load_history __P((void));
 extern void save_history __P((void));
 extern int maybe_append_history __P((char *));
 extern int maybe_save_shell_history __P((void));
+extern void maybe_truncate_history_file __P((char *, int));
 extern char *pre_process_line __P((char *, int, int));
 extern void maybe_add_history __P((char *));
 extern void bash_add_history __P((char *));
@@ -50,6 +50,7 @@
 #include "execute_cmd.h"
 #include "findcmd.h"
 #include "pathexp.h"
+#include "pathindex.h"
 #include "shmbutil.h"
 
 #include "builtins/common.h"
@@ -1505,6 +1506,9 @@ command_word_completion_function (hint_text, state)
   static char *dequoted_hint = (char *)NULL;
   static char *directory_part = (char *)NULL;
   static char **glob_matches = (char **)NULL;
+  static char **path_matches = (char **)NULL;
+  static char *path_dir = (char *)NULL;
+  static int path_match_index, match_hidden;
   static int path_index, hint_len, dequoted_len, istate, igncase;
   static int mapping_over, local_index, searching_path, hint_is_dir;
   static int old_glob_ignore_case, globpat;
@@ -1529,6 +1533,8 @@ command_word_completion_function (hint_text, state)
 
       temp = rl_variable_value ("completion-ignore-case");
       igncase = RL_BOOLEAN_VARIABLE_VALUE (temp);
+      temp = rl_variable_value ("match-hidden-files");
+      match_hidden = RL_BOOLEAN_VARIABLE_VALUE (temp);
 
       if (glob_matches)
 	{
@@ -1536,6 +1542,12 @@ command_word_completion_function (hint_text, state)
 	  glob_matches = (char **)NULL;
 	}
 
+      if (path_matches)
+	{
+	  strvec_dispose (path_matches);
+	  path_matches = (char **)NULL;
+	}
+
       globpat = glob_pattern_p (hint_text);
 
       /* If this is an absolute program name, do not check it against
@@ -1606,6 +1618,7 @@ command_word_completion_function (hint_text, state)
       
       path = get_string_value ("PATH");
       path_index = dot_in_path = 0;
+      path_index_sync ();
 
       /* Initialize the variables for each type of command word. */
       local_index = 0;
@@ -1781,6 +1794,18 @@ globword:
       if (current_path[0] == '.' && current_path[1] == '\0')
 	dot_in_path = 1;
 
+      /* Take the names from the directory's index if it has one, rather
+	 than reading the directory each time. */
+      path_matches = path_index_matches (current_path, dequoted_hint, igncase);
+      if (path_matches)
+	{
+	  FREE (path_dir);
+	  path_dir = current_path;
+	  path_match_index = 0;
+	  rl_filename_completion_desired = 1;
+	  goto inner;
+	}
+
       if (filename_hint)
 	free (filename_hint);
 
@@ -1789,6 +1814,29 @@ globword:
     }
 
  inner:
+  if (path_matches)
+    {
+      while (temp = path_matches[path_match_index++])
+	{
+	  /* rl_filename_completion_function skips hidden files when
+	     completing an empty word unless told otherwise. */
+	  if (dequoted_len == 0 && match_hidden == 0 && *temp == '.')
+	    continue;
+	  val = sh_makepath (path_dir, temp, 0);
+	  if (executable_file (val))
+	    {
+	      free (val);
+	      val = "";		/* So it won't be NULL. */
+	      return (savestring (temp));
+	    }
+	  free (val);
+	}
+      strvec_dispose (path_matches);
+      path_matches = (char **)NULL;
+      val = (char *)NULL;
+      goto outer;
+    }
+
   val = rl_filename_completion_function (filename_hint, istate);
   istate = 1;
 
@@ -167,10 +167,12 @@ extern WORD_LIST *get_directory_stack __P((int));
 extern int parse_and_execute __P((char *, const char *, int));
 extern void parse_and_execute_cleanup __P((void));
 extern int parse_string __P((char *, const char *, int, char **));
+extern int parse_string_to_command __P((char *, const char *, int, COMMAND **));
 
 /* Functions from evalfile.c */
 extern int maybe_execute_file __P((const char *, int));
 extern int source_file __P((const char *, int));
 extern int fc_execute_file __P((const char *));
+extern int autoload_file __P((const char *, const char *, intmax_t, intmax_t));
 
 #endif /* !__COMMON_H */
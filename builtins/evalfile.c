@@ -42,6 +42,8 @@
 #include "../input.h"
 #include "../execute_cmd.h"
 #include "../trap.h"
+#include "../parsecache.h"
+#include "../startuptime.h"
 
 #if defined (HISTORY)
 #  include "../bashhist.h"
@@ -70,6 +72,7 @@ extern int posixly_correct;
 extern int indirection_level, subshell_environment;
 extern int return_catch_flag, return_catch_value;
 extern int last_command_exit_value;
+extern const char *parse_and_execute_funcname;
 
 /* How many `levels' of sourced files we have. */
 int sourcelevel = 0;
@@ -254,6 +257,7 @@ file_error_and_exit:
   if (flags & FEVAL_BUILTIN)
     result = EXECUTION_SUCCESS;
 
+  STARTUP_FILE_BEGIN (filename);
   return_val = setjmp (return_catch);
 
   /* If `return' was seen outside of a function, but in the script, then
@@ -264,7 +268,13 @@ file_error_and_exit:
       result = return_catch_value;
     }
   else
-    result = parse_and_execute (string, filename, pflags);
+    {
+      /* Commands added to the history list have to be parsed. */
+      if ((flags & FEVAL_HISTORY) == 0)
+	parse_cache_pending = parse_cache_open (filename, string, nr, &finfo);
+      result = parse_and_execute (string, filename, pflags);
+    }
+  STARTUP_END ();
 
   if (flags & FEVAL_UNWINDPROT)
     run_unwind_frame ("_evalfile");
@@ -349,3 +359,91 @@ source_file (filename, sflags)
   run_return_trap ();
   return rval;
 }
+
+/* Read LENGTH bytes of FILENAME starting at byte OFFSET, or the rest of the
+   file if LENGTH is -1, and execute the definition of the function NAME
+   they contain.  Only function definitions are allowed; the others are
+   checked but not executed, so functions defined since the file was read
+   last are left alone.  BASH_SOURCE is set as it is for `source', so the
+   function is attributed to FILENAME.  Returns -1 after printing an error
+   message if the file cannot be read. */
+int
+autoload_file (filename, name, offset, length)
+     const char *filename, *name;
+     intmax_t offset, length;
+{
+  struct stat finfo;
+  intmax_t size;
+  ssize_t nr;
+  char *string;
+  int fd, result;
+#if defined (ARRAY_VARS)
+  SHELL_VAR *funcname_v, *nfv, *bash_source_v, *bash_lineno_v;
+  ARRAY *funcname_a, *bash_source_a, *bash_lineno_a;
+  char *t;
+#endif
+
+  fd = open (filename, O_RDONLY);
+  if (fd < 0 || fstat (fd, &finfo) == -1)
+    {
+      file_error (filename);
+      if (fd >= 0)
+	close (fd);
+      return -1;
+    }
+
+  if (S_ISREG (finfo.st_mode) == 0)
+    {
+      internal_error (_("%s: not a regular file"), filename);
+      close (fd);
+      return -1;
+    }
+
+  size = (offset < finfo.st_size) ? finfo.st_size - offset : 0;
+  if (length >= 0 && length < size)
+    size = length;
+
+  string = (char *)xmalloc (1 + size);
+  if (offset > 0 && lseek (fd, (off_t)offset, SEEK_SET) < 0)
+    nr = -1;
+  else
+    nr = read (fd, string, size);
+
+  result = errno;
+  close (fd);
+  errno = result;
+
+  if (nr < 0)
+    {
+      file_error (filename);
+      free (string);
+      return -1;
+    }
+  string[nr] = '\0';
+
+#if defined (ARRAY_VARS)
+  GET_ARRAY_FROM_VAR ("FUNCNAME", funcname_v, funcname_a);
+  GET_ARRAY_FROM_VAR ("BASH_SOURCE", bash_source_v, bash_source_a);
+  GET_ARRAY_FROM_VAR ("BASH_LINENO", bash_lineno_v, bash_lineno_a);
+
+  array_push (bash_source_a, (char *)filename);
+  t = itos (executing_line_number ());
+  array_push (bash_lineno_a, t);
+  free (t);
+  array_push (funcname_a, "autoload");
+#endif
+
+  parse_and_execute_funcname = name;
+  result = parse_and_execute (string, filename, SEVAL_NONINT|SEVAL_NOHIST|SEVAL_FUNCDEF|SEVAL_RESETLINE);
+
+#if defined (ARRAY_VARS)
+  array_pop (bash_source_a);
+  array_pop (bash_lineno_a);
+
+  GET_ARRAY_FROM_VAR ("FUNCNAME", nfv, funcname_a);
+  if (nfv == funcname_v)
+    array_pop (funcname_a);
+#endif
+
+  return result;
+}
@@ -43,6 +43,7 @@
 #include "../execute_cmd.h"
 #include "../redir.h"
 #include "../trap.h"
+#include "../parsecache.h"
 #include "../bashintl.h"
 
 #include <y.tab.h>
@@ -73,6 +74,10 @@ extern sh_builtin_func_t *this_shell_builtin;
 
 int parse_and_execute_level = 0;
 
+/* If non-null, the next call to parse_and_execute with SEVAL_FUNCDEF
+   defines only the function with this name and skips the others. */
+const char *parse_and_execute_funcname = (const char *)NULL;
+
 static int cat_file __P((REDIRECT *));
 
 #define PE_TAG "parse_and_execute top"
@@ -124,6 +129,11 @@ parse_prologue (string, flags, tag)
   if (flags & (SEVAL_NONINT|SEVAL_INTERACT))
     unwind_protect_int (interactive);
 
+  /* Commands run from here must not allocate from the arena of a command
+     the caller may be parsing; parse_and_execute () uses its own. */
+  unwind_protect_pointer (cmd_arena);
+  cmd_arena = (CMD_ARENA *)NULL;
+
 #if defined (HISTORY)
   if (parse_and_execute_level == 0)
     add_unwind_protect (set_history_remembering, (char *)NULL);
@@ -172,12 +182,31 @@ parse_and_execute (string, from_file, flags)
      const char *from_file;
      int flags;
 {
-  int code, lreset;
+  int code, lreset, r;
   volatile int should_jump_to_top_level, last_result;
   COMMAND *volatile command;
+  PARSE_CACHE *pcache;
+  CMD_ARENA *arena;
+  const char *funcname;
 
   parse_prologue (string, flags, PE_TAG);
 
+  /* Each command is parsed into ARENA, which is reset once the command
+     has been run and disposed of. */
+  arena = use_cmd_arena ? cmd_arena_create () : (CMD_ARENA *)NULL;
+  if (arena)
+    add_unwind_protect (cmd_arena_dispose, arena);
+
+  /* If _evalfile () set up a parse cache for STRING, take it. */
+  pcache = parse_cache_pending;
+  parse_cache_pending = (PARSE_CACHE *)NULL;
+  if (pcache)
+    add_unwind_protect (parse_cache_dispose, pcache);
+
+  /* Likewise the name of the function autoload_file () wants defined. */
+  funcname = (flags & SEVAL_FUNCDEF) ? parse_and_execute_funcname : (const char *)NULL;
+  parse_and_execute_funcname = (const char *)NULL;
+
   parse_and_execute_level++;
 
   lreset = flags & SEVAL_RESETLINE;
@@ -214,6 +243,10 @@ parse_and_execute (string, from_file, flags)
       if (code)
 	{
 	  should_jump_to_top_level = 0;
+	  cmd_arena = (CMD_ARENA *)NULL;
+	  /* Stop recording commands; the one being parsed may be incomplete. */
+	  if (pcache)
+	    parse_cache_abort (pcache);
 	  switch (code)
 	    {
 	    case FORCE_EOF:
@@ -249,7 +282,12 @@ parse_and_execute (string, from_file, flags)
 	    }
 	}
 	  
-      if (parse_command () == 0)
+      cmd_arena_reset (arena);
+      cmd_arena = use_cmd_arena ? arena : (CMD_ARENA *)NULL;
+      r = parse_cache_parse_command (pcache);
+      cmd_arena = (CMD_ARENA *)NULL;
+
+      if (r == 0)
 	{
 	  if ((flags & SEVAL_PARSEONLY) || (interactive_shell == 0 && read_but_dont_execute))
 	    {
@@ -264,10 +302,19 @@ parse_and_execute (string, from_file, flags)
 	      if ((flags & SEVAL_FUNCDEF) && command->type != cm_function_def)
 		{
 		  internal_warning ("%s: ignoring function definition attempt", from_file);
+		  /* Don't leave global_command pointing into the arena. */
+		  dispose_command (command);
+		  global_command = (COMMAND *)NULL;
 		  should_jump_to_top_level = 0;
 		  last_result = last_command_exit_value = EX_BADUSAGE;
 		  break;
 		}
+	      else if (funcname && STREQ (command->value.Function_def->name->word, funcname) == 0)
+		{
+		  dispose_command (command);
+		  global_command = (COMMAND *)NULL;
+		  continue;
+		}
 
 	      bitmap = new_fd_bitmap (FD_BITMAP_SIZE);
 	      begin_unwind_frame ("pe_dispose");
@@ -357,6 +404,10 @@ parse_and_execute (string, from_file, flags)
 	}
     }
 
+  /* Every command in STRING has been parsed and run. */
+  if (pcache && *(bash_input.location.string) == '\0')
+    parse_cache_save (pcache);
+
  out:
 
   run_unwind_frame (PE_TAG);
@@ -480,6 +531,75 @@ itrace("parse_string: longjmp executed: code = %d", code);
   return (nc);
 }
 
+/* Parse all of the commands in STRING without executing any of them, and
+   return them joined into a single list in *COMMANDP, or NULL if there are
+   none.  Returns non-zero after printing an error message if STRING
+   contains a syntax error.  FLAGS are as for parse_and_execute.  Used to
+   look at a command substitution before deciding whether it has to run
+   in a child. */
+int
+parse_string_to_command (string, from_file, flags, commandp)
+     char *string;
+     const char *from_file;
+     int flags;
+     COMMAND **commandp;
+{
+  int code, result;
+  volatile int should_jump_to_top_level;
+  COMMAND *volatile command;
+  COMMAND *oglobal;
+
+  parse_prologue (string, flags, PS_TAG);
+
+  push_stream (flags & SEVAL_RESETLINE);
+  if ((flags & SEVAL_RESETLINE) == 0)
+    line_number--;
+
+  code = should_jump_to_top_level = result = 0;
+  oglobal = global_command;
+  command = (COMMAND *)NULL;
+
+  with_input_from_string (string, from_file);
+  while (*(bash_input.location.string))
+    {
+      code = setjmp (top_level);
+
+      if (code)
+	{
+	  should_jump_to_top_level = 1;
+	  goto out;
+	}
+
+      if (parse_command ())
+	{
+	  result = 1;
+	  break;
+	}
+
+      if (global_command)
+	command = command ? command_connect (command, global_command, ';')
+			  : global_command;
+      global_command = (COMMAND *)NULL;
+    }
+
+ out:
+
+  global_command = oglobal;
+  run_unwind_frame (PS_TAG);
+
+  if ((result || should_jump_to_top_level) && command)
+    {
+      dispose_command (command);
+      command = (COMMAND *)NULL;
+    }
+
+  if (should_jump_to_top_level)
+    jump_to_top_level (code);
+
+  *commandp = command;
+  return (result);
+}
+
 /* Handle a $( < file ) command substitution.  This expands the filename,
    returning errors as appropriate, then just cats the file to the standard
    output. */
@@ -109,3 +109,10 @@
 
 /* Define if you want to include code in shell.c to support wordexp(3) */
 /* #define WORDEXP_OPTION */
+
+/* Define if you want the shell's hash tables (variables, functions,
+   completions) to use the old byte-at-a-time hash function in hashlib.c
+   instead of the word-at-a-time one.  Associative arrays, and the alias
+   and command hash tables listed by BASH_ALIASES and BASH_CMDS, always use
+   the old function, so that the order of their elements doesn't change. */
+/* #define HASH_STRING_FNV */
@@ -52,13 +52,20 @@ static COND_COM *copy_cond_command __P((COND_COM *));
 #endif
 static SIMPLE_COM *copy_simple_command __P((SIMPLE_COM *));
 
+/* Copies are made to outlive the command being parsed, so they never come
+   from a command arena. */
 WORD_DESC *
 copy_word (w)
      WORD_DESC *w;
 {
   WORD_DESC *new_word;
+  CMD_ARENA *arena;
 
+  arena = cmd_arena;
+  cmd_arena = (CMD_ARENA *)NULL;
   new_word = make_bare_word (w->word);
+  cmd_arena = arena;
+
   new_word->flags = w->flags;
   return (new_word);
 }
@@ -70,9 +77,13 @@ copy_word_list (list)
      WORD_LIST *list;
 {
   WORD_LIST *new_list;
+  CMD_ARENA *arena;
 
+  arena = cmd_arena;
+  cmd_arena = (CMD_ARENA *)NULL;
   for (new_list = (WORD_LIST *)NULL; list; list = list->next)
     new_list = make_word_list (copy_word (list->word), new_list);
+  cmd_arena = arena;
 
   return (REVERSE_LIST (new_list, WORD_LIST *));
 }
@@ -83,7 +94,7 @@ copy_case_clause (clause)
 {
   PATTERN_LIST *new_clause;
 
-  new_clause = (PATTERN_LIST *)xmalloc (sizeof (PATTERN_LIST));
+  new_clause = (PATTERN_LIST *)heap_node_alloc (sizeof (PATTERN_LIST));
   new_clause->patterns = copy_word_list (clause->patterns);
   new_clause->action = copy_command (clause->action);
   new_clause->flags = clause->flags;
@@ -112,7 +123,7 @@ copy_redirect (redirect)
 {
   REDIRECT *new_redirect;
 
-  new_redirect = (REDIRECT *)xmalloc (sizeof (REDIRECT));
+  new_redirect = (REDIRECT *)heap_node_alloc (sizeof (REDIRECT));
 #if 0
   FASTCOPY ((char *)redirect, (char *)new_redirect, (sizeof (REDIRECT)));
 #else
@@ -174,7 +185,7 @@ copy_for_command (com)
 {
   FOR_COM *new_for;
 
-  new_for = (FOR_COM *)xmalloc (sizeof (FOR_COM));
+  new_for = (FOR_COM *)heap_node_alloc (sizeof (FOR_COM));
   new_for->flags = com->flags;
   new_for->line = com->line;
   new_for->name = copy_word (com->name);
@@ -190,7 +201,7 @@ copy_arith_for_command (com)
 {
   ARITH_FOR_COM *new_arith_for;
 
-  new_arith_for = (ARITH_FOR_COM *)xmalloc (sizeof (ARITH_FOR_COM));
+  new_arith_for = (ARITH_FOR_COM *)heap_node_alloc (sizeof (ARITH_FOR_COM));
   new_arith_for->flags = com->flags;
   new_arith_for->line = com->line;
   new_arith_for->init = copy_word_list (com->init);
@@ -207,7 +218,7 @@ copy_group_command (com)
 {
   GROUP_COM *new_group;
 
-  new_group = (GROUP_COM *)xmalloc (sizeof (GROUP_COM));
+  new_group = (GROUP_COM *)heap_node_alloc (sizeof (GROUP_COM));
   new_group->command = copy_command (com->command);
   return (new_group);
 }
@@ -218,7 +229,7 @@ copy_subshell_command (com)
 {
   SUBSHELL_COM *new_subshell;
 
-  new_subshell = (SUBSHELL_COM *)xmalloc (sizeof (SUBSHELL_COM));
+  new_subshell = (SUBSHELL_COM *)heap_node_alloc (sizeof (SUBSHELL_COM));
   new_subshell->command = copy_command (com->command);
   new_subshell->flags = com->flags;
   return (new_subshell);
@@ -230,7 +241,7 @@ copy_coproc_command (com)
 {
   COPROC_COM *new_coproc;
 
-  new_coproc = (COPROC_COM *)xmalloc (sizeof (COPROC_COM));
+  new_coproc = (COPROC_COM *)heap_node_alloc (sizeof (COPROC_COM));
   new_coproc->name = savestring (com->name);
   new_coproc->command = copy_command (com->command);
   new_coproc->flags = com->flags;
@@ -243,7 +254,7 @@ copy_case_command (com)
 {
   CASE_COM *new_case;
 
-  new_case = (CASE_COM *)xmalloc (sizeof (CASE_COM));
+  new_case = (CASE_COM *)heap_node_alloc (sizeof (CASE_COM));
   new_case->flags = com->flags;
   new_case->line = com->line;
   new_case->word = copy_word (com->word);
@@ -257,7 +268,7 @@ copy_while_command (com)
 {
   WHILE_COM *new_while;
 
-  new_while = (WHILE_COM *)xmalloc (sizeof (WHILE_COM));
+  new_while = (WHILE_COM *)heap_node_alloc (sizeof (WHILE_COM));
   new_while->flags = com->flags;
   new_while->test = copy_command (com->test);
   new_while->action = copy_command (com->action);
@@ -270,7 +281,7 @@ copy_if_command (com)
 {
   IF_COM *new_if;
 
-  new_if = (IF_COM *)xmalloc (sizeof (IF_COM));
+  new_if = (IF_COM *)heap_node_alloc (sizeof (IF_COM));
   new_if->flags = com->flags;
   new_if->test = copy_command (com->test);
   new_if->true_case = copy_command (com->true_case);
@@ -285,7 +296,7 @@ copy_arith_command (com)
 {
   ARITH_COM *new_arith;
 
-  new_arith = (ARITH_COM *)xmalloc (sizeof (ARITH_COM));
+  new_arith = (ARITH_COM *)heap_node_alloc (sizeof (ARITH_COM));
   new_arith->flags = com->flags;
   new_arith->exp = copy_word_list (com->exp);
   new_arith->line = com->line;
@@ -301,7 +312,7 @@ copy_cond_command (com)
 {
   COND_COM *new_cond;
 
-  new_cond = (COND_COM *)xmalloc (sizeof (COND_COM));
+  new_cond = (COND_COM *)heap_node_alloc (sizeof (COND_COM));
   new_cond->flags = com->flags;
   new_cond->line = com->line;
   new_cond->type = com->type;
@@ -319,7 +330,7 @@ copy_simple_command (com)
 {
   SIMPLE_COM *new_simple;
 
-  new_simple = (SIMPLE_COM *)xmalloc (sizeof (SIMPLE_COM));
+  new_simple = (SIMPLE_COM *)heap_node_alloc (sizeof (SIMPLE_COM));
   new_simple->flags = com->flags;
   new_simple->words = copy_word_list (com->words);
   new_simple->redirects = com->redirects ? copy_redirects (com->redirects) : (REDIRECT *)NULL;
@@ -345,7 +356,7 @@ copy_function_def (com)
 {
   FUNCTION_DEF *new_def;
 
-  new_def = (FUNCTION_DEF *)xmalloc (sizeof (FUNCTION_DEF));
+  new_def = (FUNCTION_DEF *)heap_node_alloc (sizeof (FUNCTION_DEF));
   new_def = copy_function_def_contents (com, new_def);
   return (new_def);
 }
@@ -362,7 +373,7 @@ copy_command (command)
   if (command == NULL)
     return (command);
 
-  new_command = (COMMAND *)xmalloc (sizeof (COMMAND));
+  new_command = (COMMAND *)heap_node_alloc (sizeof (COMMAND));
   FASTCOPY ((char *)command, (char *)new_command, sizeof (COMMAND));
   new_command->flags = command->flags;
   new_command->line = command->line;
@@ -434,7 +445,7 @@ copy_command (command)
 	{
 	  CONNECTION *new_connection;
 
-	  new_connection = (CONNECTION *)xmalloc (sizeof (CONNECTION));
+	  new_connection = (CONNECTION *)heap_node_alloc (sizeof (CONNECTION));
 	  new_connection->connector = command->value.Connection->connector;
 	  new_connection->first = copy_command (command->value.Connection->first);
 	  new_connection->second = copy_command (command->value.Connection->second);
@@ -29,7 +29,18 @@
 #include "bashansi.h"
 #include "shell.h"
 
-extern sh_obj_cache_t wdcache, wlcache;
+extern sh_obj_pool_t wdpool, wlpool;
+
+/* Free the parse tree node P unless it belongs to a command arena, which
+   releases its nodes all at once. */
+#define FREE_NODE(p) \
+  do { \
+    if (cmd_arena_owns (p) == 0) \
+      { \
+	free (p); \
+	cmd_heap_frees++; \
+      } \
+  } while (0)
 
 /* Dispose of the command structure passed. */
 void
@@ -59,7 +70,7 @@ dispose_command (command)
 	dispose_word (c->name);
 	dispose_words (c->map_list);
 	dispose_command (c->action);
-	free (c);
+	FREE_NODE (c);
 	break;
       }
 
@@ -73,7 +84,7 @@ dispose_command (command)
 	dispose_words (c->test);
 	dispose_words (c->step);
 	dispose_command (c->action);
-	free (c);
+	FREE_NODE (c);
 	break;
       }
 #endif /* ARITH_FOR_COMMAND */
@@ -81,14 +92,14 @@ dispose_command (command)
     case cm_group:
       {
 	dispose_command (command->value.Group->command);
-	free (command->value.Group);
+	FREE_NODE (command->value.Group);
 	break;
       }
 
     case cm_subshell:
       {
 	dispose_command (command->value.Subshell->command);
-	free (command->value.Subshell);
+	FREE_NODE (command->value.Subshell);
 	break;
       }
 
@@ -96,7 +107,7 @@ dispose_command (command)
       {
 	free (command->value.Coproc->name);
 	dispose_command (command->value.Coproc->command);
-	free (command->value.Coproc);
+	FREE_NODE (command->value.Coproc);
 	break;
       }
 
@@ -114,9 +125,9 @@ dispose_command (command)
 	    dispose_command (p->action);
 	    t = p;
 	    p = p->next;
-	    free (t);
+	    FREE_NODE (t);
 	  }
-	free (c);
+	FREE_NODE (c);
 	break;
       }
 
@@ -128,7 +139,7 @@ dispose_command (command)
 	c = command->value.While;
 	dispose_command (c->test);
 	dispose_command (c->action);
-	free (c);
+	FREE_NODE (c);
 	break;
       }
 
@@ -140,7 +151,7 @@ dispose_command (command)
 	dispose_command (c->test);
 	dispose_command (c->true_case);
 	dispose_command (c->false_case);
-	free (c);
+	FREE_NODE (c);
 	break;
       }
 
@@ -151,7 +162,7 @@ dispose_command (command)
 	c = command->value.Simple;
 	dispose_words (c->words);
 	dispose_redirects (c->redirects);
-	free (c);
+	FREE_NODE (c);
 	break;
       }
 
@@ -162,7 +173,7 @@ dispose_command (command)
 	c = command->value.Connection;
 	dispose_command (c->first);
 	dispose_command (c->second);
-	free (c);
+	FREE_NODE (c);
 	break;
       }
 
@@ -173,7 +184,7 @@ dispose_command (command)
 
 	c = command->value.Arith;
 	dispose_words (c->exp);
-	free (c);
+	FREE_NODE (c);
 	break;
       }
 #endif /* DPAREN_ARITHMETIC */
@@ -202,7 +213,7 @@ dispose_command (command)
       command_error ("dispose_command", CMDERR_BADTYPE, command->type, 0);
       break;
     }
-  free (command);
+  FREE_NODE (command);
 }
 
 #if defined (COND_COMMAND)
@@ -219,7 +230,7 @@ dispose_cond_node (cond)
 	dispose_cond_node (cond->right);
       if (cond->op)
 	dispose_word (cond->op);
-      free (cond);
+      FREE_NODE (cond);
     }
 }
 #endif /* COND_COMMAND */
@@ -238,7 +249,7 @@ dispose_function_def (c)
      FUNCTION_DEF *c;
 {
   dispose_function_def_contents (c);
-  free (c);
+  FREE_NODE (c);
 }
 
 /* How to free a WORD_DESC. */
@@ -247,7 +258,11 @@ dispose_word (w)
      WORD_DESC *w;
 {
   FREE (w->word);
-  ocache_free (wdcache, WORD_DESC, w);
+  if (cmd_arena_owns (w) == 0)
+    {
+      opool_free (wdpool, WORD_DESC, w);
+      cmd_heap_frees++;
+    }
 }
 
 /* Free a WORD_DESC, but not the word contained within. */
@@ -256,7 +271,11 @@ dispose_word_desc (w)
      WORD_DESC *w;
 {
   w->word = 0;
-  ocache_free (wdcache, WORD_DESC, w);
+  if (cmd_arena_owns (w) == 0)
+    {
+      opool_free (wdpool, WORD_DESC, w);
+      cmd_heap_frees++;
+    }
 }
 
 /* How to get rid of a linked list of words.  A WORD_LIST. */
@@ -274,7 +293,11 @@ dispose_words (list)
 #if 0
       free (t);
 #else
-      ocache_free (wlcache, WORD_LIST, t);
+      if (cmd_arena_owns (t) == 0)
+	{
+	  opool_free (wlpool, WORD_LIST, t);
+	  cmd_heap_frees++;
+	}
 #endif
     }
 }
@@ -337,6 +360,6 @@ dispose_redirects (list)
 	default:
 	  break;
 	}
-      free (t);
+      FREE_NODE (t);
     }
 }
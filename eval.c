@@ -54,6 +54,9 @@ extern int need_here_doc;
 extern int current_command_number, current_command_line_count, line_number;
 extern int expand_aliases;
 
+/* The arena the commands read by reader_loop () are parsed into. */
+static CMD_ARENA *reader_arena;
+
 static void send_pwd_to_eterm __P((void));
 static sighandler alrm_catcher __P((int));
 
@@ -79,7 +82,7 @@ reader_loop ()
 
   while (EOF_Reached == 0)
     {
-      int code;
+      int code, r;
 
       code = setjmp (top_level);
 
@@ -93,6 +96,7 @@ reader_loop ()
       if (code != NOT_JUMPED)
 	{
 	  indirection_level = our_indirection_level;
+	  cmd_arena = (CMD_ARENA *)NULL;
 
 	  switch (code)
 	    {
@@ -140,7 +144,16 @@ reader_loop ()
       (void) alloca (0);
 #endif
 
-      if (read_command () == 0)
+      /* The last command has been disposed of, so its arena can be
+	 reused for the next one. */
+      if (use_cmd_arena && reader_arena == 0)
+	reader_arena = cmd_arena_create ();
+      cmd_arena_reset (reader_arena);
+      cmd_arena = use_cmd_arena ? reader_arena : (CMD_ARENA *)NULL;
+      r = read_command ();
+      cmd_arena = (CMD_ARENA *)NULL;
+
+      if (r == 0)
 	{
 	  if (interactive_shell == 0 && read_but_dont_execute)
 	    {
@@ -228,6 +241,8 @@ parse_command ()
 
       if (running_under_emacs == 2)
 	send_pwd_to_eterm ();	/* Yuck */
+
+      flush_command_log (1);
     }
 
   vyatta_reset_hist_expansion();
@@ -98,6 +98,15 @@ extern int errno;
 #  include "bashhist.h"
 #endif
 
+/* Start simple commands with posix_spawn if the C library reports execve
+   failures to the parent, so the shell can fork and report the error as
+   it always has.  glibc does starting with version 2.24. */
+#if defined (HAVE_POSIX_SPAWN)
+#  if !defined (__GLIBC__) || __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 24)
+#    define SPAWN_DISK_COMMANDS
+#  endif
+#endif
+
 extern int posixly_correct;
 extern int expand_aliases;
 extern int autocd;
@@ -180,6 +189,13 @@ static void execute_subshell_builtin_or_function __P((WORD_LIST *, REDIRECT *,
 						      int));
 static void execute_disk_command __P((WORD_LIST *, REDIRECT *, char *,
 				      int, int, int, struct fd_bitmap *, int));
+#if defined (SPAWN_DISK_COMMANDS)
+static int spawn_literal_word __P((WORD_DESC *));
+static int spawn_redirections __P((posix_spawn_file_actions_t *, REDIRECT *, int *));
+static int spawn_exec_ok __P((char *));
+static pid_t spawn_disk_command __P((char *, WORD_LIST *, REDIRECT *, char *,
+				     int, int, struct fd_bitmap *));
+#endif
 
 static char *getinterp __P((char *, int, int *));
 static void initialize_subshell __P((void));
@@ -253,6 +269,10 @@ SHELL_VAR *this_shell_function;
 /* If non-zero, matches in case and [[ ... ]] are case-insensitive */
 int match_ignore_case = 0;
 
+/* If non-zero, start simple external commands with posix_spawn when we
+   can, instead of forking a copy of the shell.  Set by `shopt spawncmds'. */
+int spawn_disk_commands = 1;
+
 struct stat SB;		/* used for debugging */
 
 static int special_builtin_failed;
@@ -4219,11 +4239,15 @@ execute_shell_function (var, words)
   bitmap = new_fd_bitmap (FD_BITMAP_DEFAULT_SIZE);
   begin_unwind_frame ("execute-shell-function");
   add_unwind_protect (dispose_fd_bitmap, (char *)bitmap);
+
+  /* Completion functions run while the parser is reading a command; keep
+     what they allocate out of that command's arena. */
+  unwind_protect_pointer (cmd_arena);
+  cmd_arena = (CMD_ARENA *)NULL;
       
   ret = execute_function (var, words, 0, bitmap, 0, 0);
 
-  dispose_fd_bitmap (bitmap);
-  discard_unwind_frame ("execute-shell-function");
+  run_unwind_frame ("execute-shell-function");
 
   return ret;
 }
@@ -4508,7 +4532,20 @@ execute_disk_command (words, redirects, command_line, pipe_in, pipe_out,
   if (nofork && pipe_in == NO_PIPE && pipe_out == NO_PIPE)
     pid = 0;
   else
-    pid = make_child (savestring (command_line), async);
+    {
+#if defined (SPAWN_DISK_COMMANDS)
+      /* Any failure, including in execve, leaves it to the forked child
+	 to run the command or report the error.  spawn_disk_command makes
+	 sure that performing the redirections again in that child is
+	 harmless. */
+      pid = -1;
+      if (command && async == 0 && job_control == 0 && spawn_disk_commands)
+	pid = spawn_disk_command (command, words, redirects, command_line,
+				  pipe_in, pipe_out, fds_to_close);
+      if (pid < 0)
+#endif
+      pid = make_child (savestring (command_line), async);
+    }
 
   if (pid == 0)
     {
@@ -4598,6 +4635,197 @@ parent_return:
     }
 }
 
+#if defined (SPAWN_DISK_COMMANDS)
+/* Return non-zero if W needs no expansion: redirection_expand would
+   return it unchanged. */
+static int
+spawn_literal_word (w)
+     WORD_DESC *w;
+{
+  register char *s;
+
+  if (w == 0 || w->word == 0 || *w->word == '\0')
+    return 0;
+  for (s = w->word; *s; s++)
+    if (ISALNUM ((unsigned char)*s) == 0 && strchr ("/._-+,:@%", *s) == 0)
+      return 0;
+  return 1;
+}
+
+/* Add file actions to ACTIONS that do what do_redirections (REDIRECTS)
+   would do in a child, and set *OPENSP to the number of files they open.
+   Returns 0 if some redirection needs the shell's help: expanding a word,
+   here documents, noclobber, the restricted shell's checks, {var}
+   assignments, the files redir.c opens itself, or the close-on-exec
+   bookkeeping done when duplicating fds above 2.  Also returns 0 if a
+   file to be opened exists and is not a regular file, since opening a
+   fifo or a device a second time, if the spawned child fails and the
+   forked one performs the redirections again, is not harmless. */
+static int
+spawn_redirections (actions, redirects, opensp)
+     posix_spawn_file_actions_t *actions;
+     REDIRECT *redirects;
+     int *opensp;
+{
+  REDIRECT *r;
+  struct stat finfo;
+  char *fn;
+  int fd;
+
+  *opensp = 0;
+  for (r = redirects; r; r = r->next)
+    {
+      if (r->rflags & REDIR_VARASSIGN)
+	return 0;
+      fd = r->redirector.dest;
+      switch (r->instruction)
+	{
+	case r_output_direction:
+	case r_output_force:
+	case r_appending_to:
+	case r_input_direction:
+	case r_err_and_out:
+	case r_append_err_and_out:
+	  if (spawn_literal_word (r->redirectee.filename) == 0)
+	    return 0;
+	  fn = r->redirectee.filename->word;
+	  if (STREQN (fn, "/dev/", 5) && STREQ (fn, "/dev/null") == 0)
+	    return 0;
+	  if (noclobber && CLOBBERING_REDIRECT (r->instruction))
+	    return 0;
+#if defined (RESTRICTED_SHELL)
+	  if (restricted && WRITE_REDIRECT (r->instruction))
+	    return 0;
+#endif
+	  if (stat (fn, &finfo) == 0 && S_ISREG (finfo.st_mode) == 0)
+	    return 0;
+	  if (posix_spawn_file_actions_addopen (actions, fd, fn, r->flags, 0666))
+	    return 0;
+	  (*opensp)++;
+	  if ((r->instruction == r_err_and_out || r->instruction == r_append_err_and_out) &&
+	      posix_spawn_file_actions_adddup2 (actions, 1, 2))
+	    return 0;
+	  break;
+
+	case r_duplicating_input:
+	case r_duplicating_output:
+	  if (fd < 0 || fd > 2 || r->redirectee.dest < 0)
+	    return 0;
+	  if (fd != r->redirectee.dest &&
+	      posix_spawn_file_actions_adddup2 (actions, r->redirectee.dest, fd))
+	    return 0;
+	  break;
+
+	case r_close_this:
+	  if (fd < 0 || posix_spawn_file_actions_addclose (actions, fd))
+	    return 0;
+	  break;
+
+	default:
+	  return 0;
+	}
+    }
+  return 1;
+}
+
+/* Return non-zero if execve should be able to run COMMAND: it starts with
+   #! or looks like a binary.  A text file without #! makes execve fail
+   with ENOEXEC only after the spawned child has performed its file
+   actions, and the shell runs such scripts in a forked child. */
+static int
+spawn_exec_ok (command)
+     char *command;
+{
+  char sample[80];
+  int fd, len;
+
+  fd = open (command, O_RDONLY);
+  if (fd < 0)
+    return 0;
+  len = read (fd, sample, sizeof (sample));
+  close (fd);
+
+  if (len >= 2 && sample[0] == '#' && sample[1] == '!')
+    return 1;
+  return (len > 0 && check_binary_file (sample, len));
+}
+
+/* Start COMMAND, the full pathname of the external command WORDS names,
+   with posix_spawn instead of make_child if the work the child would do
+   before calling execve can be expressed as spawn file actions: closing
+   FDS_TO_CLOSE, connecting PIPE_IN and PIPE_OUT, and performing
+   REDIRECTS.  The caller has checked that the command is synchronous and
+   job control is off.  Returns the pid of the child, or -1 if the caller
+   should fork.  If posix_spawn fails, its child may already have opened
+   the files REDIRECTS names, and the forked child will open them again;
+   spawn_redirections only allows regular files, and files are opened only
+   if COMMAND should not fail with ENOEXEC, so the second open is harmless
+   and rare. */
+static pid_t
+spawn_disk_command (command, words, redirects, command_line, pipe_in, pipe_out, fds_to_close)
+     char *command;
+     WORD_LIST *words;
+     REDIRECT *redirects;
+     char *command_line;
+     int pipe_in, pipe_out;
+     struct fd_bitmap *fds_to_close;
+{
+  posix_spawn_file_actions_t actions;
+  char **args;
+  pid_t pid;
+  int fd, opens;
+
+  posix_spawn_file_actions_init (&actions);
+
+#if defined (BUFFERED_INPUT)
+  /* make_child closes the script the shell is reading, like this. */
+  if (default_buffered_input > 0)
+    posix_spawn_file_actions_addclose (&actions, default_buffered_input);
+#endif
+
+  /* Closing a descriptor that isn't open fails the spawn with some C
+     libraries, so only close the ones that are. */
+  if (fds_to_close)
+    for (fd = 0; fd < fds_to_close->size; fd++)
+      if (fds_to_close->bitmap[fd] && fcntl (fd, F_GETFD, 0) != -1)
+	posix_spawn_file_actions_addclose (&actions, fd);
+
+  /* The same as do_piping. */
+  if (pipe_in != NO_PIPE)
+    {
+      posix_spawn_file_actions_adddup2 (&actions, pipe_in, 0);
+      if (pipe_in > 0)
+	posix_spawn_file_actions_addclose (&actions, pipe_in);
+    }
+  if (pipe_out != NO_PIPE)
+    {
+      if (pipe_out != REDIRECT_BOTH)
+	{
+	  posix_spawn_file_actions_adddup2 (&actions, pipe_out, 1);
+	  if (pipe_out == 0 || pipe_out > 1)
+	    posix_spawn_file_actions_addclose (&actions, pipe_out);
+	}
+      else
+	posix_spawn_file_actions_adddup2 (&actions, 1, 2);
+    }
+
+  opens = 0;
+  if ((redirects && spawn_redirections (&actions, redirects, &opens) == 0) ||
+      (opens && spawn_exec_ok (command) == 0))
+    {
+      posix_spawn_file_actions_destroy (&actions);
+      return (-1);
+    }
+
+  args = strvec_from_word_list (words, 0, 0, (int *)NULL);
+  pid = spawn_child (savestring (command_line), command, args, export_env, &actions);
+  free (args);
+
+  posix_spawn_file_actions_destroy (&actions);
+  return (pid);
+}
+#endif /* SPAWN_DISK_COMMANDS */
+
 /* CPP defines to decide whether a particular index into the #! line
    corresponds to a valid interpreter name or argument character, or
    whitespace.  The MSDOS define is to allow \r to be treated the same
@@ -4932,7 +5160,7 @@ execute_intern_function (name, function)
       return (EXECUTION_FAILURE);
     }
 
-  var = find_function (name->word);
+  var = find_function_noload (name->word);
   if (var && (readonly_p (var) || noassign_p (var)))
     {
       if (readonly_p (var))
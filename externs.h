@@ -96,6 +96,8 @@ extern int read_command __P((void));
 
 /* Functions from logging.c */
 extern void initialize_logging __P((void));
+extern void flush_command_log __P((int));
+extern void discard_command_log __P((void));
 
 /* Functions from braces.c. */
 #if defined (BRACE_EXPANSION)
@@ -110,6 +112,7 @@ extern void reset_parser __P((void));
 extern WORD_LIST *parse_string_to_word_list __P((char *, int, const char *));
 
 extern void free_pushed_string_input __P((void));
+extern int parser_input_pending __P((void));
 
 extern char *decode_prompt_string __P((char *));
 
@@ -42,6 +42,7 @@
 #include "pathexp.h"
 #include "hashcmd.h"
 #include "findcmd.h"	/* matching prototypes and declarations */
+#include "pathindex.h"
 
 extern int posixly_correct;
 
@@ -61,6 +62,10 @@ static char *get_next_path_element __P((char *, int *));
    file, then we use this one. */
 static char *file_to_lose_on;
 
+/* Non-zero if find_in_path_element () skipped a directory because its
+   index showed it did not contain the file. */
+static int path_index_skipped;
+
 /* Non-zero if we should stat every command found in the hash table to
    make sure it still exists. */
 int check_hashed_filenames;
@@ -401,7 +406,8 @@ user_command_matches (name, flags, state)
 	  if (path_element == 0)
 	    break;
 
-	  match = find_in_path_element (name, path_element, flags, name_len, &dotinfo);
+	  /* Report every match even if an index is out of date. */
+	  match = find_in_path_element (name, path_element, flags|FS_NOINDEX, name_len, &dotinfo);
 
 	  free (path_element);
 
@@ -471,6 +477,15 @@ find_in_path_element (name, path, flags, name_len, dotinfop)
   if (dot_found_in_search == 0 && *xpath == '.')
     dot_found_in_search = same_file (".", xpath, dotinfop, (struct stat *)NULL);
 
+  /* Don't look for the file in a directory whose index lacks it. */
+  if ((flags & FS_NOINDEX) == 0 && path_index_lookup (xpath, name) == 0)
+    {
+      path_index_skipped = 1;
+      if (xpath != path)
+	free (xpath);
+      return ((char *)NULL);
+    }
+
   full_path = sh_makepath (xpath, name, 0);
 
   status = file_status (full_path);
@@ -559,6 +574,9 @@ find_user_command_in_path (name, path_list, flags)
     return (savestring (name));		/* XXX */
 
   file_to_lose_on = (char *)NULL;
+  path_index_skipped = 0;
+  if ((flags & FS_NOINDEX) == 0 && path_index_sync () == 0)
+    flags |= FS_NOINDEX;
   name_len = strlen (name);
   stat (".", &dotinfo);
   path_index = 0;
@@ -604,5 +622,11 @@ find_user_command_in_path (name, path_list, flags)
       file_to_lose_on = (char *)NULL;
     }
 
+  /* An index can only be out of date if the directory changed without the
+     shell being told, for instance when a symbolic link to it was changed.
+     Make sure the file really isn't there before saying so. */
+  if (file_to_lose_on == 0 && path_index_skipped)
+    return (find_user_command_in_path (name, path_list, flags|FS_NOINDEX));
+
   return (file_to_lose_on);
 }
@@ -44,7 +44,8 @@ void
 phash_create ()
 {
   if (hashed_filenames == 0)
-    hashed_filenames = hash_create (FILENAME_HASH_BUCKETS);
+    /* BASH_CMDS lists this table in hash order; see assoc_create */
+    hashed_filenames = hash_create_flags (FILENAME_HASH_BUCKETS, HASH_FNVKEYS|HASH_CHAINORDER);
 }
 
 static void
@@ -34,75 +34,153 @@
 #include "shell.h"
 #include "hashlib.h"
 
+/* Hash values are never 0, since 0 marks an empty bucket in hash_array. */
+#define HASH_VALUE(s, t, h) \
+  (((h) = ((t)->flags & HASH_FNVKEYS) ? hash_string_fnv (s) : hash_string (s)) \
+	? (h) : ((h) = 1))
+
 /* Rely on properties of unsigned division (unsigned/int -> unsigned) and
    don't discard the upper 32 bits of the value, if present. */
-#define HASH_BUCKET(s, t, h) (((h) = hash_string (s)) & ((t)->nbuckets - 1))
+#define HASH_BUCKET(s, t, h) (HASH_VALUE (s, t, h) & ((t)->nbuckets - 1))
+
+#define HASH_NEXT(t, b)	(((b) + 1) & ((t)->nbuckets - 1))
 
-static BUCKET_CONTENTS *copy_bucket_array __P((BUCKET_CONTENTS *, sh_string_func_t *));
+static unsigned int hash_string_fnv __P((const char *));
+static void hash_alloc_buckets __P((HASH_TABLE *, int));
+static void hash_grow __P((HASH_TABLE *));
+static int hash_lookup __P((const char *, HASH_TABLE *, unsigned int *));
+static void hash_delete_bucket __P((HASH_TABLE *, int));
+static BUCKET_CONTENTS *hash_add __P((char *, HASH_TABLE *, unsigned int));
+static BUCKET_CONTENTS *hash_copy_item __P((BUCKET_CONTENTS *, sh_string_func_t *));
 
-/* Make a new hash table with BUCKETS number of buckets.  Initialize
-   each slot in the table to NULL. */
+/* Make a new hash table with BUCKETS number of buckets, rounded up to a
+   power of two.  Initialize each slot in the table to NULL. */
 HASH_TABLE *
 hash_create (buckets)
      int buckets;
+{
+  return (hash_create_flags (buckets, 0));
+}
+
+/* Make a new hash table like hash_create.  FLAGS is kept in the table;
+   HASH_FNVKEYS makes it hash keys with hash_string_fnv, and
+   HASH_CHAINORDER makes it keep BUCKETS chains that hash_items lists. */
+HASH_TABLE *
+hash_create_flags (buckets, flags)
+     int buckets, flags;
 {
   HASH_TABLE *new_table;
-  register int i;
+  int n, i;
 
   new_table = (HASH_TABLE *)xmalloc (sizeof (HASH_TABLE));
   if (buckets == 0)
     buckets = DEFAULT_HASH_BUCKETS;
+  else
+    {
+      /* Probing masks hash values with nbuckets - 1. */
+      for (n = 1; n < buckets; n <<= 1)
+	;
+      buckets = n;
+    }
 
-  new_table->bucket_array =
-    (BUCKET_CONTENTS **)xmalloc (buckets * sizeof (BUCKET_CONTENTS *));
-  new_table->nbuckets = buckets;
+  hash_alloc_buckets (new_table, buckets);
   new_table->nentries = 0;
+  new_table->flags = flags;
 
-  for (i = 0; i < buckets; i++)
-    new_table->bucket_array[i] = (BUCKET_CONTENTS *)NULL;
+  new_table->chain_array = (BUCKET_CONTENTS **)NULL;
+  new_table->nchains = 0;
+  if (flags & HASH_CHAINORDER)
+    {
+      new_table->chain_array =
+	(BUCKET_CONTENTS **)xmalloc (buckets * sizeof (BUCKET_CONTENTS *));
+      new_table->nchains = buckets;
+      for (i = 0; i < buckets; i++)
+	new_table->chain_array[i] = (BUCKET_CONTENTS *)NULL;
+    }
 
   return (new_table);
 }
 
-int
-hash_size (table)
+/* Give TABLE BUCKETS empty buckets. */
+static void
+hash_alloc_buckets (table, buckets)
      HASH_TABLE *table;
+     int buckets;
 {
-  return (HASH_ENTRIES(table));
+  register int i;
+
+  table->bucket_array =
+    (BUCKET_CONTENTS **)xmalloc (buckets * sizeof (BUCKET_CONTENTS *));
+  table->hash_array = (unsigned int *)xmalloc (buckets * sizeof (unsigned int));
+  table->nbuckets = buckets;
+
+  for (i = 0; i < buckets; i++)
+    {
+      table->bucket_array[i] = (BUCKET_CONTENTS *)NULL;
+      table->hash_array[i] = 0;
+    }
 }
 
-static BUCKET_CONTENTS *
-copy_bucket_array (ba, cpdata)
-     BUCKET_CONTENTS *ba;
-     sh_string_func_t *cpdata;	/* data copy function */
+/* Double the number of buckets in TABLE.  The items are moved using their
+   saved hash values, so the keys are not hashed again. */
+static void
+hash_grow (table)
+     HASH_TABLE *table;
 {
-  BUCKET_CONTENTS *new_bucket, *n, *e;
+  BUCKET_CONTENTS **old_buckets;
+  unsigned int *old_hashes;
+  int old_size, start, n, i, bucket;
 
-  if (ba == 0)
-    return ((BUCKET_CONTENTS *)0);
+  old_buckets = table->bucket_array;
+  old_hashes = table->hash_array;
+  old_size = table->nbuckets;
 
-  for (n = (BUCKET_CONTENTS *)0, e = ba; e; e = e->next)
+  hash_alloc_buckets (table, old_size * 2);
+
+  /* Start just after an empty bucket, so that no run of full buckets is
+     split and items with the same key stay in the same order. */
+  for (start = 0; old_hashes[start]; start++)
+    ;
+  for (n = 1; n <= old_size; n++)
     {
-      if (n == 0)
-        {
-          new_bucket = (BUCKET_CONTENTS *)xmalloc (sizeof (BUCKET_CONTENTS));
-          n = new_bucket;
-        }
-      else
-        {
-          n->next = (BUCKET_CONTENTS *)xmalloc (sizeof (BUCKET_CONTENTS));
-          n = n->next;
-        }
-
-      n->key = savestring (e->key);
-      n->data = e->data ? (cpdata ? (*cpdata) (e->data) : savestring (e->data))
-			: NULL;
-      n->khash = e->khash;
-      n->times_found = e->times_found;
-      n->next = (BUCKET_CONTENTS *)NULL;
+      i = (start + n) & (old_size - 1);
+      if (old_hashes[i] == 0)
+	continue;
+      for (bucket = old_hashes[i] & (table->nbuckets - 1);
+	   table->hash_array[bucket];
+	   bucket = HASH_NEXT (table, bucket))
+	;
+      table->bucket_array[bucket] = old_buckets[i];
+      table->hash_array[bucket] = old_hashes[i];
     }
 
-  return new_bucket;  
+  free (old_buckets);
+  free (old_hashes);
+}
+
+int
+hash_size (table)
+     HASH_TABLE *table;
+{
+  return (HASH_ENTRIES(table));
+}
+
+/* Return a copy of the item E, copying its data with CPDATA. */
+static BUCKET_CONTENTS *
+hash_copy_item (e, cpdata)
+     BUCKET_CONTENTS *e;
+     sh_string_func_t *cpdata;
+{
+  BUCKET_CONTENTS *n;
+
+  n = (BUCKET_CONTENTS *)xmalloc (sizeof (BUCKET_CONTENTS));
+  n->next = n->prev = (BUCKET_CONTENTS *)NULL;
+  n->key = savestring (e->key);
+  n->data = e->data ? (cpdata ? (*cpdata) (e->data) : savestring (e->data))
+		    : NULL;
+  n->khash = e->khash;
+  n->times_found = e->times_found;
+  return n;
 }
 
 HASH_TABLE *
@@ -111,24 +189,82 @@ hash_copy (table, cpdata)
      sh_string_func_t *cpdata;
 {
   HASH_TABLE *new_table;
-  int i;
+  BUCKET_CONTENTS *e, *n, *last;
+  int i, bucket;
 
   if (table == 0)
     return ((HASH_TABLE *)NULL);
 
-  new_table = hash_create (table->nbuckets);
+  if (table->chain_array == 0)
+    {
+      new_table = hash_create_flags (table->nbuckets, table->flags);
+
+      /* The copy has the same number of buckets, so each item can go in
+	 the same bucket as the original. */
+      for (i = 0; i < table->nbuckets; i++)
+	if (table->bucket_array[i])
+	  {
+	    new_table->bucket_array[i] = hash_copy_item (table->bucket_array[i], cpdata);
+	    new_table->hash_array[i] = table->hash_array[i];
+	  }
+    }
+  else
+    {
+      new_table = hash_create_flags (table->nchains, table->flags);
+      if (new_table->nbuckets < table->nbuckets)
+	{
+	  free (new_table->bucket_array);
+	  free (new_table->hash_array);
+	  hash_alloc_buckets (new_table, table->nbuckets);
+	}
 
-  for (i = 0; i < table->nbuckets; i++)
-    new_table->bucket_array[i] = copy_bucket_array (table->bucket_array[i], cpdata);
+      /* Copy each chain in order.  Items with the same key are copied
+	 newest first, so probing puts them in the same order as in the
+	 original. */
+      for (i = 0; i < table->nchains; i++)
+	{
+	  last = (BUCKET_CONTENTS *)NULL;
+	  for (e = table->chain_array[i]; e; e = e->next)
+	    {
+	      n = hash_copy_item (e, cpdata);
+	      if (last)
+		last->next = n;
+	      else
+		new_table->chain_array[i] = n;
+	      n->prev = last;
+	      last = n;
+
+	      for (bucket = n->khash & (new_table->nbuckets - 1);
+		   new_table->hash_array[bucket];
+		   bucket = HASH_NEXT (new_table, bucket))
+		;
+	      new_table->bucket_array[bucket] = n;
+	      new_table->hash_array[bucket] = n->khash;
+	    }
+	}
+    }
 
   new_table->nentries = table->nentries;
   return new_table;
 }
 
+#if !defined (HASH_STRING_FNV)
+#  if SIZEOF_LONG == 8
+typedef unsigned long hash_word_t;
+#  elif defined (HAVE_UNSIGNED_LONG_LONG) && SIZEOF_LONG_LONG == 8
+typedef unsigned long long hash_word_t;
+#  else
+#    define HASH_STRING_FNV	/* no 64-bit type; use the old function */
+#  endif
+#endif
+
 /* The `khash' check below requires that strings that compare equally with
    strcmp hash to the same value. */
-unsigned int
-hash_string (s)
+
+/* The FNV-1 hash, a byte at a time.  Tables created with HASH_FNVKEYS
+   use it, and so does hash_string if HASH_STRING_FNV is defined. */
+static unsigned int
+hash_string_fnv (s)
      const char *s;
 {
   register unsigned int i;
@@ -147,6 +283,64 @@ hash_string (s)
   return i;
 }
 
+#if defined (HASH_STRING_FNV)
+unsigned int
+hash_string (s)
+     const char *s;
+{
+  return (hash_string_fnv (s));
+}
+#else /* !HASH_STRING_FNV */
+
+/* Odd 64-bit constants for multiplicative mixing, written so that they
+   don't need long long literals. */
+#define HASH_K1	(((hash_word_t)0x9e3779b9 << 32) | 0x7f4a7c15)
+#define HASH_K2	(((hash_word_t)0xc2b2ae3d << 32) | 0x27d4eb4f)
+
+#define HASH_ROTATE(w, n)	(((w) << (n)) | ((w) >> (64 - (n))))
+#define HASH_MIX(h, w) \
+  do { \
+    (h) ^= (w) * HASH_K2; \
+    (h) = HASH_ROTATE ((h), 31) * HASH_K1; \
+  } while (0)
+
+/* Hash eight bytes of S at a time.  Similarly-prefixed names like
+   vyatta_cfg_* differ in their last few bytes, so the final mixing step
+   spreads every input bit over the bits used to pick a bucket. */
+unsigned int
+hash_string (s)
+     const char *s;
+{
+  register hash_word_t h;
+  hash_word_t w;
+  size_t len;
+
+  len = strlen (s);
+  h = (hash_word_t)len * HASH_K1;
+
+  for ( ; len >= sizeof (w); len -= sizeof (w), s += sizeof (w))
+    {
+      memcpy (&w, s, sizeof (w));
+      HASH_MIX (h, w);
+    }
+
+  if (len)
+    {
+      w = 0;
+      memcpy (&w, s, len);
+      HASH_MIX (h, w);
+    }
+
+  h ^= h >> 33;
+  h *= HASH_K2;
+  h ^= h >> 29;
+  h *= HASH_K1;
+  h ^= h >> 32;
+
+  return ((unsigned int)h);
+}
+#endif /* !HASH_STRING_FNV */
+
 /* Return the location of the bucket which should contain the data
    for STRING.  TABLE is a pointer to a HASH_TABLE. */
 
@@ -160,6 +354,89 @@ hash_bucket (string, table)
   return (HASH_BUCKET (string, table, h));
 }
 
+/* Return the bucket holding STRING in TABLE, or -1 if it's not there.
+   The hash value of STRING is left in *HVP. */
+static int
+hash_lookup (string, table, hvp)
+     const char *string;
+     HASH_TABLE *table;
+     unsigned int *hvp;
+{
+  register int bucket;
+  unsigned int hv;
+
+  for (bucket = HASH_BUCKET (string, table, hv);
+       table->hash_array[bucket];
+       bucket = HASH_NEXT (table, bucket))
+    {
+      if (table->hash_array[bucket] == hv &&
+	  STREQ (table->bucket_array[bucket]->key, string))
+	{
+	  *hvp = hv;
+	  return bucket;
+	}
+    }
+
+  *hvp = hv;
+  return -1;
+}
+
+/* Add a new item for STRING, whose hash value is HV, to TABLE, growing
+   the table first if necessary. */
+static BUCKET_CONTENTS *
+hash_add (string, table, hv)
+     char *string;
+     HASH_TABLE *table;
+     unsigned int hv;
+{
+  BUCKET_CONTENTS *item, *new_item;
+  int bucket;
+
+  if ((table->nentries + 1) * 100 > table->nbuckets * HASH_MAXLOAD)
+    hash_grow (table);
+
+  new_item = item = (BUCKET_CONTENTS *)xmalloc (sizeof (BUCKET_CONTENTS));
+  item->next = item->prev = (BUCKET_CONTENTS *)NULL;
+  item->data = NULL;
+  item->key = string;
+  item->khash = hv;
+  item->times_found = 0;
+
+  /* hash_insert with HASH_NOSRCH can add a key that is already in the
+     table.  The newest item takes the place of the older one, which moves
+     further along, so that searches find the newest first as they did
+     when each bucket was a chain. */
+  for (bucket = hv & (table->nbuckets - 1);
+       table->hash_array[bucket];
+       bucket = HASH_NEXT (table, bucket))
+    {
+      if (table->hash_array[bucket] == hv &&
+	  STREQ (table->bucket_array[bucket]->key, string))
+	{
+	  BUCKET_CONTENTS *older;
+
+	  older = table->bucket_array[bucket];
+	  table->bucket_array[bucket] = item;
+	  item = older;
+	}
+    }
+
+  table->bucket_array[bucket] = item;
+  table->hash_array[bucket] = hv;
+  table->nentries++;
+
+  if (table->chain_array)
+    {
+      bucket = hv & (table->nchains - 1);
+      new_item->next = table->chain_array[bucket];
+      if (new_item->next)
+	new_item->next->prev = new_item;
+      table->chain_array[bucket] = new_item;
+    }
+
+  return (new_item);
+}
+
 /* Return a pointer to the hashed item.  If the HASH_CREATE flag is passed,
    create a new hash table entry for STRING, otherwise return NULL. */
 BUCKET_CONTENTS *
@@ -175,33 +452,49 @@ hash_search (string, table, flags)
   if (table == 0 || ((flags & HASH_CREATE) == 0 && HASH_ENTRIES (table) == 0))
     return (BUCKET_CONTENTS *)NULL;
 
-  bucket = HASH_BUCKET (string, table, hv);
-
-  for (list = table->bucket_array ? table->bucket_array[bucket] : 0; list; list = list->next)
+  bucket = hash_lookup (string, table, &hv);
+  if (bucket >= 0)
     {
-      if (hv == list->khash && STREQ (list->key, string))
-	{
-	  list->times_found++;
-	  return (list);
-	}
+      list = table->bucket_array[bucket];
+      list->times_found++;
+      return (list);
     }
 
   if (flags & HASH_CREATE)
-    {
-      list = (BUCKET_CONTENTS *)xmalloc (sizeof (BUCKET_CONTENTS));
-      list->next = table->bucket_array[bucket];
-      table->bucket_array[bucket] = list;
+    return (hash_add ((char *)string, table, hv));	/* XXX fix later */
+      
+  return (BUCKET_CONTENTS *)NULL;
+}
 
-      list->data = NULL;
-      list->key = (char *)string;	/* XXX fix later */
-      list->khash = hv;
-      list->times_found = 0;
+/* Empty BUCKET in TABLE, moving later items in the same run of full
+   buckets back so that none of them is separated from its home bucket
+   by an empty one. */
+static void
+hash_delete_bucket (table, bucket)
+     HASH_TABLE *table;
+     int bucket;
+{
+  register int next;
+  int home;
 
-      table->nentries++;
-      return (list);
+  for (next = HASH_NEXT (table, bucket);
+       table->hash_array[next];
+       next = HASH_NEXT (table, next))
+    {
+      home = table->hash_array[next] & (table->nbuckets - 1);
+      /* Leave the item where it is if its home bucket is cyclically
+	 between the empty bucket and its current position. */
+      if ((bucket < next) ? (home > bucket && home <= next)
+			  : (home > bucket || home <= next))
+	continue;
+      table->bucket_array[bucket] = table->bucket_array[next];
+      table->hash_array[bucket] = table->hash_array[next];
+      bucket = next;
     }
-      
-  return (BUCKET_CONTENTS *)NULL;
+
+  table->bucket_array[bucket] = (BUCKET_CONTENTS *)NULL;
+  table->hash_array[bucket] = 0;
+  table->nentries--;
 }
 
 /* Remove the item specified by STRING from the hash table TABLE.
@@ -214,29 +507,30 @@ hash_remove (string, table, flags)
      int flags;
 {
   int bucket;
-  BUCKET_CONTENTS *prev, *temp;
+  BUCKET_CONTENTS *temp;
   unsigned int hv;
 
   if (table == 0 || HASH_ENTRIES (table) == 0)
     return (BUCKET_CONTENTS *)NULL;
 
-  bucket = HASH_BUCKET (string, table, hv);
-  prev = (BUCKET_CONTENTS *)NULL;
-  for (temp = table->bucket_array[bucket]; temp; temp = temp->next)
-    {
-      if (hv == temp->khash && STREQ (temp->key, string))
-	{
-	  if (prev)
-	    prev->next = temp->next;
-	  else
-	    table->bucket_array[bucket] = temp->next;
+  bucket = hash_lookup (string, table, &hv);
+  if (bucket < 0)
+    return ((BUCKET_CONTENTS *) NULL);
 
-	  table->nentries--;
-	  return (temp);
-	}
-      prev = temp;
+  temp = table->bucket_array[bucket];
+  hash_delete_bucket (table, bucket);
+
+  if (table->chain_array)
+    {
+      if (temp->prev)
+	temp->prev->next = temp->next;
+      else
+	table->chain_array[hv & (table->nchains - 1)] = temp->next;
+      if (temp->next)
+	temp->next->prev = temp->prev;
+      temp->next = temp->prev = (BUCKET_CONTENTS *)NULL;
     }
-  return ((BUCKET_CONTENTS *) NULL);
+  return (temp);
 }
 
 /* Create an entry for STRING, in TABLE.  If the entry already
@@ -248,7 +542,6 @@ hash_insert (string, table, flags)
      int flags;
 {
   BUCKET_CONTENTS *item;
-  int bucket;
   unsigned int hv;
 
   if (table == 0)
@@ -258,20 +551,7 @@ hash_insert (string, table, flags)
   			       : hash_search (string, table, 0);
 
   if (item == 0)
-    {
-      bucket = HASH_BUCKET (string, table, hv);
-
-      item = (BUCKET_CONTENTS *)xmalloc (sizeof (BUCKET_CONTENTS));
-      item->next = table->bucket_array[bucket];
-      table->bucket_array[bucket] = item;
-
-      item->data = NULL;
-      item->key = string;
-      item->khash = hv;
-      item->times_found = 0;
-
-      table->nentries++;
-    }
+    item = hash_add (string, table, HASH_VALUE (string, table, hv));
 
   return (item);
 }
@@ -285,30 +565,31 @@ hash_flush (table, free_data)
      sh_free_func_t *free_data;
 {
   int i;
-  register BUCKET_CONTENTS *bucket, *item;
+  register BUCKET_CONTENTS *item;
 
   if (table == 0 || HASH_ENTRIES (table) == 0)
     return;
 
   for (i = 0; i < table->nbuckets; i++)
     {
-      bucket = table->bucket_array[i];
+      item = table->bucket_array[i];
+      if (item == 0)
+	continue;
 
-      while (bucket)
-	{
-	  item = bucket;
-	  bucket = bucket->next;
-
-	  if (free_data)
-	    (*free_data) (item->data);
-	  else
-	    free (item->data);
-	  free (item->key);
-	  free (item);
-	}
       table->bucket_array[i] = (BUCKET_CONTENTS *)NULL;
+      table->hash_array[i] = 0;
+
+      if (free_data)
+	(*free_data) (item->data);
+      else
+	free (item->data);
+      free (item->key);
+      free (item);
     }
 
+  for (i = 0; i < table->nchains; i++)
+    table->chain_array[i] = (BUCKET_CONTENTS *)NULL;
+
   table->nentries = 0;
 }
 
@@ -318,6 +599,8 @@ hash_dispose (table)
      HASH_TABLE *table;
 {
   free (table->bucket_array);
+  free (table->hash_array);
+  FREE (table->chain_array);
   free (table);
 }
 
@@ -346,26 +629,47 @@ hash_pstats (table, name)
      HASH_TABLE *table;
      char *name;
 {
-  register int slot, bcount;
-  register BUCKET_CONTENTS *bc;
+  register int slot, dist, maxdist, i;
+  long totdist;
+  int histo[8];
+  static const char *histo_labels[] = { "1", "2", "3", "4", "5-8", "9-16", "17-32", ">32" };
 
   if (name == 0)
     name = "unknown hash table";
 
   fprintf (stderr, "%s: %d buckets; %d items\n", name, table->nbuckets, table->nentries);
 
-  /* Print out a count of how many strings hashed to each bucket, so we can
-     see how even the distribution is. */
+  /* Print out how far each item is from the bucket its key hashes to, so
+     we can see how long the probe sequences are. */
+  for (i = 0; i < 8; i++)
+    histo[i] = 0;
+  totdist = maxdist = 0;
   for (slot = 0; slot < table->nbuckets; slot++)
     {
-      bc = hash_items (slot, table);
+      if (table->hash_array[slot] == 0)
+	continue;
+      dist = (slot - table->hash_array[slot]) & (table->nbuckets - 1);
+      totdist += dist;
+      if (dist > maxdist)
+	maxdist = dist;
+
+      /* histo[0..3] count probe lengths 1-4, then each slot doubles */
+      if (dist < 4)
+	i = dist;
+      else
+	for (i = 4; i < 7 && dist >= (1 << (i - 1)); i++)
+	  ;
+      histo[i]++;
+    }
 
-      fprintf (stderr, "\tslot %3d: ", slot);
-      for (bcount = 0; bc; bc = bc->next)
-	bcount++;
+  fprintf (stderr, "\tprobes: average %.2f; longest %d\n",
+	   table->nentries ? (double)totdist / table->nentries + 1 : 0.0,
+	   table->nentries ? maxdist + 1 : 0);
 
-      fprintf (stderr, "%d\n", bcount);
-    }
+  fprintf (stderr, "\tprobe lengths:");
+  for (i = 0; i < 8; i++)
+    fprintf (stderr, " %s:%d", histo_labels[i], histo[i]);
+  fprintf (stderr, "\n");
 }
 #endif
 
@@ -374,6 +678,7 @@ hash_pstats (table, name)
 /* link with xmalloc.o and lib/malloc/libmalloc.a */
 #undef NULL
 #include <stdio.h>
+#include "posixtime.h"
 
 #ifndef NULL
 #define NULL 0
@@ -402,12 +707,246 @@ fatal_error (const char *format, ...)
   abort();
 }
 
-main ()
+/* Microsecond timer for hash_benchmark */
+static double
+elapsed (start)
+     struct timeval *start;
+{
+  struct timeval now;
+
+  gettimeofday (&now, (struct timezone *)NULL);
+  return ((now.tv_sec - start->tv_sec) * 1e6 + (now.tv_usec - start->tv_usec));
+}
+
+/* The chained table the shell used before open addressing, kept so that
+   hash_benchmark can compare the two.  It has a fixed number of buckets,
+   adds new items at the head of each chain, and uses hash_string_fnv. */
+typedef struct chain_table {
+  BUCKET_CONTENTS **bucket_array;
+  int nbuckets;
+} CHAIN_TABLE;
+
+static CHAIN_TABLE *
+chain_create (buckets)
+     int buckets;
+{
+  CHAIN_TABLE *ct;
+  int i;
+
+  ct = (CHAIN_TABLE *)xmalloc (sizeof (CHAIN_TABLE));
+  ct->nbuckets = buckets;
+  ct->bucket_array = (BUCKET_CONTENTS **)xmalloc (buckets * sizeof (BUCKET_CONTENTS *));
+  for (i = 0; i < buckets; i++)
+    ct->bucket_array[i] = (BUCKET_CONTENTS *)NULL;
+  return ct;
+}
+
+static void
+chain_insert (string, ct)
+     char *string;
+     CHAIN_TABLE *ct;
+{
+  BUCKET_CONTENTS *item;
+  int bucket;
+
+  item = (BUCKET_CONTENTS *)xmalloc (sizeof (BUCKET_CONTENTS));
+  item->key = string;
+  item->data = NULL;
+  item->khash = hash_string_fnv (string);
+  item->times_found = 0;
+
+  bucket = item->khash & (ct->nbuckets - 1);
+  item->next = ct->bucket_array[bucket];
+  ct->bucket_array[bucket] = item;
+}
+
+static BUCKET_CONTENTS *
+chain_search (string, ct)
+     const char *string;
+     CHAIN_TABLE *ct;
+{
+  BUCKET_CONTENTS *list;
+  unsigned int hv;
+
+  hv = hash_string_fnv (string);
+  for (list = ct->bucket_array[hv & (ct->nbuckets - 1)]; list; list = list->next)
+    if (hv == list->khash && STREQ (list->key, string))
+      {
+	list->times_found++;
+	return (list);
+      }
+  return ((BUCKET_CONTENTS *)NULL);
+}
+
+static BUCKET_CONTENTS *
+chain_remove (string, ct)
+     const char *string;
+     CHAIN_TABLE *ct;
+{
+  BUCKET_CONTENTS *prev, *temp;
+  unsigned int hv;
+  int bucket;
+
+  hv = hash_string_fnv (string);
+  bucket = hv & (ct->nbuckets - 1);
+  prev = (BUCKET_CONTENTS *)NULL;
+  for (temp = ct->bucket_array[bucket]; temp; prev = temp, temp = temp->next)
+    if (hv == temp->khash && STREQ (temp->key, string))
+      {
+	if (prev)
+	  prev->next = temp->next;
+	else
+	  ct->bucket_array[bucket] = temp->next;
+	return (temp);
+      }
+  return ((BUCKET_CONTENTS *)NULL);
+}
+
+/* Searches and removals timed by hash_bench_table.  The chained table
+   takes time proportional to the number of keys for each one, so timing
+   one per key would take hours with a million keys. */
+#define BENCH_OPS	10000
+
+/* Time COUNT insertions of KEYS, then up to BENCH_OPS successful and
+   failed searches and removals, in the chained table if CHAINED is
+   non-zero and in a HASH_TABLE otherwise.  Both start with
+   DEFAULT_HASH_BUCKETS buckets.  Prints nanoseconds per operation. */
+static void
+hash_bench_table (keys, count, chained)
+     char **keys;
+     int count, chained;
+{
+  CHAIN_TABLE *ctable;
+  BUCKET_CONTENTS *item;
+  char buf[64];
+  struct timeval start;
+  double t_hash, t_insert, t_hit, t_miss, t_remove;
+  unsigned int h;
+  int i, nops;
+
+  nops = (count < BENCH_OPS) ? count : BENCH_OPS;
+
+  h = 0;
+  gettimeofday (&start, (struct timezone *)NULL);
+  for (i = 0; i < count; i++)
+    h ^= chained ? hash_string_fnv (keys[i]) : hash_string (keys[i]);
+  t_hash = elapsed (&start);
+  if (h == 1)		/* keep the loop from being optimized away */
+    putchar ('\n');
+
+  ctable = chained ? chain_create (DEFAULT_HASH_BUCKETS) : (CHAIN_TABLE *)NULL;
+  table = chained ? (HASH_TABLE *)NULL : hash_create (0);
+
+  gettimeofday (&start, (struct timezone *)NULL);
+  for (i = 0; i < count; i++)
+    if (chained)
+      chain_insert (keys[i], ctable);
+    else
+      hash_insert (keys[i], table, HASH_NOSRCH);
+  t_insert = elapsed (&start);
+
+  gettimeofday (&start, (struct timezone *)NULL);
+  for (i = 0; i < nops; i++)
+    {
+      h = (unsigned long)i * 7919 % count;
+      item = chained ? chain_search (keys[h], ctable) : hash_search (keys[h], table, 0);
+      if (item == 0)
+	abort ();
+    }
+  t_hit = elapsed (&start);
+
+  gettimeofday (&start, (struct timezone *)NULL);
+  for (i = 0; i < nops; i++)
+    {
+      sprintf (buf, "vyatta_cfg_miss_%d", i);
+      item = chained ? chain_search (buf, ctable) : hash_search (buf, table, 0);
+      if (item)
+	abort ();
+    }
+  t_miss = elapsed (&start);
+  if (chained == 0)
+    hash_pstats (table, "benchmark");
+
+  gettimeofday (&start, (struct timezone *)NULL);
+  for (i = 0; i < nops; i++)
+    free (chained ? chain_remove (keys[i], ctable) : hash_remove (keys[i], table, 0));
+  t_remove = elapsed (&start);
+
+  printf ("%8d keys: %-7s hash %5.1f  insert %7.1f  hit %9.1f  miss %9.1f  remove %9.1f ns/op\n",
+	  count, chained ? "chained" : "open",
+	  t_hash * 1000 / count, t_insert * 1000 / count,
+	  t_hit * 1000 / nops, t_miss * 1000 / nops, t_remove * 1000 / nops);
+
+  /* Free the items left in the table, but not their keys, which belong
+     to the caller. */
+  if (chained)
+    {
+      for (i = 0; i < ctable->nbuckets; i++)
+	while (item = ctable->bucket_array[i])
+	  {
+	    ctable->bucket_array[i] = item->next;
+	    free (item);
+	  }
+      free (ctable->bucket_array);
+      free (ctable);
+    }
+  else
+    {
+      for (i = 0; i < table->nbuckets; i++)
+	free (table->bucket_array[i]);
+      hash_dispose (table);
+    }
+}
+
+/* Run hash_bench_table on COUNT keys that look like the shell function
+   names in a large completion environment, first with the old chained
+   table and then with the current one. */
+static void
+hash_benchmark (count)
+     int count;
+{
+  char **keys, buf[64];
+  int i;
+
+  keys = (char **)xmalloc (count * sizeof (char *));
+  for (i = 0; i < count; i++)
+    {
+      sprintf (buf, (i & 1) ? "_vyatta_op_helper_%d" : "vyatta_cfg_node_%d", i);
+      keys[i] = savestring (buf);
+    }
+
+  hash_bench_table (keys, count, 1);
+  hash_bench_table (keys, count, 0);
+
+  for (i = 0; i < count; i++)
+    free (keys[i]);
+  free (keys);
+}
+
+/* With `-b', run hash_benchmark for the given numbers of keys (by
+   default 10000, 100000 and 1000000).  Otherwise add the lines read
+   from the standard input to a table and print its statistics. */
+main (argc, argv)
+     int argc;
+     char **argv;
 {
   char string[256];
   int count = 0;
   BUCKET_CONTENTS *tt;
 
+  if (argc > 1 && strcmp (argv[1], "-b") == 0)
+    {
+      if (argc == 2)
+	{
+	  hash_benchmark (10000);
+	  hash_benchmark (100000);
+	  hash_benchmark (1000000);
+	}
+      for (count = 2; count < argc; count++)
+	hash_benchmark (atoi (argv[count]));
+      exit (0);
+    }
+
   table = hash_create (0);
 
   for (;;)
@@ -417,6 +956,7 @@ main ()
 	break;
       if (!*string)
 	break;
+      string[strcspn (string, "\n")] = '\0';
       temp_string = savestring (string);
       tt = hash_insert (temp_string, table, 0);
       if (tt->times_found)
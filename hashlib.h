@@ -32,23 +32,37 @@
 #endif
 
 typedef struct bucket_contents {
-  struct bucket_contents *next;	/* Link to next hashed key in this bucket. */
+  struct bucket_contents *next;	/* Next item in the same chain. */
+  struct bucket_contents *prev;	/* Previous item in the same chain. */
   char *key;			/* What we look up. */
   PTR_T data;			/* What we really want. */
   unsigned int khash;		/* What key hashes to */
   int times_found;		/* Number of times this item has been found. */
 } BUCKET_CONTENTS;
 
+/* The table uses open addressing with linear probing.  hash_array holds
+   the hash value of the key in each bucket, or 0 if the bucket is empty,
+   so probing only looks at the keys whose hash values match.
+
+   Tables created with HASH_CHAINORDER also link their items into the
+   chains the table used before it used open addressing, with the newest
+   item first in each chain, and hash_items returns those chains, so
+   anything that lists the table lists it in the same order as before. */
 typedef struct hash_table {
   BUCKET_CONTENTS **bucket_array;	/* Where the data is kept. */
   int nbuckets;			/* How many buckets does this table have. */
   int nentries;			/* How many entries does this table have. */
+  unsigned int *hash_array;	/* Hash values of the keys in bucket_array. */
+  int flags;			/* Flags given to hash_create_flags. */
+  BUCKET_CONTENTS **chain_array;	/* HASH_CHAINORDER chains, or NULL. */
+  int nchains;			/* How many chains; never changes. */
 } HASH_TABLE;
 
 typedef int hash_wfunc __P((BUCKET_CONTENTS *));
 
 /* Operations on tables as a whole */
 extern HASH_TABLE *hash_create __P((int));
+extern HASH_TABLE *hash_create_flags __P((int, int));
 extern HASH_TABLE *hash_copy __P((HASH_TABLE *, sh_string_func_t *));
 extern void hash_flush __P((HASH_TABLE *, sh_free_func_t *));
 extern void hash_dispose __P((HASH_TABLE *));
@@ -66,21 +80,33 @@ extern BUCKET_CONTENTS *hash_remove __P((const char *, HASH_TABLE *, int));
 /* Miscellaneous */
 extern unsigned int hash_string __P((const char *));
 
-/* Redefine the function as a macro for speed. */
+/* Redefine the function as a macro for speed.  There are never more
+   chains than buckets. */
 #define hash_items(bucket, table) \
 	((table && (bucket < table->nbuckets)) ?  \
-		table->bucket_array[bucket] : \
+		(table->chain_array ? \
+			((bucket < table->nchains) ? table->chain_array[bucket] \
+						   : (BUCKET_CONTENTS *)NULL) : \
+			table->bucket_array[bucket]) : \
 		(BUCKET_CONTENTS *)NULL)
 
 /* Default number of buckets in the hash table. */
 #define DEFAULT_HASH_BUCKETS 64	/* was 107, then 53, must be power of two now */
 
+/* The number of buckets is doubled when more than HASH_MAXLOAD percent of
+   them would be in use. */
+#define HASH_MAXLOAD	75
+
 #define HASH_ENTRIES(ht)	((ht) ? (ht)->nentries : 0)
 
 /* flags for hash_search and hash_insert */
 #define HASH_NOSRCH	0x01
 #define HASH_CREATE	0x02
 
+/* flags for hash_create_flags */
+#define HASH_FNVKEYS	0x01	/* hash keys with the old FNV-1 function */
+#define HASH_CHAINORDER	0x02	/* list items in the old chained order */
+
 #if !defined (NULL)
 #  if defined (__STDC__)
 #    define NULL ((void *) 0)
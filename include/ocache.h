@@ -109,6 +109,61 @@ typedef struct objcache {
 			xfree (r); \
 	} while (0)
 
+/*
+ * An object pool hands out objects of a single type carved from blocks of
+ * several objects at a time, and keeps every object freed back to it on a
+ * list threaded through the objects themselves, so that a long run of
+ * allocations and frees costs one call to xmalloc per block rather than
+ * one per object.  Blocks are never returned to malloc, and objects taken
+ * from a pool must never be passed to free.  OTYPE must be at least as
+ * large as a pointer.
+ */
+typedef struct objpool {
+	PTR_T	free;		/* list of free objects */
+	int	bs;		/* block size, number of objects */
+	int	nb;		/* number of blocks allocated */
+} sh_obj_pool_t;
+
+/* Initialize an object pool P that allocates N objects at a time. */
+#define opool_create(p, otype, n) \
+	do { \
+		(p).free = 0; \
+		(p).bs = (n); \
+		(p).nb = 0; \
+	} while (0)
+
+/*
+ * Allocate a new item of type pointer to OTYPE from object pool P,
+ * allocating another block of items if the pool is empty.  Return the
+ * object in R.
+ */
+#define opool_alloc(p, otype, r) \
+	do { \
+		if ((p).free == 0) { \
+			register otype *ob; \
+			register int oi; \
+			ob = (otype *)xmalloc ((p).bs * sizeof (otype)); \
+			for (oi = (p).bs - 1; oi >= 0; oi--) { \
+				*(PTR_T *)(ob + oi) = (p).free; \
+				(p).free = (PTR_T)(ob + oi); \
+			} \
+			(p).nb++; \
+		} \
+		(r) = (otype *)(p).free; \
+		(p).free = *(PTR_T *)(r); \
+	} while (0)
+
+/*
+ * Return an item R of type pointer to OTYPE to object pool P.  The
+ * contents are scrambled.
+ */
+#define opool_free(p, otype, r) \
+	do { \
+		OC_MEMSET ((r), 0xdf, sizeof(otype)); \
+		*(PTR_T *)(r) = (p).free; \
+		(p).free = (PTR_T)(r); \
+	} while (0)
+
 /*
  * One may declare and use an object cache as (for instance):
  *
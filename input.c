@@ -211,6 +211,28 @@ copy_buffered_stream (bp)
   return (nbp);
 }
 
+/* Take the read builtin's stream away from FD.  File descriptors that are
+   dups of each other share one stream, as they share a file offset, so the
+   stream is freed only when no other file descriptor is using it. */
+static void
+release_read_stream (fd)
+     int fd;
+{
+  BUFFERED_STREAM *bp;
+  register int i;
+
+  bp = buffers[fd];
+  buffers[fd] = (BUFFERED_STREAM *)NULL;
+  for (i = 0; i < nbuffers; i++)
+    if (buffers[i] == bp)
+      {
+	bp->b_fd = i;
+	return;
+      }
+  free (bp->b_buffer);
+  free (bp);
+}
+
 int
 set_bash_input_fd (fd)
      int fd;
@@ -340,15 +362,22 @@ duplicate_buffered_stream (fd1, fd2)
 
   if (buffers[fd2])
     {
+      if (buffers[fd2]->b_flag & B_READBUF)
+	release_read_stream (fd2);
       /* If the two objects share the same b_buffer, don't free it. */
-      if (buffers[fd1] && buffers[fd1]->b_buffer && buffers[fd1]->b_buffer == buffers[fd2]->b_buffer)
+      else if (buffers[fd1] && buffers[fd1]->b_buffer && buffers[fd1]->b_buffer == buffers[fd2]->b_buffer)
 	buffers[fd2] = (BUFFERED_STREAM *)NULL;
       else
 	free_buffered_stream (buffers[fd2]);
     }
-  buffers[fd2] = copy_buffered_stream (buffers[fd1]);
-  if (buffers[fd2])
-    buffers[fd2]->b_fd = fd2;
+  if (buffers[fd1] && (buffers[fd1]->b_flag & B_READBUF))
+    buffers[fd2] = buffers[fd1];
+  else
+    {
+      buffers[fd2] = copy_buffered_stream (buffers[fd1]);
+      if (buffers[fd2])
+	buffers[fd2]->b_fd = fd2;
+    }
 
   if (is_bash_input)
     {
@@ -414,11 +443,19 @@ free_buffered_stream (bp)
   if (!bp)
     return;
 
-  n = bp->b_fd;
+  /* Dups of a file descriptor share the read builtin's stream. */
+  if (bp->b_flag & B_READBUF)
+    {
+      for (n = 0; n < nbuffers; n++)
+	if (buffers[n] == bp)
+	  buffers[n] = (BUFFERED_STREAM *)NULL;
+    }
+  else
+    buffers[bp->b_fd] = (BUFFERED_STREAM *)NULL;
+
   if (bp->b_buffer)
     free (bp->b_buffer);
   free (bp);
-  buffers[n] = (BUFFERED_STREAM *)NULL;
 }
 
 /* Close the file descriptor associated with BP, a buffered stream, and free
@@ -449,6 +486,11 @@ close_buffered_fd (fd)
     }
   if (fd >= nbuffers || !buffers || !buffers[fd])
     return (close (fd));
+  if (buffers[fd]->b_flag & B_READBUF)
+    {
+      release_read_stream (fd);
+      return (close (fd));
+    }
   return (close_buffered_stream (buffers[fd]));
 }
 
@@ -538,6 +580,97 @@ sync_buffered_stream (bfd)
   return (0);
 }
 
+/* Size of the buffers the read builtin uses for pipes. */
+#define READ_BUFFER_SIZE 8192
+
+/* The read builtin can't seek back over characters it reads past the
+   delimiter when its input is a pipe.  With `shopt -s readbuffer', it
+   reads from pipes through a buffered stream for the file descriptor
+   instead, and whatever is left over stays there for the next read.
+   Redirections share and discard these streams along with the file
+   descriptors they belong to.  Other processes, including subshells,
+   don't see what the shell has buffered: make_child discards the
+   streams in the child.
+
+   Return 1 if FD has a buffered stream for the read builtin, creating one
+   if CREATE is non-zero.  A stream left for a file descriptor that has
+   since been closed and reused for another file is thrown away, as is an
+   empty stream the caller doesn't want to create. */
+int
+check_read_stream (fd, create)
+     int fd, create;
+{
+  BUFFERED_STREAM *bp;
+  struct stat sb;
+
+  if (fd < 0 || fd_is_bash_input (fd) || fstat (fd, &sb) < 0)
+    return 0;
+
+  bp = (buffers && fd < nbuffers) ? buffers[fd] : (BUFFERED_STREAM *)NULL;
+  if (bp && (bp->b_flag & B_READBUF) == 0)
+    return 0;		/* something else is using FD */
+
+  if (bp && (bp->b_dev != sb.st_dev || bp->b_ino != sb.st_ino ||
+	     (create == 0 && bp->b_inputp == bp->b_used)))
+    {
+      release_read_stream (fd);
+      bp = (BUFFERED_STREAM *)NULL;
+    }
+
+  if (bp == 0 && create)
+    {
+      bp = make_buffered_stream (fd, (char *)xmalloc (READ_BUFFER_SIZE), READ_BUFFER_SIZE);
+      bp->b_flag |= B_READBUF;
+      bp->b_dev = sb.st_dev;
+      bp->b_ino = sb.st_ino;
+    }
+
+  return (bp != 0);
+}
+
+/* FD is about to be saved to NEW_FD so a redirection can be undone later.
+   Share the read builtin's stream for FD with NEW_FD, so buffered data
+   isn't lost when FD is redirected. */
+void
+save_read_stream (fd, new_fd)
+     int fd, new_fd;
+{
+  if (buffers && fd < nbuffers && buffers[fd] && (buffers[fd]->b_flag & B_READBUF))
+    duplicate_buffered_stream (fd, new_fd);
+}
+
+/* Throw away all of the read builtin's streams.  Called in a child just
+   after fork, so the child and its parent don't both return the input
+   the parent has buffered. */
+void
+discard_read_streams ()
+{
+  register int i;
+
+  for (i = 0; buffers && i < nbuffers; i++)
+    if (buffers[i] && (buffers[i]->b_flag & B_READBUF))
+      release_read_stream (i);
+}
+
+/* Read a character from FD's read builtin stream into *CP.  Return values
+   are as for zreadc(): 1 for a character, 0 at end of file, -1 on error. */
+ssize_t
+read_stream_getc (fd, cp)
+     int fd;
+     char *cp;
+{
+  BUFFERED_STREAM *bp;
+  int c;
+
+  bp = buffers[fd];
+  bp->b_fd = fd;	/* checked by check_read_stream; other dups might not be */
+  bp->b_flag &= ~(B_EOF|B_ERROR);
+  if ((c = bufstream_getc (bp)) == EOF)
+    return ((bp->b_flag & B_ERROR) ? -1 : 0);
+  *cp = c;
+  return 1;
+}
+
 int
 buffered_getchar ()
 {
@@ -48,6 +48,7 @@ enum stream_type {st_none, st_stdin, st_stream, st_string, st_bstream};
 #define B_ERROR		0x02
 #define B_UNBUFF	0x04
 #define B_WASBASHINPUT	0x08
+#define B_READBUF	0x10	/* read builtin's buffer for a pipe */
 
 /* A buffered stream.  Like a FILE *, but with our own buffering and
    synchronization.  Look in input.c for the implementation. */
@@ -59,6 +60,8 @@ typedef struct BSTREAM
   size_t b_used;		/* How much of the buffer we're using, */
   int	 b_flag;		/* Flag values. */
   size_t b_inputp;		/* The input pointer, index into b_buffer. */
+  dev_t	 b_dev;			/* For B_READBUF streams, the file the */
+  ino_t	 b_ino;			/* buffered data came from. */
 } BUFFERED_STREAM;
 
 #if 0
@@ -123,6 +126,10 @@ extern BUFFERED_STREAM *open_buffered_stream __P((char *));
 extern void free_buffered_stream __P((BUFFERED_STREAM *));
 extern int close_buffered_stream __P((BUFFERED_STREAM *));
 extern int close_buffered_fd __P((int));
+extern int check_read_stream __P((int, int));
+extern void save_read_stream __P((int, int));
+extern void discard_read_streams __P((void));
+extern ssize_t read_stream_getc __P((int, char *));
 extern int sync_buffered_stream __P((int));
 extern int buffered_getchar __P((void));
 extern int buffered_ungetchar __P((int));
@@ -39,6 +39,12 @@
 #  include <sys/resource.h>
 #endif /* !_POSIX_VERSION && HAVE_SYS_RESOURCE_H && HAVE_WAIT3 && !RLIMTYPE */
 
+/* Get the resource usage of each reaped child for the command log. */
+#if defined (HAVE_SYS_RESOURCE_H) && defined (HAVE_WAIT3) && defined (HAVE_GETRUSAGE)
+#  include <sys/resource.h>
+#  define WAITCHLD_RUSAGE
+#endif
+
 #if defined (HAVE_SYS_FILE_H)
 #  include <sys/file.h>
 #endif
@@ -68,11 +74,15 @@
 #include "shell.h"
 #include "jobs.h"
 #include "execute_cmd.h"
+#include "input.h"
 #include "flags.h"
 
 #include "builtins/builtext.h"
 #include "builtins/common.h"
 
+#include <utmp.h>
+#include "logmessage.h"
+
 #if !defined (errno)
 extern int errno;
 #endif /* !errno */
@@ -261,6 +271,7 @@ static void realloc_jobs_list __P((void));
 static int compact_jobs_list __P((int));
 static int discard_pipeline __P((PROCESS *));
 static void add_process __P((char *, pid_t));
+static void record_child __P((char *, pid_t, int));
 static void print_pipeline __P((PROCESS *, int, int, FILE *));
 static void pretty_print_job __P((int, int, FILE *));
 static void set_current_job __P((int));
@@ -1121,6 +1132,7 @@ add_process (name, pid)
   WSTATUS (t->status) = 0;
   t->running = PS_RUNNING;
   t->command = name;
+  gettimeofday (&t->starttime, NULL);	/* called right after the fork */
   the_pipeline = t;
 
   if (t->next == 0)
@@ -1672,6 +1684,72 @@ list_all_jobs (format)
   map_over_jobs (print_job, format, -1);
 }
 
+/* Do the parent's half of creating a child process: remember PID as the
+   proper pgrp if this is the first child and add it to the current
+   pipeline.  COMMAND is as for make_child. */
+static void
+record_child (command, pid, async_p)
+     char *command;
+     pid_t pid;
+     int async_p;
+{
+  if (first_pid == NO_PID)
+    first_pid = pid;
+  else if (pid_wrap == -1 && pid < first_pid)
+    pid_wrap = 0;
+  else if (pid_wrap == 0 && pid >= first_pid)
+    pid_wrap = 1;
+
+  if (job_control)
+    {
+      if (pipeline_pgrp == 0)
+	{
+	  pipeline_pgrp = pid;
+	  /* Don't twiddle terminal pgrps in the parent!  This is the bug,
+	     not the good thing of twiddling them in the child! */
+	  /* give_terminal_to (pipeline_pgrp, 0); */
+	}
+      /* This is done on the recommendation of the Rationale section of
+	 the POSIX 1003.1 standard, where it discusses job control and
+	 shells.  It is done to avoid possible race conditions. (Ref.
+	 1003.1 Rationale, section B.4.3.3, page 236). */
+      setpgid (pid, pipeline_pgrp);
+    }
+  else
+    {
+      if (pipeline_pgrp == 0)
+	pipeline_pgrp = shell_pgrp;
+    }
+
+  /* Place all processes into the jobs array regardless of the
+     state of job_control. */
+  add_process (command, pid);
+
+  if (async_p)
+    last_asynchronous_pid = pid;
+#if defined (RECYCLES_PIDS)
+  else if (last_asynchronous_pid == pid)
+    /* Avoid pid aliasing.  1 seems like a safe, unusual pid value. */
+    last_asynchronous_pid = 1;
+#endif
+
+  if (pid_wrap > 0)
+    delete_old_job (pid);
+
+#if !defined (RECYCLES_PIDS)
+  /* Only check for saved status if we've saved more than CHILD_MAX
+     statuses, unless the system recycles pids. */
+  if ((js.c_reaped + bgpids.npid) >= js.c_childmax)
+#endif
+    bgp_delete (pid);		/* new process, discard any saved status */
+
+  last_made_pid = pid;
+
+  /* keep stats */
+  js.c_totforked++;
+  js.c_living++;
+}
+
 /* Fork, handling errors.  Returns the pid of the newly made child, or 0.
    COMMAND is just for remembering the name of the command; we don't do
    anything else with it.  ASYNC_P says what to do with the tty.  If
@@ -1740,11 +1818,18 @@ make_child (command, async_p)
       pid_t mypid;
 
       mypid = getpid ();
+
+      /* The parent sends the log records buffered before the fork. */
+      discard_command_log ();
+
 #if defined (BUFFERED_INPUT)
       /* Close default_buffered_input if it's > 0.  We don't close it if it's
 	 0 because that's the file descriptor used when redirecting input,
 	 and it's wrong to close the file in that case. */
       unset_bash_input (0);
+
+      /* The parent keeps what the read builtin has buffered. */
+      discard_read_streams ();
 #endif /* BUFFERED_INPUT */
 
       /* Restore top-level signal mask. */
@@ -1824,73 +1909,82 @@ make_child (command, async_p)
     }
   else
     {
-      /* In the parent.  Remember the pid of the child just created
-	 as the proper pgrp if this is the first child. */
+      /* In the parent. */
+      record_child (command, pid, async_p);
 
-      if (first_pid == NO_PID)
-	first_pid = pid;
-      else if (pid_wrap == -1 && pid < first_pid)
-	pid_wrap = 0;
-      else if (pid_wrap == 0 && pid >= first_pid)
-	pid_wrap = 1;
+      /* Unblock SIGINT and SIGCHLD unless creating a pipeline, in which case
+	 SIGCHLD remains blocked until all commands in the pipeline have been
+	 created. */
+      sigprocmask (SIG_SETMASK, &oset, (sigset_t *)NULL);
+    }
 
-      if (job_control)
-	{
-	  if (pipeline_pgrp == 0)
-	    {
-	      pipeline_pgrp = pid;
-	      /* Don't twiddle terminal pgrps in the parent!  This is the bug,
-		 not the good thing of twiddling them in the child! */
-	      /* give_terminal_to (pipeline_pgrp, 0); */
-	    }
-	  /* This is done on the recommendation of the Rationale section of
-	     the POSIX 1003.1 standard, where it discusses job control and
-	     shells.  It is done to avoid possible race conditions. (Ref.
-	     1003.1 Rationale, section B.4.3.3, page 236). */
-	  setpgid (pid, pipeline_pgrp);
-	}
-      else
-	{
-	  if (pipeline_pgrp == 0)
-	    pipeline_pgrp = shell_pgrp;
-	}
+  return (pid);
+}
 
-      /* Place all processes into the jobs array regardless of the
-	 state of job_control. */
-      add_process (command, pid);
+#if defined (HAVE_POSIX_SPAWN)
+/* Start PATH with arguments ARGS and environment ENV using posix_spawn,
+   which can use vfork or clone instead of copying the shell's address
+   space.  The caller has made ACTIONS do the file descriptor work the
+   child would do after make_child; we make the signal mask and
+   dispositions match what restore_original_signals and
+   default_tty_job_signals would leave.  Only used for synchronous
+   commands when job control is not active, since the child can't set
+   its process group or take the terminal.  COMMAND is as for make_child.
+   Returns -1 if posix_spawn fails.  No child is left behind, but one may
+   have performed ACTIONS before execve failed; the caller can then fork
+   and report the error the usual way. */
+pid_t
+spawn_child (command, path, args, env, actions)
+     char *command, *path;
+     char **args, **env;
+     posix_spawn_file_actions_t *actions;
+{
+  posix_spawnattr_t attrs;
+  sigset_t set, oset, defsigs;
+  pid_t pid;
+  int r;
 
-      if (async_p)
-	last_asynchronous_pid = pid;
-#if defined (RECYCLES_PIDS)
-      else if (last_asynchronous_pid == pid)
-        /* Avoid pid aliasing.  1 seems like a safe, unusual pid value. */
-	last_asynchronous_pid = 1;
-#endif
+  sigemptyset (&set);
+  sigaddset (&set, SIGCHLD);
+  sigaddset (&set, SIGINT);
+  sigemptyset (&oset);
+  sigprocmask (SIG_BLOCK, &set, &oset);
 
-      if (pid_wrap > 0)
-	delete_old_job (pid);
+  making_children ();
 
-#if !defined (RECYCLES_PIDS)
-      /* Only check for saved status if we've saved more than CHILD_MAX
-	 statuses, unless the system recycles pids. */
-      if ((js.c_reaped + bgpids.npid) >= js.c_childmax)
-#endif
-	bgp_delete (pid);		/* new process, discard any saved status */
+#if defined (BUFFERED_INPUT)
+  if (default_buffered_input != -1)
+    sync_buffered_stream (default_buffered_input);
+#endif /* BUFFERED_INPUT */
 
-      last_made_pid = pid;
+  sigemptyset (&defsigs);
+  get_original_signal_defaults (&defsigs);
+  sigaddset (&defsigs, SIGTSTP);
+  sigaddset (&defsigs, SIGTTIN);
+  sigaddset (&defsigs, SIGTTOU);
 
-      /* keep stats */
-      js.c_totforked++;
-      js.c_living++;
+  posix_spawnattr_init (&attrs);
+  posix_spawnattr_setflags (&attrs, POSIX_SPAWN_SETSIGMASK|POSIX_SPAWN_SETSIGDEF|SPAWN_USEVFORK);
+  posix_spawnattr_setsigmask (&attrs, &top_level_mask);
+  posix_spawnattr_setsigdefault (&attrs, &defsigs);
 
-      /* Unblock SIGINT and SIGCHLD unless creating a pipeline, in which case
-	 SIGCHLD remains blocked until all commands in the pipeline have been
-	 created. */
+  r = posix_spawn (&pid, path, actions, &attrs, args, env);
+  posix_spawnattr_destroy (&attrs);
+
+  if (r != 0)
+    {
+      free (command);
       sigprocmask (SIG_SETMASK, &oset, (sigset_t *)NULL);
+      errno = r;
+      return (-1);
     }
 
+  record_child (command, pid, 0);
+  sigprocmask (SIG_SETMASK, &oset, (sigset_t *)NULL);
+
   return (pid);
 }
+#endif /* HAVE_POSIX_SPAWN */
 
 /* These two functions are called only in child processes. */
 void
@@ -2583,6 +2677,8 @@ if (job == NO_JOB)
 
 wait_for_return:
 
+  flush_command_log (0);
+
   UNBLOCK_CHILD (oset);
 
   /* Restore the original SIGINT signal handler before we return. */
@@ -3038,6 +3134,9 @@ waitchld (wpid, block)
   pid_t pid;
   int call_set_current, last_stopped_job, job, children_exited, waitpid_flags;
   static int wcontinued = WCONTINUED;	/* run-time fix for glibc problem */
+#if defined (WAITCHLD_RUSAGE)
+  struct rusage ru;
+#endif
 
   call_set_current = children_exited = 0;
   last_stopped_job = NO_JOB;
@@ -3060,7 +3159,11 @@ waitchld (wpid, block)
 	  waitpid_flags |= WNOHANG;
 	}
 
+#if defined (WAITCHLD_RUSAGE)
+      pid = wait3 (&status, waitpid_flags, &ru);
+#else
       pid = WAITPID (-1, &status, waitpid_flags);
+#endif
 
       /* WCONTINUED may be rejected by waitpid as invalid even when defined */
       if (wcontinued && pid < 0 && errno == EINVAL)
@@ -3122,7 +3225,11 @@ waitchld (wpid, block)
 
       if (PEXITED (child))
 	{
-	  log_process_exit (child);
+#if defined (WAITCHLD_RUSAGE)
+	  log_process_exit (child, &ru);
+#else
+	  log_process_exit (child, (struct rusage *)NULL);
+#endif
 	  js.c_totreaped++;
 	  if (job != NO_JOB)
 	    js.c_reaped++;
@@ -27,6 +27,17 @@
 #include "stdc.h"
 
 #include "posixwait.h"
+#include "posixtime.h"
+
+#if defined (HAVE_POSIX_SPAWN)
+#  include <spawn.h>
+/* Ask older versions of glibc to use vfork in posix_spawn. */
+#  if defined (POSIX_SPAWN_USEVFORK)
+#    define SPAWN_USEVFORK	POSIX_SPAWN_USEVFORK
+#  else
+#    define SPAWN_USEVFORK	0
+#  endif
+#endif
 
 /* Defines controlling the fashion in which jobs are listed. */
 #define JLIST_STANDARD       0
@@ -59,6 +70,7 @@ typedef struct process {
   WAIT status;		/* The status of this command as returned by wait. */
   int running;		/* Non-zero if this process is running. */
   char *command;	/* The particular program that is running. */
+  struct timeval starttime;	/* When the process was created. */
 } PROCESS;
 
 /* PALIVE really means `not exited' */
@@ -204,6 +216,9 @@ extern void list_stopped_jobs __P((int));
 extern void list_running_jobs __P((int));
 
 extern pid_t make_child __P((char *, int));
+#if defined (HAVE_POSIX_SPAWN)
+extern pid_t spawn_child __P((char *, char *, char **, char **, posix_spawn_file_actions_t *));
+#endif
 
 extern int get_tty_state __P((void));
 extern int set_tty_state __P((void));
@@ -113,6 +113,7 @@ static void wdequote_pathname __P((char *));
 #endif
 static void dequote_pathname __P((char *));
 static int glob_testdir __P((char *));
+static int glob_testdirent __P((char *, struct dirent *));
 static char **glob_dir_to_array __P((char *, char **, int));
 
 /* Compile `glob_loop.c' for single-byte characters. */
@@ -332,6 +333,25 @@ glob_testdir (dir)
   return (0);
 }
 
+/* Return 0 if DP, a directory entry whose full pathname is PATH, names a
+   directory, -1 otherwise.  Use the file type recorded in the entry if the
+   file system supplies one, so that globbing a large directory doesn't
+   stat every file in it; symbolic links and entries of unknown type still
+   have to be checked with stat. */
+static int
+glob_testdirent (path, dp)
+     char *path;
+     struct dirent *dp;
+{
+#if defined (HAVE_STRUCT_DIRENT_D_TYPE) && defined (DT_UNKNOWN)
+  if (dp->d_type == DT_DIR)
+    return (0);
+  if (dp->d_type != DT_UNKNOWN && dp->d_type != DT_LNK)
+    return (-1);
+#endif
+  return (glob_testdir (path));
+}
+
 /* Recursively scan SDIR for directories matching PAT (PAT is always `**').
    FLAGS is simply passed down to the recursive call to glob_vector.  Returns
    a list of matching directory names.  EP, if non-null, is set to the last
@@ -576,22 +596,27 @@ glob_vector (pat, dir, flags)
 	    continue;
 #endif
 
+	  /* Only names beginning with `.' are ever skipped, so don't bother
+	     converting the others to wide characters to check. */
+	  if (dp->d_name[0] == '.')
+	    {
 #if HANDLE_MULTIBYTE
-	  if (MB_CUR_MAX > 1 && mbskipname (pat, dp->d_name, flags))
-	    continue;
-	  else
+	      if (MB_CUR_MAX > 1 && mbskipname (pat, dp->d_name, flags))
+		continue;
+	      else
 #endif
-	  if (skipname (pat, dp->d_name, flags))
-	    continue;
+	      if (skipname (pat, dp->d_name, flags))
+		continue;
+	    }
 
 	  /* If we're only interested in directories, don't bother with files */
-	  if (flags & (GX_MATCHDIRS|GX_ALLDIRS))
+	  if (flags & GX_ALLDIRS)
 	    {
-	      pflags = (flags & GX_ALLDIRS) ? MP_RMDOT : 0;
+	      pflags = MP_RMDOT;
 	      if (flags & GX_NULLDIR)
 		pflags |= MP_IGNDOT;
 	      subdir = sh_makepath (dir, dp->d_name, pflags);
-	      isdir = glob_testdir (subdir);
+	      isdir = glob_testdirent (subdir, dp);
 	      if (isdir < 0 && (flags & GX_MATCHDIRS))
 		{
 		  free (subdir);
@@ -643,6 +668,17 @@ glob_vector (pat, dir, flags)
 	  convfn = fnx_fromfs (dp->d_name, D_NAMLEN (dp));
 	  if (strmatch (pat, convfn, mflags) != FNM_NOMATCH)
 	    {
+	      /* Only check the names that match whether they are
+		 directories. */
+	      if (flags & GX_MATCHDIRS)
+		{
+		  subdir = sh_makepath (dir, dp->d_name, (flags & GX_NULLDIR) ? MP_IGNDOT : 0);
+		  isdir = glob_testdirent (subdir, dp);
+		  free (subdir);
+		  if (isdir < 0)
+		    continue;
+		}
+
 	      if (nalloca < ALLOCA_MAX)
 		{
 		  nextlink = (struct globval *) alloca (sizeof (struct globval));
@@ -897,6 +933,8 @@ glob_filename (pathname, flags)
       if (directory_name[directory_len - 1] == '/')
 	directory_name[directory_len - 1] = '\0';
 
+      /* Only directories can have anything in them to match FILENAME. */
+      dflags |= GX_MATCHDIRS;
       directories = glob_filename (directory_name, dflags);
 
       if (free_dirname)
@@ -355,38 +355,505 @@ is_wcclass (wc, name)
 
 #endif /* HAVE_MULTIBYTE */
 
-int
-xstrmatch (pattern, string, flags)
+/* Compiled patterns.  The shell usually matches the same pattern against
+   many strings -- a `case' statement in a loop, [[ $x == pat ]], the calls
+   remove_pattern makes while looking for the longest or shortest match --
+   so xstrmatch keeps a cache of compiled patterns indexed by the pattern
+   and the flags.  A compiled pattern is one of a few literal forms matched
+   with string comparisons; a program of single-character tokens and `*'s
+   matched without recursion; or, for anything that needs the interpreter
+   above, the pattern and its wide-character translation. */
+
+#define SMK_GENERAL	0	/* use internal_strmatch or internal_wstrmatch */
+#define SMK_NEVER	1	/* matches nothing; ends with a backslash */
+#define SMK_ANY		2	/* `*' */
+#define SMK_LITERAL	3	/* `abc' */
+#define SMK_PREFIX	4	/* `abc*' */
+#define SMK_SUFFIX	5	/* `*abc' */
+#define SMK_INFIX	6	/* `*abc*' */
+#define SMK_PROGRAM	7	/* anything else made of tokens */
+
+#define SMT_CHAR	0
+#define SMT_ANY		1	/* `?' */
+#define SMT_STAR	2	/* `*' */
+#define SMT_BRACKET	3	/* `[...]' */
+
+/* Only these flags may be set for a pattern to be compiled. */
+#define SM_COMPILE_FLAGS	(FNM_NOESCAPE|FNM_CASEFOLD|FNM_EXTMATCH)
+
+#define SM_CACHE_SIZE	64
+
+typedef struct sm_token {
+  int type;
+  int c;			/* SMT_CHAR: the character, folded */
+  unsigned char *bracket;	/* SMT_BRACKET: the text following the `[' */
+  char *matches;		/* SMT_BRACKET: 0 unknown, 1 matches, 2 doesn't */
+} SM_TOKEN;
+
+typedef struct sm_pattern {
+  char *pattern;
+  int flags;
+  unsigned int hash;
+  int kind;
+  int ascii;			/* the pattern has only ASCII characters */
+  char *lit;			/* SMK_LITERAL...SMK_INFIX: the literal, folded */
+  size_t litlen;
+  SM_TOKEN *prog;		/* SMK_PROGRAM */
+  int nprog;
+#if HANDLE_MULTIBYTE
+  wchar_t *wpattern;
+  int wstate;			/* 0 not translated, 1 translated, -1 invalid */
+#endif
+} SM_PATTERN;
+
+#define SM_FOLD(c, flags) \
+  (((flags) & FNM_CASEFOLD) ? TOLOWER ((unsigned char)(c)) : (unsigned char)(c))
+
+static SM_PATTERN *sm_cache[SM_CACHE_SIZE];
+
+static unsigned char *sm_bracket_end __P((unsigned char *, int));
+static void sm_compile __P((SM_PATTERN *));
+static SM_PATTERN *sm_lookup __P((char *, int));
+static void sm_dispose __P((SM_PATTERN *));
+static int sm_litcmp __P((char *, char *, size_t, int));
+static int sm_bracket_match __P((SM_TOKEN *, int, int));
+static int sm_execute __P((SM_PATTERN *, char *));
+#if HANDLE_MULTIBYTE
+static int sm_unibyte __P((SM_PATTERN *, char *));
+static int sm_wexecute __P((SM_PATTERN *, char *));
+#endif
+
+/* P points just past the `[' starting a bracket expression.  If the
+   expression is one brackmatch handles in the usual way -- characters,
+   ranges, and known character classes, with no collating symbols or
+   equivalence classes -- return a pointer just past its closing `]'.
+   Otherwise return NULL. */
+static unsigned char *
+sm_bracket_end (p, flags)
+     unsigned char *p;
+     int flags;
+{
+  unsigned char *close;
+  char *ccname;
+  int c, r;
+
+  if (*p == '!' || *p == '^')
+    p++;
+
+  c = *p++;
+  for (;;)
+    {
+      if (c == '\0' || (c == '[' && (*p == '=' || *p == '.')))
+	return ((unsigned char *)NULL);
+
+      if (c == '[' && *p == ':')
+	{
+	  for (close = p + 1; *close; close++)
+	    if (*close == ':' && close[1] == ']')
+	      break;
+	  if (*close == '\0')
+	    return ((unsigned char *)NULL);
+
+	  ccname = (char *)xmalloc (close - p);
+	  strncpy (ccname, (char *)p + 1, close - p - 1);
+	  ccname[close - p - 1] = '\0';
+	  r = is_cclass (0, ccname);
+	  free (ccname);
+	  if (r == -1)
+	    return ((unsigned char *)NULL);
+
+	  p = close + 2;
+	  c = *p++;
+	  if (c == ']')
+	    return p;
+	  continue;
+	}
+
+      if ((flags & FNM_NOESCAPE) == 0 && c == '\\')
+	{
+	  if (*p == '\0')
+	    return ((unsigned char *)NULL);
+	  p++;
+	}
+
+      c = *p++;
+      if (c == '-' && *p != ']')
+	{
+	  c = *p++;
+	  if ((flags & FNM_NOESCAPE) == 0 && c == '\\')
+	    c = *p++;
+	  if (c == '\0' || (c == '[' && *p == '.'))
+	    return ((unsigned char *)NULL);
+	  c = *p++;
+	}
+
+      if (c == ']')
+	return p;
+    }
+}
+
+/* Compile SP->pattern into a token program, and recognize the programs
+   that are simple literal matches.  Leave SP->kind set to SMK_GENERAL if
+   the pattern uses anything the program cannot express. */
+static void
+sm_compile (sp)
+     SM_PATTERN *sp;
+{
+  unsigned char *p, *q;
+  SM_TOKEN *prog;
+  int flags, n, c, i, nstars;
+
+  flags = sp->flags;
+  sp->kind = SMK_GENERAL;
+
+  for (p = (unsigned char *)sp->pattern; *p && isascii (*p); p++)
+    ;
+  sp->ascii = *p == '\0';
+
+  if (flags & ~SM_COMPILE_FLAGS)
+    return;
+
+  prog = (SM_TOKEN *)xmalloc ((strlen (sp->pattern) + 1) * sizeof (SM_TOKEN));
+  n = nstars = 0;
+  for (p = (unsigned char *)sp->pattern; c = *p++; )
+    {
+      if ((flags & FNM_EXTMATCH) && *p == '(' &&
+	  (c == '+' || c == '*' || c == '?' || c == '@' || c == '!'))
+	goto general;
+
+      switch (c)
+	{
+	case '?':
+	  prog[n++].type = SMT_ANY;
+	  break;
+	case '*':
+	  if (n == 0 || prog[n - 1].type != SMT_STAR)
+	    {
+	      prog[n++].type = SMT_STAR;
+	      nstars++;
+	    }
+	  break;
+	case '[':
+	  q = sm_bracket_end (p, flags);
+	  if (q == 0)
+	    goto general;
+	  prog[n].type = SMT_BRACKET;
+	  prog[n].bracket = p;
+	  prog[n].matches = (char *)xmalloc (256);
+	  memset (prog[n].matches, 0, 256);
+	  n++;
+	  p = q;
+	  break;
+	case '\\':
+	  /* A trailing backslash never matches, even with FNM_NOESCAPE. */
+	  if (*p == '\0')
+	    {
+	      free (prog);
+	      sp->kind = SMK_NEVER;
+	      return;
+	    }
+	  if ((flags & FNM_NOESCAPE) == 0)
+	    c = *p++;
+	  /* FALLTHROUGH */
+	default:
+	  prog[n].type = SMT_CHAR;
+	  prog[n].c = SM_FOLD (c, flags);
+	  n++;
+	  break;
+	}
+    }
+
+  sp->prog = prog;
+  sp->nprog = n;
+  sp->kind = SMK_PROGRAM;
+
+  /* Look for the literal forms: no `?' or brackets, and `*' only at the
+     ends. */
+  for (i = 0; i < n; i++)
+    if (prog[i].type == SMT_ANY || prog[i].type == SMT_BRACKET ||
+	(prog[i].type == SMT_STAR && i != 0 && i != n - 1))
+      return;
+
+  if (nstars == 0)
+    sp->kind = SMK_LITERAL;
+  else if (n == 1)
+    sp->kind = SMK_ANY;
+  else if (nstars == 1)
+    sp->kind = (prog[0].type == SMT_STAR) ? SMK_SUFFIX : SMK_PREFIX;
+  else if ((flags & FNM_CASEFOLD) == 0)
+    sp->kind = SMK_INFIX;
+  else
+    return;
+
+  sp->lit = (char *)xmalloc (n + 1);
+  for (i = sp->litlen = 0; i < n; i++)
+    if (prog[i].type == SMT_CHAR)
+      sp->lit[sp->litlen++] = prog[i].c;
+  sp->lit[sp->litlen] = '\0';
+
+  free (prog);
+  sp->prog = (SM_TOKEN *)NULL;
+  sp->nprog = 0;
+  return;
+
+general:
+  for (i = 0; i < n; i++)
+    if (prog[i].type == SMT_BRACKET)
+      free (prog[i].matches);
+  free (prog);
+}
+
+static void
+sm_dispose (sp)
+     SM_PATTERN *sp;
+{
+  int i;
+
+  for (i = 0; i < sp->nprog; i++)
+    if (sp->prog[i].type == SMT_BRACKET)
+      free (sp->prog[i].matches);
+  if (sp->prog)
+    free (sp->prog);
+  if (sp->lit)
+    free (sp->lit);
+#if HANDLE_MULTIBYTE
+  if (sp->wpattern)
+    free (sp->wpattern);
+#endif
+  free (sp->pattern);
+  free (sp);
+}
+
+/* Return the compiled form of PATTERN with FLAGS, compiling it and
+   replacing whatever shared its cache slot if necessary. */
+static SM_PATTERN *
+sm_lookup (pattern, flags)
      char *pattern;
-     char *string;
      int flags;
 {
+  SM_PATTERN *sp;
+  unsigned char *p;
+  unsigned int hash;
+  int slot;
+
+  /* FNV-1a */
+  for (hash = 2166136261U, p = (unsigned char *)pattern; *p; p++)
+    hash = (hash ^ *p) * 16777619;
+  hash ^= flags;
+
+  slot = hash % SM_CACHE_SIZE;
+  sp = sm_cache[slot];
+  if (sp && sp->hash == hash && sp->flags == flags && strcmp (sp->pattern, pattern) == 0)
+    return sp;
+
+  if (sp)
+    sm_dispose (sp);
+
+  sp = (SM_PATTERN *)xmalloc (sizeof (SM_PATTERN));
+  memset (sp, 0, sizeof (SM_PATTERN));
+  sp->pattern = (char *)xmalloc (strlen (pattern) + 1);
+  strcpy (sp->pattern, pattern);
+  sp->flags = flags;
+  sp->hash = hash;
+  sm_compile (sp);
+
+  return (sm_cache[slot] = sp);
+}
+
+/* Throw away all compiled patterns.  The shell calls this when the locale
+   changes, since bracket expressions and case folding depend on it. */
+void
+strmatch_flush_cache ()
+{
+  int i;
+
+  for (i = 0; i < SM_CACHE_SIZE; i++)
+    if (sm_cache[i])
+      {
+	sm_dispose (sm_cache[i]);
+	sm_cache[i] = (SM_PATTERN *)NULL;
+      }
+}
+
+/* Compare the first N characters of S with the folded literal LIT. */
+static int
+sm_litcmp (s, lit, n, flags)
+     char *s, *lit;
+     size_t n;
+     int flags;
+{
+  size_t i;
+
+  if ((flags & FNM_CASEFOLD) == 0)
+    return (strncmp (s, lit, n));
+
+  for (i = 0; i < n; i++)
+    if (s[i] == '\0' || SM_FOLD (s[i], flags) != (unsigned char)lit[i])
+      return 1;
+  return 0;
+}
+
+/* Return non-zero if character C matches the bracket expression token T.
+   The answer for each character is found by brackmatch the first time it
+   is needed and remembered. */
+static int
+sm_bracket_match (t, c, flags)
+     SM_TOKEN *t;
+     int c, flags;
+{
+  if (t->matches[c] == 0)
+    t->matches[c] = brackmatch (t->bracket, c, flags) ? 1 : 2;
+  return (t->matches[c] == 1);
+}
+
+/* Match STRING against the compiled, non-general pattern SP, a byte at a
+   time.  A program is matched by remembering the last `*' and the point
+   in STRING it was tried at, and retrying one character later on a
+   mismatch; since every other token matches exactly one character, this
+   finds a match if there is one. */
+static int
+sm_execute (sp, string)
+     SM_PATTERN *sp;
+     char *string;
+{
+  SM_TOKEN *t, *te, *star;
+  unsigned char *s, *star_s;
+  size_t len;
+  int flags, c, m;
+
+  flags = sp->flags;
+  switch (sp->kind)
+    {
+    case SMK_NEVER:
+      return FNM_NOMATCH;
+    case SMK_ANY:
+      return 0;
+    case SMK_LITERAL:
+      return ((sm_litcmp (string, sp->lit, sp->litlen, flags) == 0 && string[sp->litlen] == '\0') ? 0 : FNM_NOMATCH);
+    case SMK_PREFIX:
+      return (sm_litcmp (string, sp->lit, sp->litlen, flags) == 0 ? 0 : FNM_NOMATCH);
+    case SMK_SUFFIX:
+      len = strlen (string);
+      return ((len >= sp->litlen && sm_litcmp (string + len - sp->litlen, sp->lit, sp->litlen, flags) == 0) ? 0 : FNM_NOMATCH);
+    case SMK_INFIX:
+      return (strstr (string, sp->lit) ? 0 : FNM_NOMATCH);
+    }
+
+  t = sp->prog;
+  te = t + sp->nprog;
+  star = (SM_TOKEN *)NULL;
+  star_s = (unsigned char *)NULL;
+  for (s = (unsigned char *)string; c = *s; )
+    {
+      if (t < te && t->type == SMT_STAR)
+	{
+	  star = t++;
+	  star_s = s;
+	  continue;
+	}
+
+      if (t < te)
+	{
+	  switch (t->type)
+	    {
+	    case SMT_CHAR:
+	      m = SM_FOLD (c, flags) == t->c;
+	      break;
+	    case SMT_BRACKET:
+	      m = sm_bracket_match (t, c, flags);
+	      break;
+	    default:		/* SMT_ANY */
+	      m = 1;
+	      break;
+	    }
+	  if (m)
+	    {
+	      t++;
+	      s++;
+	      continue;
+	    }
+	}
+
+      if (star == 0)
+	return FNM_NOMATCH;
+      t = star + 1;
+      s = ++star_s;
+    }
+
+  while (t < te && t->type == SMT_STAR)
+    t++;
+  return (t == te ? 0 : FNM_NOMATCH);
+}
+
 #if HANDLE_MULTIBYTE
-  int ret;
-  size_t n;
-  wchar_t *wpattern, *wstring;
+/* Return non-zero if matching STRING against SP a byte at a time gives the
+   same answer as matching wide characters.  That is true if neither has
+   any characters outside ASCII, and for some literal forms if only the
+   pattern is ASCII. */
+static int
+sm_unibyte (sp, string)
+     SM_PATTERN *sp;
+     char *string;
+{
+  unsigned char *s;
 
-  if (MB_CUR_MAX == 1)
-    return (internal_strmatch ((unsigned char *)pattern, (unsigned char *)string, flags));
+  if (sp->ascii == 0)
+    return 0;
+  if ((sp->flags & FNM_CASEFOLD) == 0 &&
+      (sp->kind == SMK_NEVER || sp->kind == SMK_ANY || sp->kind == SMK_LITERAL || sp->kind == SMK_PREFIX))
+    return 1;
 
-  n = xdupmbstowcs (&wpattern, NULL, pattern);
-  if (n == (size_t)-1 || n == (size_t)-2)
-    return (internal_strmatch ((unsigned char *)pattern, (unsigned char *)string, flags));
+  for (s = (unsigned char *)string; *s && isascii (*s); s++)
+    ;
+  return (*s == '\0');
+}
 
-  n = xdupmbstowcs (&wstring, NULL, string);
-  if (n == (size_t)-1 || n == (size_t)-2)
+/* Match STRING against SP as wide characters, translating the pattern
+   only the first time. */
+static int
+sm_wexecute (sp, string)
+     SM_PATTERN *sp;
+     char *string;
+{
+  wchar_t *wstring;
+  size_t n;
+  int ret;
+
+  if (sp->wstate == 0)
     {
-      free (wpattern);
-      return (internal_strmatch ((unsigned char *)pattern, (unsigned char *)string, flags));
+      n = xdupmbstowcs (&sp->wpattern, NULL, sp->pattern);
+      sp->wstate = (n == (size_t)-1 || n == (size_t)-2) ? -1 : 1;
     }
+  if (sp->wstate < 0)
+    return (internal_strmatch ((unsigned char *)sp->pattern, (unsigned char *)string, sp->flags));
 
-  ret = internal_wstrmatch (wpattern, wstring, flags);
+  n = xdupmbstowcs (&wstring, NULL, string);
+  if (n == (size_t)-1 || n == (size_t)-2)
+    return (internal_strmatch ((unsigned char *)sp->pattern, (unsigned char *)string, sp->flags));
 
-  free (wpattern);
+  ret = internal_wstrmatch (sp->wpattern, wstring, sp->flags);
   free (wstring);
 
   return ret;
-#else
-  return (internal_strmatch ((unsigned char *)pattern, (unsigned char *)string, flags));
-#endif /* !HANDLE_MULTIBYTE */
+}
+#endif /* HANDLE_MULTIBYTE */
+
+int
+xstrmatch (pattern, string, flags)
+     char *pattern;
+     char *string;
+     int flags;
+{
+  SM_PATTERN *sp;
+
+  sp = sm_lookup (pattern, flags);
+
+#if HANDLE_MULTIBYTE
+  if (MB_CUR_MAX > 1 && sm_unibyte (sp, string) == 0)
+    return (sm_wexecute (sp, string));
+#endif
+
+  if (sp->kind == SMK_GENERAL)
+    return (internal_strmatch ((unsigned char *)pattern, (unsigned char *)string, flags));
+  return (sm_execute (sp, string));
 }
@@ -59,4 +59,7 @@ extern int strmatch __P((char *, char *, int));
 extern int wcsmatch __P((wchar_t *, wchar_t *, int));
 #endif
 
+/* Discard the patterns strmatch has compiled, after a locale change. */
+extern void strmatch_flush_cache __P((void));
+
 #endif /* _STRMATCH_H */
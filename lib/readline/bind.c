@@ -1420,6 +1420,7 @@ static const struct {
   int *value;
   int flags;
 } boolean_varlist [] = {
+  { "batch-redisplay",		&_rl_batch_redisplay,		0 },
   { "bind-tty-special-chars",	&_rl_bind_stty_chars,		0 },
   { "blink-matching-paren",	&rl_blink_matching_paren,	V_SPECIAL },
   { "byte-oriented",		&rl_byte_oriented,		0 },
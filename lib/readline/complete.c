@@ -119,6 +119,7 @@ static char **remove_duplicate_matches PARAMS((char **));
 static void insert_match PARAMS((char *, int, int, char *));
 static int append_to_match PARAMS((char *, int, int, int));
 static void insert_all_matches PARAMS((char **, int, char *));
+static void display_match_list PARAMS((char **, int, int));
 static void display_matches PARAMS((char **));
 static int compute_lcd_of_matches PARAMS((char **, int, const char *));
 static int postprocess_matches PARAMS((char ***, int));
@@ -493,8 +494,8 @@ _rl_internal_pager (lines)
 {
   int i;
 
-  fprintf (rl_outstream, "--More--");
-  fflush (rl_outstream);
+  _rl_output_some_chars ("--More--", 8);
+  _rl_flush_output ();
   i = get_y_or_n (1);
   _rl_erase_entire_line ();
   if (i == 0)
@@ -703,7 +704,7 @@ fnprint (to_print, prefix_bytes)
 
       ellipsis = (to_print[prefix_bytes] == '.') ? '_' : '.';
       for (w = 0; w < ELLIPSIS_LEN; w++)
-	putc (ellipsis, rl_outstream);
+	_rl_output_char (ellipsis);
       printed_len = ELLIPSIS_LEN;
     }
 
@@ -712,8 +713,8 @@ fnprint (to_print, prefix_bytes)
     {
       if (CTRL_CHAR (*s))
         {
-          putc ('^', rl_outstream);
-          putc (UNCTRL (*s), rl_outstream);
+          _rl_output_char ('^');
+          _rl_output_char (UNCTRL (*s));
           printed_len += 2;
           s++;
 #if defined (HANDLE_MULTIBYTE)
@@ -722,8 +723,8 @@ fnprint (to_print, prefix_bytes)
         }
       else if (*s == RUBOUT)
 	{
-	  putc ('^', rl_outstream);
-	  putc ('?', rl_outstream);
+	  _rl_output_char ('^');
+	  _rl_output_char ('?');
 	  printed_len += 2;
 	  s++;
 #if defined (HANDLE_MULTIBYTE)
@@ -747,11 +748,11 @@ fnprint (to_print, prefix_bytes)
 	      w = wcwidth (wc);
 	      width = (w >= 0) ? w : 1;
 	    }
-	  fwrite (s, 1, tlen, rl_outstream);
+	  _rl_output_some_chars (s, tlen);
 	  s += tlen;
 	  printed_len += width;
 #else
-	  putc (*s, rl_outstream);
+	  _rl_output_char (*s);
 	  s++;
 	  printed_len++;
 #endif
@@ -847,7 +848,7 @@ print_filename (to_print, full_pathname, prefix_bytes)
       free (s);
       if (extension_char)
 	{
-	  putc (extension_char, rl_outstream);
+	  _rl_output_char (extension_char);
 	  printed_len++;
 	}
     }
@@ -1328,11 +1329,22 @@ postprocess_matches (matchesp, matching_filenames)
 /* A convenience function for displaying a list of strings in
    columnar format on readline's output stream.  MATCHES is the list
    of strings, in argv format, LEN is the number of strings in MATCHES,
-   and MAX is the length of the longest string in MATCHES. */
+   and MAX is the length of the longest string in MATCHES.  The list is
+   written out in one batch, or a page at a time when paging. */
 void
 rl_display_match_list (matches, len, max)
      char **matches;
      int len, max;
+{
+  _rl_begin_output ();
+  display_match_list (matches, len, max);
+  _rl_end_output ();
+}
+
+static void
+display_match_list (matches, len, max)
+     char **matches;
+     int len, max;
 {
   int count, limit, printed_len, lines;
   int i, j, k, l, common_length, sind;
@@ -1395,7 +1407,7 @@ rl_display_match_list (matches, len, max)
 
 		  if (j + 1 < limit)
 		    for (k = 0; k < max - printed_len; k++)
-		      putc (' ', rl_outstream);
+		      _rl_output_char (' ');
 		}
 	      l += count;
 	    }
@@ -1432,7 +1444,7 @@ rl_display_match_list (matches, len, max)
 		}
 	      else
 		for (k = 0; k < max - printed_len; k++)
-		  putc (' ', rl_outstream);
+		  _rl_output_char (' ');
 	    }
 	}
       rl_crlf ();
@@ -1500,7 +1512,7 @@ display_matches (matches)
     {
       rl_crlf ();
       fprintf (rl_outstream, "Display all %d possibilities? (y or n)", len);
-      fflush (rl_outstream);
+      _rl_flush_output ();
       if ((completion_y_or_n = get_y_or_n (0)) == 0)
 	{
 	  rl_crlf ();
@@ -513,6 +513,7 @@ rl_redisplay ()
      data structures. */
   _rl_block_sigint ();  
   RL_SETSTATE (RL_STATE_REDISPLAYING);
+  _rl_begin_output ();
 
   if (!rl_display_prompt)
     rl_display_prompt = "";
@@ -1077,7 +1078,7 @@ rl_redisplay ()
 #endif
 	    {
 #if defined (__MSDOS__)
-	      putc ('\r', rl_outstream);
+	      _rl_output_char ('\r');
 #else
 	      if (_rl_term_cr)
 		tputs (_rl_term_cr, 1, _rl_output_character_function);
@@ -1226,7 +1227,7 @@ rl_redisplay ()
 	  last_lmargin = lmargin;
 	}
     }
-  fflush (rl_outstream);
+  _rl_end_output ();
 
   /* Swap visible and non-visible lines. */
   {
@@ -1322,7 +1323,7 @@ update_line (old, new, current_line, omax, nmax, inv_botlin)
 	      int count, i;
 	      bytes = ret;
 	      for (count = 0; count < bytes; count++)
-		putc (new[count], rl_outstream);
+		_rl_output_char (new[count]);
 	      _rl_last_c_pos = tempwidth;
 	      _rl_last_v_pos++;
 	      memset (&ps, 0, sizeof (mbstate_t));
@@ -1341,7 +1342,7 @@ update_line (old, new, current_line, omax, nmax, inv_botlin)
 	    }
 	  else
 	    {
-	      putc (' ', rl_outstream);
+	      _rl_output_char (' ');
 	      _rl_last_c_pos = 1;
 	      _rl_last_v_pos++;
 	      if (old[0] && new[0])
@@ -1352,9 +1353,9 @@ update_line (old, new, current_line, omax, nmax, inv_botlin)
 #endif
 	{
 	  if (new[0])
-	    putc (new[0], rl_outstream);
+	    _rl_output_char (new[0]);
 	  else
-	    putc (' ', rl_outstream);
+	    _rl_output_char (' ');
 	  _rl_last_c_pos = 1;
 	  _rl_last_v_pos++;
 	  if (old[0] && new[0])
@@ -1519,7 +1520,7 @@ update_line (old, new, current_line, omax, nmax, inv_botlin)
       od >= lendiff && _rl_last_c_pos < PROMPT_ENDING_INDEX)
     {
 #if defined (__MSDOS__)
-      putc ('\r', rl_outstream);
+      _rl_output_char ('\r');
 #else
       tputs (_rl_term_cr, 1, _rl_output_character_function);
 #endif
@@ -1903,6 +1904,7 @@ _rl_move_cursor_relative (new, data)
   int woff;			/* number of invisible chars on current line */
   int cpos, dpos;		/* current and desired cursor positions */
   int adjust;
+  char *forward;
 
   woff = WRAP_OFFSET (_rl_last_v_pos, wrap_offset);
   cpos = _rl_last_c_pos;
@@ -1976,7 +1978,7 @@ _rl_move_cursor_relative (new, data)
       (_rl_term_autowrap && i == _rl_screenwidth))
     {
 #if defined (__MSDOS__)
-      putc ('\r', rl_outstream);
+      _rl_output_char ('\r');
 #else
       tputs (_rl_term_cr, 1, _rl_output_character_function);
 #endif /* !__MSDOS__ */
@@ -2006,19 +2008,25 @@ _rl_move_cursor_relative (new, data)
 	{
 	  if (_rl_term_forward_char)
 	    {
-	      for (i = cpos; i < dpos; i++)
-	        tputs (_rl_term_forward_char, 1, _rl_output_character_function);
+	      /* Move the whole distance with one sequence if the terminal
+		 has one and it is shorter than a sequence per column. */
+	      forward = (_rl_batch_redisplay && _rl_term_RI && dpos - cpos > 1) ? tgoto (_rl_term_RI, 0, dpos - cpos) : 0;
+	      if (forward && strlen (forward) < (dpos - cpos) * strlen (_rl_term_forward_char))
+		tputs (forward, 1, _rl_output_character_function);
+	      else
+		for (i = cpos; i < dpos; i++)
+		  tputs (_rl_term_forward_char, 1, _rl_output_character_function);
 	    }
 	  else
 	    {
 	      tputs (_rl_term_cr, 1, _rl_output_character_function);
 	      for (i = 0; i < new; i++)
-		putc (data[i], rl_outstream);
+		_rl_output_char (data[i]);
 	    }
 	}
       else
 	for (i = cpos; i < new; i++)
-	  putc (data[i], rl_outstream);
+	  _rl_output_char (data[i]);
     }
 
 #if defined (HANDLE_MULTIBYTE)
@@ -2046,9 +2054,9 @@ _rl_move_vert (to)
   if ((delta = to - _rl_last_v_pos) > 0)
     {
       for (i = 0; i < delta; i++)
-	putc ('\n', rl_outstream);
+	_rl_output_char ('\n');
 #if defined (__MSDOS__)
-      putc ('\r', rl_outstream);
+      _rl_output_char ('\r');
 #else
       tputs (_rl_term_cr, 1, _rl_output_character_function);
 #endif
@@ -2073,7 +2081,7 @@ rl_show_char (c)
   int n = 1;
   if (META_CHAR (c) && (_rl_output_meta_chars == 0))
     {
-      fprintf (rl_outstream, "M-");
+      _rl_output_some_chars ("M-", 2);
       n += 2;
       c = UNMETA (c);
     }
@@ -2084,13 +2092,13 @@ rl_show_char (c)
   if (CTRL_CHAR (c) || c == RUBOUT)
 #endif /* !DISPLAY_TABS */
     {
-      fprintf (rl_outstream, "C-");
+      _rl_output_some_chars ("C-", 2);
       n += 2;
       c = CTRL_CHAR (c) ? UNCTRL (c) : '?';
     }
 
-  putc (c, rl_outstream);
-  fflush (rl_outstream);
+  _rl_output_char (c);
+  _rl_flush_output ();
   return n;
 }
 
@@ -2305,7 +2313,7 @@ _rl_erase_at_end_of_line (l)
 
   _rl_backspace (l);
   for (i = 0; i < l; i++)
-    putc (' ', rl_outstream);
+    _rl_output_char (' ');
   _rl_backspace (l);
   for (i = 0; i < l; i++)
     visible_line[--_rl_last_c_pos] = '\0';
@@ -2333,7 +2341,7 @@ space_to_eol (count)
   register int i;
 
   for (i = 0; i < count; i++)
-   putc (' ', rl_outstream);
+   _rl_output_char (' ');
 
   _rl_last_c_pos += count;
 }
@@ -2445,11 +2453,11 @@ _rl_update_final ()
       cpos_buffer_position = -1;	/* don't know where we are in buffer */
       _rl_move_cursor_relative (_rl_screenwidth - 1, last_line);	/* XXX */
       _rl_clear_to_eol (0);
-      putc (last_line[_rl_screenwidth - 1], rl_outstream);
+      _rl_output_char (last_line[_rl_screenwidth - 1]);
     }
   _rl_vis_botlin = 0;
   rl_crlf ();
-  fflush (rl_outstream);
+  _rl_flush_output ();
   rl_display_fixed++;
 }
 
@@ -2460,7 +2468,7 @@ cr ()
   if (_rl_term_cr)
     {
 #if defined (__MSDOS__)
-      putc ('\r', rl_outstream);
+      _rl_output_char ('\r');
 #else
       tputs (_rl_term_cr, 1, _rl_output_character_function);
 #endif
@@ -2509,14 +2517,14 @@ _rl_redisplay_after_sigwinch ()
       _rl_move_vert (_rl_vis_botlin);
 
 #if defined (__MSDOS__)
-      putc ('\r', rl_outstream);
+      _rl_output_char ('\r');
 #else
       tputs (_rl_term_cr, 1, _rl_output_character_function);
 #endif
       _rl_last_c_pos = 0;
 #if defined (__MSDOS__)
       space_to_eol (_rl_screenwidth);
-      putc ('\r', rl_outstream);
+      _rl_output_char ('\r');
 #else
       if (_rl_term_clreol)
 	tputs (_rl_term_clreol, 1, _rl_output_character_function);
@@ -2547,7 +2555,7 @@ _rl_clean_up_for_exit ()
     {
       _rl_move_vert (_rl_vis_botlin);
       _rl_vis_botlin = 0;
-      fflush (rl_outstream);
+      _rl_flush_output ();
       rl_restart_output (1, 0);
     }
 }
@@ -2558,7 +2566,7 @@ _rl_erase_entire_line ()
   cr ();
   _rl_clear_to_eol (0);
   cr ();
-  fflush (rl_outstream);
+  _rl_flush_output ();
 }
 
 /* return the `current display line' of the cursor -- the number of lines to
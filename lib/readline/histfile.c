@@ -58,7 +58,7 @@
 #  undef HAVE_MMAP
 #endif
 
-#ifdef HISTORY_USE_MMAP
+#if defined (HISTORY_USE_MMAP) || defined (HAVE_MMAP)
 #  include <sys/mman.h>
 
 #  ifdef MAP_FILE
@@ -73,7 +73,18 @@
 #    define MAP_FAILED	((void *)-1)
 #  endif
 
-#endif /* HISTORY_USE_MMAP */
+#endif /* HISTORY_USE_MMAP || HAVE_MMAP */
+
+/* Whether to map the history file into memory to read it. */
+#if defined (HISTORY_USE_MMAP)
+#  define HISTORY_MAP_FILE	1
+#else
+#  define HISTORY_MAP_FILE	history_append_only
+#endif
+
+/* How many times to reopen a history file that another process replaced
+   while this one was waiting to lock it. */
+#define HISTORY_LOCK_TRIES	8
 
 /* If we're compiling for __EMX__ (OS/2) or __CYGWIN__ (cygwin32 environment
    on win 95/98/nt), we want to open files with O_BINARY mode so that there
@@ -102,6 +113,27 @@ extern int errno;
 /* If non-zero, we write timestamps to the history file in history_do_write() */
 int history_write_timestamps = 0;
 
+/* If non-zero, the history file may be shared by concurrent sessions.
+   Entries are only ever appended to it, under a shared lock; the file is
+   rewritten only when history_truncate_file finds it has grown to twice
+   the size it needs, and then it is replaced with rename () under an
+   exclusive lock rather than truncated.  The file is mapped into memory
+   to read it. */
+int history_append_only = 0;
+
+static int history_entry_line PARAMS((const char *, size_t));
+static size_t history_tail_offset PARAMS((char *, size_t, int, int *));
+static int history_lock_file PARAMS((int, int));
+static char *history_file_buffer PARAMS((int, size_t, int, int *, int *));
+static void history_free_buffer PARAMS((char *, size_t, int));
+static int history_open_locked PARAMS((const char *, int, int));
+static int history_write_data PARAMS((int, char *, size_t));
+static int history_replace_file PARAMS((const char *, struct stat *, char *, size_t));
+static int history_compact_file PARAMS((const char *, int));
+static int history_entries_size PARAMS((int));
+static int history_fill_entries PARAMS((char *, int));
+static int history_write_append_only PARAMS((const char *, int, int));
+
 /* Does S look like the beginning of a history timestamp entry?  Placeholder
    for more extensive tests. */
 #define HIST_TIMESTAMP_START(s)		(*(s) == history_comment_char && isdigit ((s)[1]) )
@@ -144,6 +176,260 @@ history_filename (filename)
   return (return_val);
 }
 
+/* Return non-zero if the LEN characters at LINE, a line of a history file
+   without its newline, make a history entry when the file is read.  Lines
+   that are empty once a trailing carriage return is removed and timestamp
+   lines do not. */
+static int
+history_entry_line (line, len)
+     const char *line;
+     size_t len;
+{
+  if (len == 0 || line[0] == '\0' || (len == 1 && line[0] == '\r'))
+    return 0;
+  return (HIST_TIMESTAMP_START (line) == 0);
+}
+
+/* Return the offset in BUFFER, the LEN bytes of a history file, of the line
+   following the entry before the last LINES entries, or 0 if the file has
+   no more than LINES entries.  Reading the file from there adds the same
+   last LINES entries, with the same timestamps, as reading all of it.  A
+   final line without a newline is not an entry.  If SKIPPED is non-null,
+   count the entries before the offset into it. */
+static size_t
+history_tail_offset (buffer, len, lines, skipped)
+     char *buffer;
+     size_t len;
+     int lines, *skipped;
+{
+  size_t start, end, offset;
+  int n;
+
+  for (end = len; end > 0 && buffer[end - 1] != '\n'; end--)
+    ;
+
+  /* Each time through, the line runs from START to the newline at END-1. */
+  for (n = 0; end > 0; end = start)
+    {
+      for (start = end - 1; start > 0 && buffer[start - 1] != '\n'; start--)
+	;
+      if (history_entry_line (buffer + start, end - 1 - start) && n++ == lines)
+	break;
+    }
+  offset = end;
+
+  if (skipped)
+    {
+      for (n = 0, start = 0; start < offset; start = end + 1)
+	{
+	  end = (char *)memchr (buffer + start, '\n', offset - start) - buffer;
+	  if (history_entry_line (buffer + start, end - start))
+	    n++;
+	}
+      *skipped = n;
+    }
+
+  return (offset);
+}
+
+/* Wait for a lock of TYPE on all of the file open on FD.  Returns 0, or
+   -1 if the file cannot be locked. */
+static int
+history_lock_file (fd, type)
+     int fd, type;
+{
+#if defined (F_SETLKW)
+  struct flock lock;
+  int r;
+
+  lock.l_type = type;
+  lock.l_whence = SEEK_SET;
+  lock.l_start = lock.l_len = 0;
+  while ((r = fcntl (fd, F_SETLKW, &lock)) < 0 && errno == EINTR)
+    ;
+  return r;
+#else
+  return -1;
+#endif
+}
+
+/* Read the SIZE bytes of the history file open on FD into a buffer that
+   may be modified, mapping the file if HISTORY_MAP_FILE says to.  A file
+   rewritten in place while it is mapped would fault on access, and that
+   is only done with the file write-locked, so the file is mapped only if
+   it can be locked with a lock of LOCKTYPE: F_RDLCK, or F_WRLCK if the
+   caller already holds that.  The lock lasts until FD is closed, which the
+   caller must not do before freeing the buffer.  Set *CHARS_READ to
+   the number of bytes read, or -1 if reading failed, and *MAPPED to
+   non-zero if the file was mapped.  Return the buffer, or NULL if there
+   is not enough memory for it. */
+static char *
+history_file_buffer (fd, size, locktype, chars_read, mapped)
+     int fd;
+     size_t size;
+     int locktype;
+     int *chars_read, *mapped;
+{
+  char *buffer;
+#if defined (HISTORY_USE_MMAP) || defined (HAVE_MMAP)
+  struct stat finfo;
+#endif
+
+  *mapped = 0;
+#if defined (HISTORY_USE_MMAP) || defined (HAVE_MMAP)
+  /* We map read/write and private so we can change newlines to NULs without
+     affecting the underlying object.  The file may have been rewritten
+     before we got the lock, so check that it is still SIZE bytes long. */
+  if (HISTORY_MAP_FILE && size > 0 && history_lock_file (fd, locktype) == 0 &&
+      fstat (fd, &finfo) == 0 && finfo.st_size >= size)
+    {
+      buffer = (char *)mmap (0, size, PROT_READ|PROT_WRITE, MAP_RFLAGS, fd, 0);
+      if ((void *)buffer != MAP_FAILED)
+	{
+	  *mapped = 1;
+	  *chars_read = size;
+	  return (buffer);
+	}
+    }
+#endif
+
+  buffer = (char *)malloc (size + 1);
+  if (buffer)
+    *chars_read = read (fd, buffer, size);
+  return (buffer);
+}
+
+/* Free BUFFER, returned by history_file_buffer for a file of SIZE bytes. */
+static void
+history_free_buffer (buffer, size, mapped)
+     char *buffer;
+     size_t size;
+     int mapped;
+{
+#if defined (HISTORY_USE_MMAP) || defined (HAVE_MMAP)
+  if (mapped)
+    {
+      munmap (buffer, size);
+      return;
+    }
+#endif
+  FREE (buffer);
+}
+
+/* Open the history file FILENAME with MODE and lock it with a lock of
+   TYPE: F_RDLCK to append to it, F_WRLCK to replace it.  If another
+   process replaced the file while this one waited for the lock, open the
+   new file instead.  A file that cannot be locked is returned unlocked. */
+static int
+history_open_locked (filename, mode, type)
+     const char *filename;
+     int mode, type;
+{
+#if defined (F_SETLKW)
+  int fd, tries;
+  struct stat fst, pst;
+
+  for (tries = 0; tries < HISTORY_LOCK_TRIES; tries++)
+    {
+      if ((fd = open (filename, mode, 0600)) < 0)
+	return fd;
+
+      if (history_lock_file (fd, type) < 0 ||
+	  (fstat (fd, &fst) == 0 && stat (filename, &pst) == 0 &&
+	   fst.st_dev == pst.st_dev && fst.st_ino == pst.st_ino))
+	return fd;
+      close (fd);
+    }
+#endif
+
+  return (open (filename, mode, 0600));
+}
+
+/* Write the LEN bytes at DATA to FD.  Returns 0 or errno. */
+static int
+history_write_data (fd, data, len)
+     int fd;
+     char *data;
+     size_t len;
+{
+  ssize_t n;
+
+  while (len > 0)
+    {
+      n = write (fd, data, len);
+      if (n < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  return (errno);
+	}
+      data += n;
+      len -= n;
+    }
+  return (0);
+}
+
+/* Replace the contents of the history file FILENAME, whose attributes are
+   in FINFO, with the LEN bytes at DATA.  They are written to a temporary
+   file that is renamed to FILENAME, so other processes see all of the old
+   file or all of the new one.  A symbolic link, or a file belonging to
+   someone else, is rewritten in place instead so that it keeps its link
+   and owner.  Returns 0 or errno. */
+static int
+history_replace_file (filename, finfo, data, len)
+     const char *filename;
+     struct stat *finfo;
+     char *data;
+     size_t len;
+{
+  char *tempname, *copy;
+  int file, rv;
+#if defined (HAVE_LSTAT) && defined (S_ISLNK)
+  struct stat linfo;
+#endif
+
+  if (finfo->st_uid != geteuid ()
+#if defined (HAVE_LSTAT) && defined (S_ISLNK)
+      || (lstat (filename, &linfo) == 0 && S_ISLNK (linfo.st_mode))
+#endif
+     )
+    {
+      /* DATA may be mapped from the file about to be truncated. */
+      copy = (char *)xmalloc (len + 1);
+      memcpy (copy, data, len);
+      if ((file = open (filename, O_WRONLY|O_TRUNC|O_BINARY, 0600)) < 0)
+	rv = errno;
+      else
+	{
+	  rv = history_write_data (file, copy, len);
+	  close (file);
+	}
+      free (copy);
+      return (rv);
+    }
+
+  tempname = (char *)xmalloc (strlen (filename) + 32);
+  sprintf (tempname, "%s-%ld.tmp", filename, (long)getpid ());
+  unlink (tempname);
+
+  if ((file = open (tempname, O_WRONLY|O_CREAT|O_EXCL|O_BINARY, 0600)) < 0)
+    rv = errno;
+  else
+    {
+      fchmod (file, finfo->st_mode & 07777);
+      rv = history_write_data (file, data, len);
+      if (close (file) < 0 && rv == 0)
+	rv = errno;
+      if (rv == 0 && rename (tempname, filename) < 0)
+	rv = errno;
+      if (rv)
+	unlink (tempname);
+    }
+
+  free (tempname);
+  return (rv);
+}
+
 /* Add the contents of FILENAME to the history list, a line at a time.
    If FILENAME is NULL, then read from ~/.history.  Returns 0 if
    successful, or errno if not. */
@@ -166,7 +452,7 @@ read_history_range (filename, from, to)
 {
   register char *line_start, *line_end, *p;
   char *input, *buffer, *bufend, *last_ts;
-  int file, current_line, chars_read;
+  int file, current_line, chars_read, mapped, whole_file, skipped;
   struct stat finfo;
   size_t file_size;
 #if defined (EFBIG)
@@ -178,6 +464,7 @@ read_history_range (filename, from, to)
 #endif
 
   buffer = last_ts = (char *)NULL;
+  mapped = 0;
   input = history_filename (filename);
   file = open (input, O_RDONLY|O_BINARY, 0666);
 
@@ -193,26 +480,13 @@ read_history_range (filename, from, to)
       goto error_and_exit;
     }
 
-#ifdef HISTORY_USE_MMAP
-  /* We map read/write and private so we can change newlines to NULs without
-     affecting the underlying object. */
-  buffer = (char *)mmap (0, file_size, PROT_READ|PROT_WRITE, MAP_RFLAGS, file, 0);
-  if ((void *)buffer == MAP_FAILED)
-    {
-      errno = overflow_errno;
-      goto error_and_exit;
-    }
-  chars_read = file_size;
-#else
-  buffer = (char *)malloc (file_size + 1);
+  buffer = history_file_buffer (file, file_size, F_RDLCK, &chars_read, &mapped);
   if (buffer == 0)
     {
       errno = overflow_errno;
       goto error_and_exit;
     }
 
-  chars_read = read (file, buffer, file_size);
-#endif
   if (chars_read < 0)
     {
   error_and_exit:
@@ -224,16 +498,18 @@ read_history_range (filename, from, to)
 	close (file);
 
       FREE (input);
-#ifndef HISTORY_USE_MMAP
-      FREE (buffer);
-#endif
+      if (buffer)
+	history_free_buffer (buffer, file_size, mapped);
 
       return (chars_read);
     }
 
-  close (file);
+  /* A mapped file stays open, and locked, until it is unmapped. */
+  if (mapped == 0)
+    close (file);
 
   /* Set TO to larger than end of file if negative. */
+  whole_file = from == 0 && to < 0;
   if (to < 0)
     to = chars_read;
 
@@ -253,6 +529,13 @@ read_history_range (filename, from, to)
 	line_start = p;
       }
 
+  /* Only the last history_max_entries entries of the whole file would be
+     left in a stifled history list, so start with those.  The others
+     are counted as though they had been added and dropped. */
+  skipped = 0;
+  if (whole_file && history_is_stifled () && history_max_entries > 0)
+    line_start += history_tail_offset (buffer, chars_read, history_max_entries, &skipped);
+
   /* If there are lines left to gobble, then gobble them now. */
   for (line_end = line_start; line_end < bufend; line_end++)
     if (*line_end == '\n')
@@ -289,19 +572,19 @@ read_history_range (filename, from, to)
 	line_start = line_end + 1;
       }
 
+  history_base += skipped;
+
   FREE (input);
-#ifndef HISTORY_USE_MMAP
-  FREE (buffer);
-#else
-  munmap (buffer, file_size);
-#endif
+  history_free_buffer (buffer, file_size, mapped);
+  if (mapped)
+    close (file);
 
   return (0);
 }
 
 /* Truncate the history file FNAME, leaving only LINES trailing lines.
    If FNAME is NULL, then use ~/.history.  Returns 0 on success, errno
-   on failure. */
+   on failure.  An append-only history file is compacted instead. */
 int
 history_truncate_file (fname, lines)
      const char *fname;
@@ -314,6 +597,14 @@ history_truncate_file (fname, lines)
 
   buffer = (char *)NULL;
   filename = history_filename (fname);
+
+  if (history_append_only)
+    {
+      rv = history_compact_file (filename, lines);
+      free (filename);
+      return rv;
+    }
+
   file = open (filename, O_RDONLY|O_BINARY, 0666);
   rv = 0;
 
@@ -417,6 +708,196 @@ history_truncate_file (fname, lines)
   return rv;
 }
 
+/* Return non-zero if the entries in the history file FNAME before its
+   last LINES take up at least as much room as those LINES do.  When the
+   history file is append-only, history_truncate_file rewrites it only
+   then, so the cost of rewriting it is spread over the entries appended
+   since it was last rewritten. */
+int
+history_file_oversized (fname, lines)
+     const char *fname;
+     int lines;
+{
+  char *filename, *buffer;
+  int file, chars_read, mapped, rv;
+  struct stat finfo;
+  size_t file_size, offset;
+
+  filename = history_filename (fname);
+  file = open (filename, O_RDONLY|O_BINARY, 0666);
+  free (filename);
+  if (file < 0)
+    return 0;
+
+  rv = 0;
+  if (lines >= 0 && fstat (file, &finfo) == 0 && S_ISREG (finfo.st_mode) &&
+      (file_size = (size_t)finfo.st_size) == finfo.st_size && file_size > 0 &&
+      (buffer = history_file_buffer (file, file_size, F_RDLCK, &chars_read, &mapped)))
+    {
+      if (chars_read > 0)
+	{
+	  offset = history_tail_offset (buffer, chars_read, lines, (int *)NULL);
+	  rv = offset > 0 && offset >= chars_read - offset;
+	}
+      history_free_buffer (buffer, file_size, mapped);
+    }
+
+  close (file);
+  return rv;
+}
+
+/* history_truncate_file () for an append-only history file: if
+   history_file_oversized () says so, replace FILENAME with its last LINES
+   entries.  Appends wait on the lock while this happens.  Returns 0 or
+   errno. */
+static int
+history_compact_file (filename, lines)
+     const char *filename;
+     int lines;
+{
+  char *buffer;
+  int file, chars_read, mapped, rv;
+  struct stat finfo;
+  size_t file_size, offset;
+
+  file = history_open_locked (filename, O_RDWR|O_BINARY, F_WRLCK);
+  if (file < 0)
+    return errno;
+
+  rv = 0;
+  if (fstat (file, &finfo) == -1)
+    rv = errno;
+  else if (S_ISREG (finfo.st_mode) == 0)
+#ifdef EFTYPE
+    rv = EFTYPE;
+#else
+    rv = EINVAL;
+#endif
+  else if (lines >= 0 && (file_size = (size_t)finfo.st_size) == finfo.st_size && file_size > 0)
+    {
+      buffer = history_file_buffer (file, file_size, F_WRLCK, &chars_read, &mapped);
+      if (buffer == 0 || chars_read < 0)
+	rv = errno;
+      else
+	{
+	  offset = history_tail_offset (buffer, chars_read, lines, (int *)NULL);
+	  if (offset > 0 && offset >= chars_read - offset)
+	    rv = history_replace_file (filename, &finfo, buffer + offset, chars_read - offset);
+	}
+      if (buffer)
+	history_free_buffer (buffer, file_size, mapped);
+    }
+
+  close (file);		/* releases the lock */
+  return rv;
+}
+
+/* Return the number of bytes needed to write the history entries from
+   FIRST to the end of the list to the history file. */
+static int
+history_entries_size (first)
+     int first;
+{
+  HIST_ENTRY **the_history;
+  register int i;
+  int size;
+
+  the_history = history_list ();
+  for (size = 0, i = first; i < history_length; i++)
+    {
+      if (history_write_timestamps && the_history[i]->timestamp && the_history[i]->timestamp[0])
+	size += strlen (the_history[i]->timestamp) + 1;
+      size += strlen (the_history[i]->line) + 1;
+    }
+  return size;
+}
+
+/* Copy the history entries from FIRST to the end of the list to BUFFER as
+   they are written to the history file.  Returns the number of bytes. */
+static int
+history_fill_entries (buffer, first)
+     char *buffer;
+     int first;
+{
+  HIST_ENTRY **the_history;
+  register int i, j;
+
+  the_history = history_list ();
+  for (j = 0, i = first; i < history_length; i++)
+    {
+      if (history_write_timestamps && the_history[i]->timestamp && the_history[i]->timestamp[0])
+	{
+	  strcpy (buffer + j, the_history[i]->timestamp);
+	  j += strlen (the_history[i]->timestamp);
+	  buffer[j++] = '\n';
+	}
+      strcpy (buffer + j, the_history[i]->line);
+      j += strlen (the_history[i]->line);
+      buffer[j++] = '\n';
+    }
+  return j;
+}
+
+/* history_do_write () for an append-only history file.  Appended entries
+   go to the end of the file in a single write (2), so they are not mixed
+   with entries other sessions append at the same time, and are preceded
+   by a newline if the last session to write the file died in the middle
+   of a line.  Overwriting the file replaces it as compacting it does. */
+static int
+history_write_append_only (filename, nelements, overwrite)
+     const char *filename;
+     int nelements, overwrite;
+{
+  char *output, *buffer, c;
+  int file, rv, buffer_size, j;
+  struct stat finfo;
+
+  output = history_filename (filename);
+  if (overwrite)
+    file = history_open_locked (output, O_RDWR|O_CREAT|O_BINARY, F_WRLCK);
+  else
+    file = history_open_locked (output, O_RDWR|O_APPEND|O_BINARY, F_RDLCK);
+
+  if (file == -1)
+    {
+      rv = errno;
+      FREE (output);
+      return (rv);
+    }
+
+  if (nelements > history_length)
+    nelements = history_length;
+
+  /* Leave room for a leading newline. */
+  buffer_size = history_entries_size (history_length - nelements) + 1;
+  buffer = (char *)malloc (buffer_size);
+  if (buffer == 0)
+    {
+      rv = errno;
+      FREE (output);
+      close (file);
+      return (rv);
+    }
+
+  j = 0;
+  if (overwrite == 0 && lseek (file, (off_t)-1, SEEK_END) >= 0 && read (file, &c, 1) == 1 && c != '\n')
+    buffer[j++] = '\n';
+  j += history_fill_entries (buffer + j, history_length - nelements);
+
+  if (overwrite == 0)
+    rv = history_write_data (file, buffer, j);
+  else if (fstat (file, &finfo) == 0)
+    rv = history_replace_file (output, &finfo, buffer, j);
+  else
+    rv = errno;
+
+  free (buffer);
+  close (file);
+  FREE (output);
+
+  return (rv);
+}
+
 /* Workhorse function for writing history.  Writes NELEMENT entries
    from the history list to FILENAME.  OVERWRITE is non-zero if you
    wish to replace FILENAME with the entries. */
@@ -425,12 +906,16 @@ history_do_write (filename, nelements, overwrite)
      const char *filename;
      int nelements, overwrite;
 {
-  register int i;
   char *output;
   int file, mode, rv;
 #ifdef HISTORY_USE_MMAP
   size_t cursize;
+#endif
+
+  if (history_append_only)
+    return (history_write_append_only (filename, nelements, overwrite));
 
+#ifdef HISTORY_USE_MMAP
   mode = overwrite ? O_RDWR|O_CREAT|O_TRUNC|O_BINARY : O_RDWR|O_APPEND|O_BINARY;
 #else
   mode = overwrite ? O_WRONLY|O_CREAT|O_TRUNC|O_BINARY : O_WRONLY|O_APPEND|O_BINARY;
@@ -454,23 +939,11 @@ history_do_write (filename, nelements, overwrite)
   /* Build a buffer of all the lines to write, and write them in one syscall.
      Suggested by Peter Ho (peter@robosts.oxford.ac.uk). */
   {
-    HIST_ENTRY **the_history;	/* local */
-    register int j;
     int buffer_size;
     char *buffer;
 
-    the_history = history_list ();
     /* Calculate the total number of bytes to write. */
-    for (buffer_size = 0, i = history_length - nelements; i < history_length; i++)
-#if 0
-      buffer_size += 2 + HISTENT_BYTES (the_history[i]);
-#else
-      {
-	if (history_write_timestamps && the_history[i]->timestamp && the_history[i]->timestamp[0])
-	  buffer_size += strlen (the_history[i]->timestamp) + 1;
-	buffer_size += strlen (the_history[i]->line) + 1;
-      }
-#endif
+    buffer_size = history_entries_size (history_length - nelements);
 
     /* Allocate the buffer, and fill it. */
 #ifdef HISTORY_USE_MMAP
@@ -496,18 +969,7 @@ mmap_error:
       }
 #endif
 
-    for (j = 0, i = history_length - nelements; i < history_length; i++)
-      {
-	if (history_write_timestamps && the_history[i]->timestamp && the_history[i]->timestamp[0])
-	  {
-	    strcpy (buffer + j, the_history[i]->timestamp);
-	    j += strlen (the_history[i]->timestamp);
-	    buffer[j++] = '\n';
-	  }
-	strcpy (buffer + j, the_history[i]->line);
-	j += strlen (the_history[i]->line);
-	buffer[j++] = '\n';
-      }
+    history_fill_entries (buffer, history_length - nelements);
 
 #ifdef HISTORY_USE_MMAP
     if (msync (buffer, buffer_size, 0) != 0 || munmap (buffer, buffer_size) != 0)
@@ -79,4 +79,21 @@ extern char *strchr ();
 /* Some variable definitions shared across history source files. */
 extern int history_offset;
 
+/* The history index keeps, for each entry in the history list, the length
+   of its line and a signature with a bit set for each pair of adjacent
+   characters in it (the first pair is a NUL and the first character).
+   A line can only contain a string if it is at least as long and its
+   signature has all the bits of the string's signature, so searches
+   only need to look at the text of lines that pass that test. */
+typedef struct _hist_index {
+  unsigned long sig;
+  int len;
+} HIST_INDEX;
+
+#define HIST_INDEX_MATCH(x, s, l)	((x)->len >= (l) && ((x)->sig & (s)) == (s))
+
+extern HIST_INDEX *_hs_history_index PARAMS((void));
+extern unsigned long _hs_history_signature PARAMS((const char *, int, int));
+extern void _hs_history_index_set PARAMS((int));
+
 #endif /* !_HISTLIB_H_ */
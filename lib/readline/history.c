@@ -84,6 +84,18 @@ int history_length;
 /* The logical `base' of the history array.  It defaults to 1. */
 int history_base = 1;
 
+/* The index of the history list used by the search functions:
+   HISTORY_INDEX[i] describes the_history[i].  It is built the first time
+   something searches the history, and from then on the functions that
+   change the_history keep it current. */
+static HIST_INDEX *history_index;
+static int history_index_size;
+static int history_index_valid;
+
+#define HIST_SIG_BITS	(sizeof (unsigned long) * 8)
+#define HIST_SIG_BIT(a, b) \
+  (1UL << (((unsigned char)(a) * 37 + (unsigned char)(b)) % HIST_SIG_BITS))
+
 /* Return the current HISTORY_STATE of the history. */
 HISTORY_STATE *
 history_get_history_state ()
@@ -113,6 +125,7 @@ history_set_history_state (state)
   history_size = state->size;
   if (state->flags & HS_STIFLED)
     history_stifled = 1;
+  history_index_valid = 0;
 }
 
 /* Begin a session in which the history functions might be used.  This
@@ -282,6 +295,8 @@ add_history (string)
       /* Copy the rest of the entries, moving down one slot. */
       for (i = 0; i < history_length; i++)
 	the_history[i] = the_history[i + 1];
+      if (history_index_valid)
+	memmove (history_index, history_index + 1, (history_length - 1) * sizeof (HIST_INDEX));
 
       history_base++;
     }
@@ -309,6 +324,7 @@ add_history (string)
 
   the_history[history_length] = (HIST_ENTRY *)NULL;
   the_history[history_length - 1] = temp;
+  _hs_history_index_set (history_length - 1);
 }
 
 /* Change the time stamp of the most recent history entry to STRING. */
@@ -383,6 +399,7 @@ replace_history_entry (which, line, data)
   temp->data = data;
   temp->timestamp = savestring (old_value->timestamp);
   the_history[which] = temp;
+  _hs_history_index_set (which);
 
   return (old_value);
 }
@@ -449,6 +466,8 @@ remove_history (which)
 
   for (i = which; i < history_length; i++)
     the_history[i] = the_history[i + 1];
+  if (history_index_valid)
+    memmove (history_index + which, history_index + which + 1, (history_length - which - 1) * sizeof (HIST_INDEX));
 
   history_length--;
 
@@ -472,6 +491,8 @@ stifle_history (max)
 	free_history_entry (the_history[i]);
 
       history_base = i;
+      if (history_index_valid)
+	memmove (history_index, history_index + i, max * sizeof (HIST_INDEX));
       for (j = 0, i = history_length - max; j < max; i++, j++)
 	the_history[j] = the_history[i];
       the_history[j] = (HIST_ENTRY *)NULL;
@@ -517,3 +538,67 @@ clear_history ()
 
   history_offset = history_length = 0;
 }
+
+/* **************************************************************** */
+/*								    */
+/*			The History Index			    */
+/*								    */
+/* **************************************************************** */
+
+/* Return the signature of the first LEN characters of STRING: a bit for
+   each pair of adjacent characters.  If ANCHORED is non-zero, include
+   the pair marking STRING's first character as the start of a line. */
+unsigned long
+_hs_history_signature (string, len, anchored)
+     const char *string;
+     int len, anchored;
+{
+  unsigned long sig;
+  register int i;
+
+  if (len <= 0)
+    return 0;
+  sig = anchored ? HIST_SIG_BIT (0, string[0]) : 0;
+  for (i = 1; i < len; i++)
+    sig |= HIST_SIG_BIT (string[i - 1], string[i]);
+  return (sig);
+}
+
+/* Describe the_history[WHICH] in the index, if there is one.  Called
+   whenever the line of a history entry changes. */
+void
+_hs_history_index_set (which)
+     int which;
+{
+  HIST_INDEX *x;
+  char *line;
+
+  if (history_index_valid == 0)
+    return;
+
+  if (history_index_size < history_size)
+    {
+      history_index_size = history_size;
+      history_index = (HIST_INDEX *)xrealloc (history_index, history_index_size * sizeof (HIST_INDEX));
+    }
+
+  x = history_index + which;
+  line = the_history[which]->line;
+  x->len = line ? strlen (line) : 0;
+  x->sig = _hs_history_signature (line, x->len, 1);
+}
+
+/* Return the index of the history list, building it if necessary. */
+HIST_INDEX *
+_hs_history_index ()
+{
+  register int i;
+
+  if (history_index_valid == 0)
+    {
+      history_index_valid = 1;
+      for (i = 0; i < history_length; i++)
+	_hs_history_index_set (i);
+    }
+  return (history_index);
+}
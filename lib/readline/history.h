@@ -204,6 +204,10 @@ extern int append_history PARAMS((int, const char *));
 /* Truncate the history file, leaving only the last NLINES lines. */
 extern int history_truncate_file PARAMS((const char *, int));
 
+/* Return non-zero if history_truncate_file would rewrite the history
+   file when it is append-only. */
+extern int history_file_oversized PARAMS((const char *, int));
+
 /* History expansion. */
 
 /* Expand the string STRING, placing the result into OUTPUT, a pointer
@@ -250,6 +254,7 @@ extern char *history_search_delimiter_chars;
 extern int history_quotes_inhibit_expansion;
 
 extern int history_write_timestamps;
+extern int history_append_only;
 
 /* Backwards compatibility */
 extern int max_input_history;
@@ -67,7 +67,9 @@ history_search_internal (string, direction, anchored)
   register char *line;
   register int line_index;
   int string_len;
+  unsigned long sig;
   HIST_ENTRY **the_history; 	/* local */
+  HIST_INDEX *hindex;
 
   i = history_offset;
   reverse = (direction < 0);
@@ -85,7 +87,9 @@ history_search_internal (string, direction, anchored)
 #define NEXT_LINE() do { if (reverse) i--; else i++; } while (0)
 
   the_history = history_list ();
+  hindex = _hs_history_index ();
   string_len = strlen (string);
+  sig = _hs_history_signature (string, string_len, anchored == ANCHORED_SEARCH);
   while (1)
     {
       /* Search each line in the history list for STRING. */
@@ -94,16 +98,17 @@ history_search_internal (string, direction, anchored)
       if ((reverse && i < 0) || (!reverse && i == history_length))
 	return (-1);
 
-      line = the_history[i]->line;
-      line_index = strlen (line);
-
-      /* If STRING is longer than line, no match. */
-      if (string_len > line_index)
+      /* Skip lines the index says cannot contain STRING, including
+	 lines shorter than STRING. */
+      if (HIST_INDEX_MATCH (hindex + i, sig, string_len) == 0)
 	{
 	  NEXT_LINE ();
 	  continue;
 	}
 
+      line = the_history[i]->line;
+      line_index = strlen (line);
+
       /* Handle anchored searches first. */
       if (anchored == ANCHORED_SEARCH)
 	{
@@ -50,6 +50,7 @@
 
 #include "readline.h"
 #include "history.h"
+#include "histlib.h"
 
 #include "rlprivate.h"
 #include "xmalloc.h"
@@ -324,7 +325,9 @@ _rl_isearch_dispatch (cxt, c)
      _rl_search_cxt *cxt;
      int c;
 {
-  int n, wstart, wlen, limit, cval;
+  int n, wstart, wlen, limit, cval, nindex;
+  unsigned long sig;
+  HIST_INDEX *hindex;
   rl_command_func_t *f;
 
   f = (rl_command_func_t *)NULL;
@@ -531,6 +534,12 @@ _rl_isearch_dispatch (cxt, c)
       break;
     }
 
+  /* The history index covers every line but the current one, as long
+     as the history has not changed since the search started. */
+  nindex = (history_length == cxt->hlen - 1) ? history_length : 0;
+  hindex = nindex ? _hs_history_index () : (HIST_INDEX *)NULL;
+  sig = _hs_history_signature (cxt->search_string, cxt->search_string_index, 0);
+
   for (cxt->sflags &= ~(SF_FOUND|SF_FAILED);; )
     {
       limit = cxt->sline_len - cxt->search_string_index + 1;
@@ -551,8 +560,9 @@ _rl_isearch_dispatch (cxt, c)
 
       /* Move to the next line, but skip new copies of the line
 	 we just found and lines shorter than the string we're
-	 searching for. */
-      do
+	 searching for or that the history index says cannot
+	 contain it. */
+      for (;;)
 	{
 	  /* Move to the next line. */
 	  cxt->history_pos += cxt->direction;
@@ -564,12 +574,18 @@ _rl_isearch_dispatch (cxt, c)
 	      break;
 	    }
 
+	  if (cxt->history_pos < nindex &&
+	      HIST_INDEX_MATCH (hindex + cxt->history_pos, sig, cxt->search_string_index) == 0)
+	    continue;
+
 	  /* We will need these later. */
 	  cxt->sline = cxt->lines[cxt->history_pos];
 	  cxt->sline_len = strlen (cxt->sline);
+
+	  if ((cxt->prev_line_found == 0 || STREQ (cxt->prev_line_found, cxt->sline) == 0) &&
+	      cxt->search_string_index <= cxt->sline_len)
+	    break;
 	}
-      while ((cxt->prev_line_found && STREQ (cxt->prev_line_found, cxt->lines[cxt->history_pos])) ||
-	     (cxt->search_string_index > cxt->sline_len));
 
       if (cxt->sflags & SF_FAILED)
 	break;
@@ -48,6 +48,7 @@
 /* Some standard library routines. */
 #include "readline.h"
 #include "history.h"
+#include "histlib.h"
 
 #include "rlprivate.h"
 #include "rlshell.h"
@@ -467,6 +468,7 @@ _rl_revert_all_lines ()
 	  FREE (entry->line);
 	  entry->line = savestring (rl_line_buffer);
 	  entry->data = 0;
+	  _hs_history_index_set (where_history ());
 	}
       entry = previous_history ();
     }
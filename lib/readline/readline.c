@@ -366,6 +366,7 @@ readline_internal_setup ()
 {
   char *nprompt;
 
+  _rl_reset_output ();
   _rl_in_stream = rl_instream;
   _rl_out_stream = rl_outstream;
 
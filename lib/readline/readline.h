@@ -547,6 +547,11 @@ extern FILE *rl_outstream;
    screen dimensions. */
 extern int rl_prefer_env_winsize;
 
+/* The number of bytes Readline has written to rl_outstream, and the number
+   of writes it has made to send output batched during redisplay. */
+extern unsigned long rl_output_bytes;
+extern unsigned long rl_output_writes;
+
 /* If non-zero, then this is the address of a function to call just
    before readline_internal () prints the first prompt. */
 extern rl_hook_func_t *rl_startup_hook;
@@ -312,6 +312,11 @@ extern void _rl_output_character_function PARAMS((int));
 extern int _rl_output_character_function PARAMS((int));
 #endif
 extern void _rl_output_some_chars PARAMS((const char *, int));
+extern void _rl_output_char PARAMS((int));
+extern void _rl_begin_output PARAMS((void));
+extern void _rl_end_output PARAMS((void));
+extern void _rl_reset_output PARAMS((void));
+extern void _rl_flush_output PARAMS((void));
 extern int _rl_backspace PARAMS((int));
 extern void _rl_enable_meta_key PARAMS((void));
 extern void _rl_control_keypad PARAMS((int));
@@ -446,6 +451,7 @@ extern int _rl_quit_char;
 extern int _rl_susp_char;
 
 /* terminal.c */
+extern int _rl_batch_redisplay;
 extern int _rl_enable_keypad;
 extern int _rl_enable_meta;
 extern char *_rl_term_clreol;
@@ -459,6 +465,7 @@ extern char *_rl_term_dc;
 extern char *_rl_term_cr;
 extern char *_rl_term_IC;
 extern char *_rl_term_forward_char;
+extern char *_rl_term_RI;
 extern int _rl_screenheight;
 extern int _rl_screenwidth;
 extern int _rl_screenchars;
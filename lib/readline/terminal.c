@@ -47,6 +47,11 @@
 #endif
 
 #include <stdio.h>
+#include <errno.h>
+
+#if !defined (errno)
+extern int errno;
+#endif /* !errno */
 
 /* System-specific feature definitions and include files. */
 #include "rldefs.h"
@@ -126,6 +131,7 @@ char *_rl_term_dc;
 char *_rl_term_DC;
 
 char *_rl_term_forward_char;
+char *_rl_term_RI;		/* move forward N columns */
 
 /* How to go up a line. */
 char *_rl_term_up;
@@ -372,6 +378,7 @@ static const struct _tc_string tc_strings[] =
   { "@7", &_rl_term_at7 },
   { "DC", &_rl_term_DC },
   { "IC", &_rl_term_IC },
+  { "RI", &_rl_term_RI },
   { "ce", &_rl_term_clreol },
   { "cl", &_rl_term_clrpag },
   { "cr", &_rl_term_cr },
@@ -489,7 +496,7 @@ _rl_init_terminal_io (terminal_name)
       _rl_term_ks = _rl_term_ke = _rl_term_at7 = (char *)NULL;
       _rl_term_mm = _rl_term_mo = (char *)NULL;
       _rl_term_ve = _rl_term_vs = (char *)NULL;
-      _rl_term_forward_char = (char *)NULL;
+      _rl_term_forward_char = _rl_term_RI = (char *)NULL;
       _rl_terminal_can_insert = term_has_meta = 0;
 
       /* Reasonable defaults for tgoto().  Readline currently only uses
@@ -595,32 +602,180 @@ rl_reset_terminal (terminal_name)
   return 0;
 }
 
+/* **************************************************************** */
+/*								    */
+/*		Batching Terminal Output			    */
+/*								    */
+/* **************************************************************** */
+
+/* While an output batch is open, characters that would be written to
+   _rl_out_stream one or a few at a time are collected in OUTPUT_BUFFER
+   instead, and the outermost _rl_end_output () hands them to the terminal
+   with a single write.  rl_redisplay and the completion listing each run
+   in a batch, so a frame reaches a slow terminal as one write rather than
+   a write per line or per cursor motion.  Batches nest. */
+
+/* Non-zero means redisplay output is batched (`set batch-redisplay'). */
+int _rl_batch_redisplay = 1;
+
+/* The number of bytes readline has sent to the terminal, and the number
+   of writes it has made to send batched output. */
+unsigned long rl_output_bytes = 0;
+unsigned long rl_output_writes = 0;
+
+/* A batch larger than this is written out in pieces. */
+#define OUTPUT_BUFFER_SIZE	8192
+
+static char *output_buffer;
+static int output_buffer_len;
+static int output_batch_depth;
+
+static void output_write PARAMS((const char *, int));
+
+/* Send COUNT bytes from STRING straight to the terminal, after anything
+   already buffered by stdio. */
+static void
+output_write (string, count)
+     const char *string;
+     int count;
+{
+  int fd, n;
+
+  rl_output_writes++;
+  fd = fileno (_rl_out_stream);
+  if (fd < 0)
+    {
+      fwrite (string, 1, count, _rl_out_stream);
+      fflush (_rl_out_stream);
+      return;
+    }
+
+  fflush (_rl_out_stream);
+  while (count > 0)
+    {
+      n = write (fd, string, count);
+      if (n < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  break;
+	}
+      string += n;
+      count -= n;
+    }
+}
+
+/* Start collecting output. */
+void
+_rl_begin_output ()
+{
+  if (_rl_batch_redisplay)
+    output_batch_depth++;
+}
+
+/* Finish the batch started by the matching _rl_begin_output (), writing
+   out whatever was collected if it was the outermost one. */
+void
+_rl_end_output ()
+{
+  if (output_batch_depth > 0 && --output_batch_depth > 0)
+    return;
+  _rl_flush_output ();
+}
+
+/* Abandon any open batches, writing out what they collected.  Called
+   when readline longjmps out of a command and before it starts reading
+   a new line. */
+void
+_rl_reset_output ()
+{
+  output_batch_depth = 0;
+  if (output_buffer_len > 0)
+    _rl_flush_output ();
+}
+
+/* Write out any batched output and flush the output stream.  Called
+   wherever readline must be sure the user can see what it has output,
+   even from inside a batch. */
+void
+_rl_flush_output ()
+{
+  if (output_buffer_len > 0)
+    {
+      output_write (output_buffer, output_buffer_len);
+      output_buffer_len = 0;
+    }
+  else
+    fflush (_rl_out_stream);
+}
+
+/* Write COUNT characters from STRING to the output stream. */
+void
+_rl_output_some_chars (string, count)
+     const char *string;
+     int count;
+{
+  if (count <= 0)
+    return;
+  rl_output_bytes += count;
+
+  if (output_batch_depth == 0)
+    {
+      fwrite (string, 1, count, _rl_out_stream);
+      return;
+    }
+
+  if (output_buffer == 0)
+    output_buffer = (char *)xmalloc (OUTPUT_BUFFER_SIZE);
+  if (output_buffer_len + count > OUTPUT_BUFFER_SIZE)
+    {
+      output_write (output_buffer, output_buffer_len);
+      output_buffer_len = 0;
+    }
+  if (count > OUTPUT_BUFFER_SIZE)
+    {
+      output_write (string, count);
+      return;
+    }
+  memcpy (output_buffer + output_buffer_len, string, count);
+  output_buffer_len += count;
+}
+
+/* Write the character C to the output stream. */
+void
+_rl_output_char (c)
+     int c;
+{
+  char ch;
+
+  if (output_batch_depth == 0)
+    {
+      rl_output_bytes++;
+      putc (c, _rl_out_stream);
+      return;
+    }
+  ch = c;
+  _rl_output_some_chars (&ch, 1);
+}
+
 /* A function for the use of tputs () */
 #ifdef _MINIX
 void
 _rl_output_character_function (c)
      int c;
 {
-  putc (c, _rl_out_stream);
+  _rl_output_char (c);
 }
 #else /* !_MINIX */
 int
 _rl_output_character_function (c)
      int c;
 {
-  return putc (c, _rl_out_stream);
+  _rl_output_char (c);
+  return ((unsigned char)c);
 }
 #endif /* !_MINIX */
 
-/* Write COUNT characters from STRING to the output stream. */
-void
-_rl_output_some_chars (string, count)
-     const char *string;
-     int count;
-{
-  fwrite (string, 1, count, _rl_out_stream);
-}
-
 /* Move the cursor back. */
 int
 _rl_backspace (count)
@@ -633,7 +788,7 @@ _rl_backspace (count)
       tputs (_rl_term_backspace, 1, _rl_output_character_function);
   else
     for (i = 0; i < count; i++)
-      putc ('\b', _rl_out_stream);
+      _rl_output_char ('\b');
   return 0;
 }
 
@@ -645,7 +800,7 @@ rl_crlf ()
   if (_rl_term_cr)
     tputs (_rl_term_cr, 1, _rl_output_character_function);
 #endif /* NEW_TTY_DRIVER || __MINT__ */
-  putc ('\n', _rl_out_stream);
+  _rl_output_char ('\n');
   return 0;
 }
 
@@ -98,6 +98,7 @@ _rl_walphabetic (wchar_t wc)
 int
 _rl_abort_internal ()
 {
+  _rl_reset_output ();
   rl_ding ();
   rl_clear_message ();
   _rl_reset_argument ();
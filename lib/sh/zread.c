@@ -95,10 +95,23 @@ zreadintr (fd, buf, len)
 
 /* Read one character from FD and return it in CP.  Return values are as
    in read(2).  This does some local buffering to avoid many one-character
-   calls to read(2), like those the `read' builtin performs. */
+   calls to read(2), like those the `read' builtin performs.
 
-static char lbuf[128];
+   The first read after zreset or zsyncfd asks for ZBUF_MIN bytes, so a
+   caller that reads one line doesn't read (and have to seek back over)
+   much more than it needs.  Each read that fills the buffer doubles the
+   size of the next one, up to ZBUF_MAX, so callers that consume a lot of
+   input, like mapfile, make fewer calls to read(2). */
+
+#define ZBUF_MIN	128
+#define ZBUF_MAX	65536
+
+static char lbuf[ZBUF_MAX];
 static size_t lind, lused;
+static size_t lsize = ZBUF_MIN;
+
+/* The number of calls to read(2) zreadc and zreadcintr have made. */
+unsigned long zreadc_nreads = 0;
 
 ssize_t
 zreadc (fd, cp)
@@ -109,13 +122,16 @@ zreadc (fd, cp)
 
   if (lind == lused || lused == 0)
     {
-      nr = zread (fd, lbuf, sizeof (lbuf));
+      nr = zread (fd, lbuf, lsize);
+      zreadc_nreads++;
       lind = 0;
       if (nr <= 0)
 	{
 	  lused = 0;
 	  return nr;
 	}
+      if (nr == lsize && lsize < ZBUF_MAX)
+	lsize <<= 1;
       lused = nr;
     }
   if (cp)
@@ -134,13 +150,16 @@ zreadcintr (fd, cp)
 
   if (lind == lused || lused == 0)
     {
-      nr = zreadintr (fd, lbuf, sizeof (lbuf));
+      nr = zreadintr (fd, lbuf, lsize);
+      zreadc_nreads++;
       lind = 0;
       if (nr <= 0)
 	{
 	  lused = 0;
 	  return nr;
 	}
+      if (nr == lsize && lsize < ZBUF_MAX)
+	lsize <<= 1;
       lused = nr;
     }
   if (cp)
@@ -152,6 +171,7 @@ void
 zreset ()
 {
   lind = lused = 0;
+  lsize = ZBUF_MIN;
 }
 
 /* Sync the seek pointer for FD so that the kernel's idea of the last char
@@ -170,4 +190,5 @@ zsyncfd (fd)
 
   if (r >= 0)
     lused = lind = 0;
+  lsize = ZBUF_MIN;
 }
@@ -34,6 +34,9 @@
 
 #include "shell.h"
 #include "input.h"	/* For bash_input */
+#include "parsecache.h"
+
+#include <glob/strmatch.h>
 
 #ifndef errno
 extern int errno;
@@ -194,6 +197,7 @@ set_locale_var (var, value)
 	    internal_warning(_("setlocale: LC_ALL: cannot change locale (%s): %s"), lc_all, strerror (errno));
 	}
       locale_setblanks ();
+      strmatch_flush_cache ();
       return r;
 #else
       return (1);
@@ -239,6 +243,7 @@ set_locale_var (var, value)
 	x = setlocale (LC_TIME, get_locale_var ("LC_TIME"));
 #  endif /* LC_TIME */
     }
+  strmatch_flush_cache ();
 #endif /* HAVE_SETLOCALE */
   
   if (x == 0)
@@ -339,6 +344,7 @@ reset_locale_vars ()
 #  endif
 
   locale_setblanks ();  
+  strmatch_flush_cache ();
 
 #endif
   return 1;
@@ -465,6 +471,10 @@ localeexpand (string, start, end, lineno, lenp)
   int len, tlen, foundnl;
   char *temp, *t, *t2;
 
+  /* The translation depends on the current locale, so the command being
+     parsed cannot be saved in the parse cache. */
+  parse_cache_note_translation ();
+
   temp = (char *)xmalloc (end - start + 1);
   for (tlen = 0, len = start; len < end; )
     temp[tlen++] = string[len++];
@@ -21,16 +21,30 @@
 
 #include <unistd.h>
 
+#include <errno.h>
+#include <stddef.h>
+
 #include "shell.h"
 #include "filecntl.h"
 #include "jobs.h"
+#include "sig.h"
 
 #include <time.h>
 #include <utmp.h>
 #include <mqueue.h>
+#include "posixtime.h"
+#if defined (HAVE_SYS_RESOURCE_H)
+#  include <sys/resource.h>
+#endif
 
 #include "logmessage.h"
 
+/* Size of the buffer that holds records waiting to be sent in batches */
+#define LOG_BUFFER_SIZE	16384
+
+/* Send a partial batch once its oldest record is this many seconds old */
+#define LOG_FLUSH_INTERVAL	1
+
 /*
  * Find terminal port associated with stdin.
  * Since shell is interactive
@@ -50,31 +64,270 @@ static const char *get_tty()
 static mqd_t message_queue = -1;
 static const char *current_tty;
 
+/* Batched logging state.  log_process_exit() runs in the SIGCHLD handler,
+   so it only appends entries to log_buffer; flush_command_log() sends them
+   with SIGCHLD blocked. */
+static int log_version = 1;		/* record format */
+static int log_batched;
+static char log_buffer[LOG_BUFFER_SIZE];
+static size_t log_buffered;		/* bytes used in log_buffer */
+static int log_pending;			/* entries in log_buffer */
+static time_t log_oldest;		/* when the first pending entry was added */
+static unsigned int log_dropped;	/* records lost since the last batch */
+static char *log_batch;			/* message being assembled */
+static size_t log_batch_size;		/* the queue's maximum message size */
+
 void initialize_logging ()
 {
   const char *tty;
+  char *version;
+  struct mq_attr attr;
 
   tty = get_tty();
   if (tty == NULL)
     return;	/* Not really an interactive shell */
 
-  message_queue = mq_open("/vbash", O_WRONLY);
+  log_batched = getenv ("VYATTA_LOG_BATCH") != NULL;
+  if ((version = getenv ("VYATTA_LOG_VERSION")) && strcmp (version, "2") == 0)
+    log_version = 2;
+
+  message_queue = mq_open("/vbash", log_batched ? O_WRONLY|O_NONBLOCK : O_WRONLY);
   if (message_queue == (mqd_t)-1)
     return;	/* No logging server running */
 	
   SET_CLOSE_ON_EXEC(message_queue);
 
   current_tty = strdup(tty);
+
+  if (log_batched)
+    {
+      if (mq_getattr (message_queue, &attr) < 0 ||
+	  attr.mq_msgsize < sizeof (struct command_log_batch) + sizeof (struct command_log_entry))
+	log_batched = 0;
+      else
+	{
+	  log_batch_size = attr.mq_msgsize;
+	  log_batch = xmalloc (log_batch_size);
+	}
+    }
+}
+
+/* Fill in LREC for CHILD */
+static void
+fill_command_log (lrec, child)
+     struct command_log *lrec;
+     PROCESS *child;
+{
+  lrec->pid 	= child->pid;
+  lrec->status 	= WEXITSTATUS(child->status);
+  lrec->endtime	= time(0);
+  lrec->uid	= current_user.uid;
+  lrec->euid	= current_user.euid;
+  lrec->gid	= current_user.gid;
+  lrec->egid	= current_user.egid;
+  strncpy(lrec->name, current_user.user_name, UT_NAMESIZE);
+  strncpy(lrec->tty, current_tty, UT_LINESIZE);
+  strcpy(lrec->command, child->command);
+}
+
+/* Fill in the version 2 record LREC for CHILD, which used the resources
+   in RU (if known) */
+static void
+fill_command_log_v2 (lrec, child, ru)
+     struct command_log_v2 *lrec;
+     PROCESS *child;
+     struct rusage *ru;
+{
+  struct timeval now;
+
+  gettimeofday (&now, NULL);
+
+  lrec->magic	= COMMAND_LOG_V2_MAGIC;
+  lrec->pid 	= child->pid;
+  lrec->status 	= WEXITSTATUS(child->status);
+  lrec->endtime	= now.tv_sec;
+  lrec->uid	= current_user.uid;
+  lrec->euid	= current_user.euid;
+  lrec->gid	= current_user.gid;
+  lrec->egid	= current_user.egid;
+
+  lrec->starttime = child->starttime;
+  lrec->duration.tv_sec = now.tv_sec - child->starttime.tv_sec;
+  lrec->duration.tv_usec = now.tv_usec - child->starttime.tv_usec;
+  if (lrec->duration.tv_usec < 0)
+    {
+      lrec->duration.tv_sec--;
+      lrec->duration.tv_usec += 1000000;
+    }
+#if defined (HAVE_GETRUSAGE)
+  if (ru)
+    {
+      lrec->utime = ru->ru_utime;
+      lrec->stime = ru->ru_stime;
+      lrec->maxrss = ru->ru_maxrss;
+    }
+#endif
+
+  strncpy(lrec->name, current_user.user_name, UT_NAMESIZE);
+  strncpy(lrec->tty, current_tty, UT_LINESIZE);
+  strcpy(lrec->command, child->command);
+}
+
+/* Size of the record for COMMAND in the current format */
+static size_t
+command_log_size (command)
+     const char *command;
+{
+  if (log_version == 2)
+    return (sizeof (struct command_log_v2) + strlen (command) + 1);
+  return (sizeof (struct command_log) + strlen (command) + 1);
+}
+
+static time_t
+entry_endtime (entry)
+     struct command_log_entry *entry;
+{
+  return (log_version == 2 ? entry->log.v2.endtime : entry->log.v1.endtime);
+}
+
+/* Append a record for CHILD to the batch buffer, or count it as dropped
+   if there is no room.  Called from the SIGCHLD handler. */
+static void
+buffer_process_exit (child, ru)
+     PROCESS *child;
+     struct rusage *ru;
+{
+  struct command_log_entry *entry;
+  size_t cc;
+
+  cc = COMMAND_LOG_ALIGN (offsetof (struct command_log_entry, log) +
+			  command_log_size (child->command));
+  if (log_buffered + cc > sizeof (log_buffer) ||
+      sizeof (struct command_log_batch) + cc > log_batch_size)
+    {
+      log_dropped++;
+      return;
+    }
+
+  entry = (struct command_log_entry *)(log_buffer + log_buffered);
+  memset (entry, 0, cc);
+  entry->length = cc;
+  if (log_version == 2)
+    fill_command_log_v2 (&entry->log.v2, child, ru);
+  else
+    fill_command_log (&entry->log.v1, child);
+
+  if (log_pending++ == 0)
+    log_oldest = entry_endtime (entry);
+  log_buffered += cc;
+}
+
+/* Send the batch of COUNT entries assembled in log_batch, LEN bytes long */
+static void
+send_command_log_batch (count, len)
+     int count;
+     size_t len;
+{
+  struct command_log_batch *batch;
+
+  batch = (struct command_log_batch *)log_batch;
+  batch->magic = COMMAND_LOG_BATCH_MAGIC;
+  batch->version = log_version;
+  batch->count = count;
+  batch->dropped = log_dropped;
+
+  if (mq_send (message_queue, log_batch, len, 0) == 0)
+    log_dropped = 0;
+  else
+    log_dropped += count;	/* queue full; the server is not keeping up */
+}
+
+/* Send the buffered records.  Unless FORCE is non-zero, this only happens
+   once a full message is waiting or the oldest record is old enough, and
+   records that do not fill a message stay buffered.  Called at prompt time
+   and after waiting for a foreground command. */
+void
+flush_command_log (force)
+     int force;
+{
+  struct command_log_entry *entry;
+  size_t off, len;
+  int count, sent;
+#if defined (JOB_CONTROL)
+  sigset_t set, oset;
+#endif
+
+  if (log_batched == 0 || message_queue == (mqd_t) -1)
+    return;
+
+#if defined (JOB_CONTROL)
+  BLOCK_CHILD (set, oset);
+#endif
+
+  if (log_pending && force == 0 && time (0) - log_oldest >= LOG_FLUSH_INTERVAL)
+    force = 1;
+
+  if (log_pending && (force ||
+		      sizeof (struct command_log_batch) + log_buffered >= log_batch_size))
+    {
+      len = sizeof (struct command_log_batch);
+      for (count = sent = off = 0; off < log_buffered; off += entry->length)
+	{
+	  entry = (struct command_log_entry *)(log_buffer + off);
+	  if (len + entry->length > log_batch_size)
+	    {
+	      send_command_log_batch (count, len);
+	      sent += count;
+	      len = sizeof (struct command_log_batch);
+	      count = 0;
+	      if (force == 0)
+		break;
+	    }
+	  memcpy (log_batch + len, entry, entry->length);
+	  len += entry->length;
+	  count++;
+	}
+
+      if (off < log_buffered)
+	{
+	  /* keep the partial batch for later */
+	  memmove (log_buffer, log_buffer + off, log_buffered - off);
+	  log_buffered -= off;
+	  log_pending -= sent;
+	  log_oldest = entry_endtime ((struct command_log_entry *)log_buffer);
+	}
+      else
+	{
+	  send_command_log_batch (count, len);
+	  log_buffered = 0;
+	  log_pending = 0;
+	}
+    }
+
+#if defined (JOB_CONTROL)
+  UNBLOCK_CHILD (oset);
+#endif
+}
+
+/* Forget the buffered records; called in a newly-forked child */
+void
+discard_command_log ()
+{
+  log_buffered = 0;
+  log_pending = 0;
+  log_dropped = 0;
 }
 
 /*
- * Logs the result of the child for more detailed accounting
+ * Logs the result of the child for more detailed accounting.
+ * RU is the child's resource usage, or NULL if it is not available.
  */
-void log_process_exit (child)
+void log_process_exit (child, ru)
     PROCESS *child;
+    struct rusage *ru;
 {
   size_t cc;
-  struct command_log *lrec;
+  char *lrec;
 
   if (message_queue == (mqd_t) -1)	/* message queue does not exist */
     return;
@@ -82,22 +335,22 @@ void log_process_exit (child)
   if (child->command == NULL)		/* no command info */
     return;
 
-  cc = sizeof(*lrec) + strlen(child->command) + 1;
+  if (log_batched)
+    {
+      buffer_process_exit (child, ru);
+      return;
+    }
+
+  cc = command_log_size (child->command);
   lrec = alloca(cc);
   memset(lrec, 0, cc);
 
-  lrec->pid 	= child->pid;
-  lrec->status 	= WEXITSTATUS(child->status);
-  lrec->endtime	= time(0);
-  lrec->uid	= current_user.uid;
-  lrec->euid	= current_user.euid;
-  lrec->gid	= current_user.gid;
-  lrec->egid	= current_user.egid;
-  strncpy(lrec->name, current_user.user_name, UT_NAMESIZE);
-  strncpy(lrec->tty, current_tty, UT_LINESIZE);
-  strcpy(lrec->command, child->command);
+  if (log_version == 2)
+    fill_command_log_v2 ((struct command_log_v2 *)lrec, child, ru);
+  else
+    fill_command_log ((struct command_log *)lrec, child);
 
   /* Ignore errors?? */
-  mq_send(message_queue, (char *)lrec, cc, 0);
+  mq_send(message_queue, lrec, cc, 0);
 }
 
@@ -14,3 +14,59 @@ struct command_log {
 	char	tty[UT_LINESIZE];
 	char	command[0];
 };
+
+/* Version 2 records add the start time, duration and resource usage of
+   the command.  They are sent instead of struct command_log when
+   VYATTA_LOG_VERSION=2 is set in the environment of an interactive shell,
+   and start with a negative magic number for the same reason batches do. */
+#define COMMAND_LOG_V2_MAGIC	(-0x7663)
+
+struct command_log_v2 {
+	int	magic;			/* COMMAND_LOG_V2_MAGIC */
+	pid_t	pid;
+	int	status;
+	time_t	endtime;
+	uid_t	uid, euid;
+	gid_t	gid, egid;
+	struct timeval starttime;	/* when the command was forked */
+	struct timeval duration;	/* wall clock time until it was reaped */
+	struct timeval utime, stime;	/* user and system CPU time */
+	long	maxrss;			/* maximum resident set size, in KB */
+	char	name[UT_NAMESIZE];
+	char	tty[UT_LINESIZE];
+	char	command[0];
+};
+
+/* When vbash buffers its logging (VYATTA_LOG_BATCH set in the environment
+   of an interactive shell), several records are coalesced into one message
+   that starts with this header.  The magic number is negative, so it can
+   never be mistaken for the pid at the start of an unbatched record. */
+#define COMMAND_LOG_BATCH_MAGIC		(-0x7662)
+
+struct command_log_batch {
+	int		magic;		/* COMMAND_LOG_BATCH_MAGIC */
+	unsigned short	version;	/* record version: 1 or 2 */
+	unsigned short	count;		/* number of entries that follow */
+	unsigned int	dropped;	/* records lost since the last batch */
+	char		entries[0];
+};
+
+/* Each entry in a batch is a record preceded by its length, which is
+   padded so that the next entry is aligned. */
+struct command_log_entry {
+	unsigned int	length;		/* bytes from here to the next entry */
+	union {
+		struct command_log	v1;
+		struct command_log_v2	v2;
+	} log;
+};
+
+#define COMMAND_LOG_ALIGN(n)	(((n) + 7) & ~7)
+
+#if defined (_JOBS_H_)
+struct rusage;
+
+/* Send a record for CHILD, which has exited; RU is its resource usage,
+   or NULL if that is not available.  Defined in logging.c. */
+extern void log_process_exit __P((PROCESS *, struct rusage *));
+#endif
@@ -57,12 +57,79 @@
 extern int line_number, current_command_line_count, parser_state;
 extern int last_command_exit_value;
 
-/* Object caching */
-sh_obj_cache_t wdcache = {0, 0, 0};
-sh_obj_cache_t wlcache = {0, 0, 0};
-
-#define WDCACHESIZE	60
-#define WLCACHESIZE	60
+/* Object pools for words and word lists, which word expansion creates and
+   discards by the thousand. */
+sh_obj_pool_t wdpool = {0, 0, 0};
+sh_obj_pool_t wlpool = {0, 0, 0};
+
+#define WDPOOLSIZE	256
+#define WLPOOLSIZE	256
+
+/* Command arenas.  While a command is being parsed, the nodes of its parse
+   tree can come from an arena instead of from malloc: a list of large
+   blocks carved up in order.  The caller that owns the command resets or
+   disposes of the arena once the command has been disposed of, releasing
+   every node at once; dispose_command () and friends leave nodes they find
+   in a live arena alone and free only the strings hanging off them.  Trees
+   that have to outlive the command, like function definitions, are copied
+   with copy_command (), which never allocates from an arena. */
+
+/* Keeps the memory handed out from an arena block suitably aligned. */
+typedef union cmd_arena_align {
+  long l;
+  double d;
+  char *p;
+  PTR_T f;
+} CMD_ARENA_ALIGN;
+
+typedef struct cmd_arena_block {
+  struct cmd_arena_block *next;
+  char *limit;			/* first byte past the block */
+  CMD_ARENA_ALIGN align;	/* the block's memory follows */
+} CMD_ARENA_BLOCK;
+
+struct cmd_arena {
+  struct cmd_arena *next;	/* next live arena */
+  CMD_ARENA_BLOCK *blocks;	/* most recently allocated first */
+  char *avail;			/* next free byte in blocks */
+  size_t bsize;			/* size of the next block to allocate */
+};
+
+#define CMD_ARENA_MINBLOCK	4096
+#define CMD_ARENA_MAXBLOCK	65536
+
+/* How many disposed arenas to keep for reuse, so that running many short
+   commands through eval or a trap doesn't allocate an arena for each. */
+#define CMD_ARENA_NSPARES	4
+
+#define CMD_ARENA_ROUND(n) \
+  (((n) + sizeof (CMD_ARENA_ALIGN) - 1) & ~(sizeof (CMD_ARENA_ALIGN) - 1))
+
+#define BLOCK_START(b)	((char *)((b) + 1))
+
+/* Non-zero means the parser puts the commands it reads into arenas.  Set
+   by `shopt cmdarena'. */
+int use_cmd_arena = 1;
+
+/* The arena new parse tree nodes come from, or NULL to use malloc. */
+CMD_ARENA *cmd_arena = (CMD_ARENA *)NULL;
+
+/* Every arena that has been created and not disposed of. */
+static CMD_ARENA *live_arenas = (CMD_ARENA *)NULL;
+
+/* Disposed arenas kept for reuse, each with one empty block. */
+static CMD_ARENA *spare_arenas = (CMD_ARENA *)NULL;
+static int nspare_arenas = 0;
+
+/* Counts of parse tree nodes allocated and freed individually, and of
+   nodes and blocks allocated from arenas, reported as the cmd_* elements
+   of $BASH_STATS. */
+unsigned long cmd_heap_nodes = 0;
+unsigned long cmd_heap_frees = 0;
+unsigned long cmd_arena_nodes = 0;
+unsigned long cmd_arena_blocks = 0;
+
+static PTR_T cmd_arena_alloc __P((CMD_ARENA *, size_t));
 
 static COMMAND *make_for_or_select __P((enum command_type, WORD_DESC *, WORD_LIST *, COMMAND *, int));
 #if defined (ARITH_FOR_COMMAND)
@@ -73,8 +140,159 @@ static COMMAND *make_until_or_while __P((enum command_type, COMMAND *, COMMAND *
 void
 cmd_init ()
 {
-  ocache_create (wdcache, WORD_DESC, WDCACHESIZE);
-  ocache_create (wlcache, WORD_LIST, WLCACHESIZE);
+  opool_create (wdpool, WORD_DESC, WDPOOLSIZE);
+  opool_create (wlpool, WORD_LIST, WLPOOLSIZE);
+}
+
+/* Return a new, empty arena. */
+CMD_ARENA *
+cmd_arena_create ()
+{
+  CMD_ARENA *arena;
+
+  if (spare_arenas)
+    {
+      arena = spare_arenas;
+      spare_arenas = arena->next;
+      nspare_arenas--;
+    }
+  else
+    {
+      arena = (CMD_ARENA *)xmalloc (sizeof (CMD_ARENA));
+      arena->blocks = (CMD_ARENA_BLOCK *)NULL;
+      arena->avail = (char *)NULL;
+      arena->bsize = CMD_ARENA_MINBLOCK;
+    }
+
+  arena->next = live_arenas;
+  live_arenas = arena;
+  return (arena);
+}
+
+/* Return SIZE bytes from ARENA, starting a new block if the current one
+   is too full. */
+static PTR_T
+cmd_arena_alloc (arena, size)
+     CMD_ARENA *arena;
+     size_t size;
+{
+  CMD_ARENA_BLOCK *b;
+  size_t bsize;
+  char *r;
+
+  size = CMD_ARENA_ROUND (size);
+  if (arena->blocks == 0 || arena->avail + size > arena->blocks->limit)
+    {
+      bsize = (size > arena->bsize) ? size : arena->bsize;
+      b = (CMD_ARENA_BLOCK *)xmalloc (sizeof (CMD_ARENA_BLOCK) + bsize);
+      b->limit = BLOCK_START (b) + bsize;
+      b->next = arena->blocks;
+      arena->blocks = b;
+      arena->avail = BLOCK_START (b);
+      if (arena->bsize < CMD_ARENA_MAXBLOCK)
+	arena->bsize *= 2;
+      cmd_arena_blocks++;
+    }
+
+  r = arena->avail;
+  arena->avail += size;
+  cmd_arena_nodes++;
+  return ((PTR_T)r);
+}
+
+/* Release every node allocated from ARENA, keeping its newest block to
+   reuse for the next command. */
+void
+cmd_arena_reset (arena)
+     CMD_ARENA *arena;
+{
+  CMD_ARENA_BLOCK *b, *next;
+
+  if (arena == 0 || arena->blocks == 0)
+    return;
+
+  for (b = arena->blocks->next; b; b = next)
+    {
+      next = b->next;
+      free (b);
+    }
+  arena->blocks->next = (CMD_ARENA_BLOCK *)NULL;
+  arena->avail = BLOCK_START (arena->blocks);
+}
+
+/* Release ARENA and every node allocated from it. */
+void
+cmd_arena_dispose (arena)
+     CMD_ARENA *arena;
+{
+  CMD_ARENA **ap;
+  CMD_ARENA_BLOCK *b, *next;
+
+  if (arena == 0)
+    return;
+
+  for (ap = &live_arenas; *ap; ap = &(*ap)->next)
+    if (*ap == arena)
+      {
+	*ap = arena->next;
+	break;
+      }
+
+  if (cmd_arena == arena)
+    cmd_arena = (CMD_ARENA *)NULL;
+
+  if (nspare_arenas < CMD_ARENA_NSPARES)
+    {
+      cmd_arena_reset (arena);
+      arena->next = spare_arenas;
+      spare_arenas = arena;
+      nspare_arenas++;
+      return;
+    }
+
+  for (b = arena->blocks; b; b = next)
+    {
+      next = b->next;
+      free (b);
+    }
+  free (arena);
+}
+
+/* Return non-zero if P points into a live arena, so it must not be freed
+   on its own. */
+int
+cmd_arena_owns (p)
+     PTR_T p;
+{
+  CMD_ARENA *a;
+  CMD_ARENA_BLOCK *b;
+
+  for (a = live_arenas; a; a = a->next)
+    for (b = a->blocks; b; b = b->next)
+      if ((char *)p >= BLOCK_START (b) && (char *)p < b->limit)
+	return 1;
+  return 0;
+}
+
+/* Return SIZE bytes for a parse tree node, from the current arena if
+   there is one. */
+PTR_T
+cmd_node_alloc (size)
+     size_t size;
+{
+  if (cmd_arena)
+    return (cmd_arena_alloc (cmd_arena, size));
+  return (heap_node_alloc (size));
+}
+
+/* Return SIZE bytes for a parse tree node that must not come from an
+   arena. */
+PTR_T
+heap_node_alloc (size)
+     size_t size;
+{
+  cmd_heap_nodes++;
+  return (xmalloc (size));
 }
 
 WORD_DESC *
@@ -82,7 +300,13 @@ alloc_word_desc ()
 {
   WORD_DESC *temp;
 
-  ocache_alloc (wdcache, WORD_DESC, temp);
+  if (cmd_arena)
+    temp = (WORD_DESC *)cmd_arena_alloc (cmd_arena, sizeof (WORD_DESC));
+  else
+    {
+      opool_alloc (wdpool, WORD_DESC, temp);
+      cmd_heap_nodes++;
+    }
   temp->flags = 0;
   temp->word = 0;
   return temp;
@@ -169,7 +393,13 @@ make_word_list (word, wlink)
 {
   WORD_LIST *temp;
 
-  ocache_alloc (wlcache, WORD_LIST, temp);
+  if (cmd_arena)
+    temp = (WORD_LIST *)cmd_arena_alloc (cmd_arena, sizeof (WORD_LIST));
+  else
+    {
+      opool_alloc (wlpool, WORD_LIST, temp);
+      cmd_heap_nodes++;
+    }
 
   temp->word = word;
   temp->next = wlink;
@@ -183,7 +413,7 @@ make_command (type, pointer)
 {
   COMMAND *temp;
 
-  temp = (COMMAND *)xmalloc (sizeof (COMMAND));
+  temp = (COMMAND *)cmd_node_alloc (sizeof (COMMAND));
   temp->type = type;
   temp->value.Simple = pointer;
   temp->value.Simple->flags = temp->flags = 0;
@@ -198,7 +428,7 @@ command_connect (com1, com2, connector)
 {
   CONNECTION *temp;
 
-  temp = (CONNECTION *)xmalloc (sizeof (CONNECTION));
+  temp = (CONNECTION *)cmd_node_alloc (sizeof (CONNECTION));
   temp->connector = connector;
   temp->first = com1;
   temp->second = com2;
@@ -215,7 +445,7 @@ make_for_or_select (type, name, map_list, action, lineno)
 {
   FOR_COM *temp;
 
-  temp = (FOR_COM *)xmalloc (sizeof (FOR_COM));
+  temp = (FOR_COM *)cmd_node_alloc (sizeof (FOR_COM));
   temp->flags = 0;
   temp->name = name;
   temp->line = lineno;
@@ -328,7 +558,7 @@ make_arith_for_command (exprs, action, lineno)
       return ((COMMAND *)NULL);
     }
 
-  temp = (ARITH_FOR_COM *)xmalloc (sizeof (ARITH_FOR_COM));
+  temp = (ARITH_FOR_COM *)cmd_node_alloc (sizeof (ARITH_FOR_COM));
   temp->flags = 0;
   temp->line = lineno;
   temp->init = init ? init : make_arith_for_expr ("1");
@@ -351,7 +581,7 @@ make_group_command (command)
 {
   GROUP_COM *temp;
 
-  temp = (GROUP_COM *)xmalloc (sizeof (GROUP_COM));
+  temp = (GROUP_COM *)cmd_node_alloc (sizeof (GROUP_COM));
   temp->command = command;
   return (make_command (cm_group, (SIMPLE_COM *)temp));
 }
@@ -364,7 +594,7 @@ make_case_command (word, clauses, lineno)
 {
   CASE_COM *temp;
 
-  temp = (CASE_COM *)xmalloc (sizeof (CASE_COM));
+  temp = (CASE_COM *)cmd_node_alloc (sizeof (CASE_COM));
   temp->flags = 0;
   temp->line = lineno;
   temp->word = word;
@@ -379,7 +609,7 @@ make_pattern_list (patterns, action)
 {
   PATTERN_LIST *temp;
 
-  temp = (PATTERN_LIST *)xmalloc (sizeof (PATTERN_LIST));
+  temp = (PATTERN_LIST *)cmd_node_alloc (sizeof (PATTERN_LIST));
   temp->patterns = REVERSE_LIST (patterns, WORD_LIST *);
   temp->action = action;
   temp->next = NULL;
@@ -393,7 +623,7 @@ make_if_command (test, true_case, false_case)
 {
   IF_COM *temp;
 
-  temp = (IF_COM *)xmalloc (sizeof (IF_COM));
+  temp = (IF_COM *)cmd_node_alloc (sizeof (IF_COM));
   temp->flags = 0;
   temp->test = test;
   temp->true_case = true_case;
@@ -408,7 +638,7 @@ make_until_or_while (which, test, action)
 {
   WHILE_COM *temp;
 
-  temp = (WHILE_COM *)xmalloc (sizeof (WHILE_COM));
+  temp = (WHILE_COM *)cmd_node_alloc (sizeof (WHILE_COM));
   temp->flags = 0;
   temp->test = test;
   temp->action = action;
@@ -437,8 +667,8 @@ make_arith_command (exp)
   COMMAND *command;
   ARITH_COM *temp;
 
-  command = (COMMAND *)xmalloc (sizeof (COMMAND));
-  command->value.Arith = temp = (ARITH_COM *)xmalloc (sizeof (ARITH_COM));
+  command = (COMMAND *)cmd_node_alloc (sizeof (COMMAND));
+  command->value.Arith = temp = (ARITH_COM *)cmd_node_alloc (sizeof (ARITH_COM));
 
   temp->flags = 0;
   temp->line = line_number;
@@ -464,7 +694,7 @@ make_cond_node (type, op, left, right)
 {
   COND_COM *temp;
 
-  temp = (COND_COM *)xmalloc (sizeof (COND_COM));
+  temp = (COND_COM *)cmd_node_alloc (sizeof (COND_COM));
   temp->flags = 0;
   temp->line = line_number;
   temp->type = type;
@@ -483,7 +713,7 @@ make_cond_command (cond_node)
 #if defined (COND_COMMAND)
   COMMAND *command;
 
-  command = (COMMAND *)xmalloc (sizeof (COMMAND));
+  command = (COMMAND *)cmd_node_alloc (sizeof (COMMAND));
   command->value.Cond = cond_node;
 
   command->type = cm_cond;
@@ -504,8 +734,8 @@ make_bare_simple_command ()
   COMMAND *command;
   SIMPLE_COM *temp;
 
-  command = (COMMAND *)xmalloc (sizeof (COMMAND));
-  command->value.Simple = temp = (SIMPLE_COM *)xmalloc (sizeof (SIMPLE_COM));
+  command = (COMMAND *)cmd_node_alloc (sizeof (COMMAND));
+  command->value.Simple = temp = (SIMPLE_COM *)cmd_node_alloc (sizeof (SIMPLE_COM));
 
   temp->flags = 0;
   temp->line = line_number;
@@ -684,7 +914,7 @@ make_redirection (source, instruction, dest_and_filename, flags)
   int wlen;
   intmax_t lfd;
 
-  temp = (REDIRECT *)xmalloc (sizeof (REDIRECT));
+  temp = (REDIRECT *)cmd_node_alloc (sizeof (REDIRECT));
 
   /* First do the common cases. */
   temp->redirector = source;
@@ -772,7 +1002,7 @@ make_function_def (name, command, lineno, lstart)
   ARRAY *bash_source_a;
 #endif
 
-  temp = (FUNCTION_DEF *)xmalloc (sizeof (FUNCTION_DEF));
+  temp = (FUNCTION_DEF *)cmd_node_alloc (sizeof (FUNCTION_DEF));
   temp->command = command;
   temp->name = name;
   temp->line = lineno;
@@ -800,7 +1030,7 @@ make_subshell_command (command)
 {
   SUBSHELL_COM *temp;
 
-  temp = (SUBSHELL_COM *)xmalloc (sizeof (SUBSHELL_COM));
+  temp = (SUBSHELL_COM *)cmd_node_alloc (sizeof (SUBSHELL_COM));
   temp->command = command;
   temp->flags = CMD_WANT_SUBSHELL;
   return (make_command (cm_subshell, (SIMPLE_COM *)temp));
@@ -813,7 +1043,7 @@ make_coproc_command (name, command)
 {
   COPROC_COM *temp;
 
-  temp = (COPROC_COM *)xmalloc (sizeof (COPROC_COM));
+  temp = (COPROC_COM *)cmd_node_alloc (sizeof (COPROC_COM));
   temp->name = savestring (name);
   temp->command = command;
   temp->flags = CMD_WANT_SUBSHELL|CMD_COPROC_SUBSHELL;
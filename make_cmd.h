@@ -25,6 +25,22 @@
 
 extern void cmd_init __P((void));
 
+/* An arena that parse tree nodes can be allocated from; see make_cmd.c. */
+typedef struct cmd_arena CMD_ARENA;
+
+extern int use_cmd_arena;
+extern CMD_ARENA *cmd_arena;
+
+extern unsigned long cmd_heap_nodes, cmd_heap_frees;
+extern unsigned long cmd_arena_nodes, cmd_arena_blocks;
+
+extern CMD_ARENA *cmd_arena_create __P((void));
+extern void cmd_arena_reset __P((CMD_ARENA *));
+extern void cmd_arena_dispose __P((CMD_ARENA *));
+extern int cmd_arena_owns __P((PTR_T));
+extern PTR_T cmd_node_alloc __P((size_t));
+extern PTR_T heap_node_alloc __P((size_t));
+
 extern WORD_DESC *alloc_word_desc __P((void));
 extern WORD_DESC *make_bare_word __P((const char *));
 extern WORD_DESC *make_word_flags __P((WORD_DESC *, const char *));
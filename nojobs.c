@@ -46,6 +46,8 @@
 #include "shell.h"
 #include "jobs.h"
 #include "execute_cmd.h"
+#include "input.h"
+#include "trap.h"
 
 #include "builtins/builtext.h"	/* for wait_builtin */
 
@@ -519,6 +521,7 @@ make_child (command, async_p)
     {
 #if defined (BUFFERED_INPUT)
       unset_bash_input (0);
+      discard_read_streams ();
 #endif /* BUFFERED_INPUT */
 
 #if defined (HAVE_POSIX_SIGNALS)
@@ -548,6 +551,70 @@ make_child (command, async_p)
   return (pid);
 }
 
+#if defined (HAVE_POSIX_SPAWN)
+/* Start PATH with arguments ARGS and environment ENV using posix_spawn.
+   ACTIONS does the file descriptor work the child would do after
+   make_child; the signal mask and dispositions are set to what
+   restore_original_signals and default_tty_job_signals would leave.
+   COMMAND is as for make_child.  Returns -1 if posix_spawn fails.  No
+   child is left behind, but one may have performed ACTIONS before execve
+   failed. */
+pid_t
+spawn_child (command, path, args, env, actions)
+     char *command, *path;
+     char **args, **env;
+     posix_spawn_file_actions_t *actions;
+{
+  posix_spawnattr_t attrs;
+  sigset_t defsigs;
+  pid_t pid;
+  int r, flags;
+
+  /* Discard saved memory. */
+  if (command)
+    free (command);
+
+  start_pipeline ();
+
+#if defined (BUFFERED_INPUT)
+  if (default_buffered_input != -1)
+    sync_buffered_stream (default_buffered_input);
+#endif /* BUFFERED_INPUT */
+
+  posix_spawnattr_init (&attrs);
+  flags = POSIX_SPAWN_SETSIGDEF|SPAWN_USEVFORK;
+
+  sigemptyset (&defsigs);
+  get_original_signal_defaults (&defsigs);
+#if defined (SIGTSTP)
+  sigaddset (&defsigs, SIGTSTP);
+  sigaddset (&defsigs, SIGTTIN);
+  sigaddset (&defsigs, SIGTTOU);
+#endif
+  posix_spawnattr_setsigdefault (&attrs, &defsigs);
+
+#if defined (HAVE_POSIX_SIGNALS)
+  flags |= POSIX_SPAWN_SETSIGMASK;
+  posix_spawnattr_setsigmask (&attrs, &top_level_mask);
+#endif
+  posix_spawnattr_setflags (&attrs, flags);
+
+  r = posix_spawn (&pid, path, actions, &attrs, args, env);
+  posix_spawnattr_destroy (&attrs);
+
+  if (r != 0)
+    {
+      errno = r;
+      return (-1);
+    }
+
+  last_made_pid = pid;
+  add_pid (pid, 0);
+
+  return (pid);
+}
+#endif /* HAVE_POSIX_SPAWN */
+
 void
 ignore_tty_job_signals ()
 {
@@ -48,6 +48,8 @@
 #include "trap.h"
 #include "flags.h"
 #include "parser.h"
+#include "parsecache.h"
+#include "startuptime.h"
 #include "mailcheck.h"
 #include "test.h"
 #include "builtins.h"
@@ -1425,7 +1427,11 @@ yy_readline_get ()
   if (!current_readline_line)
     {
       if (!bash_readline_initialized)
-	initialize_readline ();
+	{
+	  STARTUP_PHASE_BEGIN ("initialize_readline");
+	  initialize_readline ();
+	  STARTUP_END ();
+	}
 
 #if defined (JOB_CONTROL)
       if (job_control)
@@ -1440,6 +1446,9 @@ yy_readline_get ()
 	}
       terminate_immediately = 1;
 
+      /* The shell is ready for its first command. */
+      startup_timing_report ();
+
       current_readline_line = readline (current_readline_prompt ?
       					  current_readline_prompt : "");
 
@@ -1905,6 +1914,20 @@ free_pushed_string_input ()
 #endif
 }
 
+/* Return non-zero if the parser holds input it has read but not yet
+   consumed: the rest of the current line or a pushed-back string.  When
+   this is zero after a command has been parsed, the next command starts
+   at the current input location. */
+int
+parser_input_pending ()
+{
+#if defined (ALIAS) || defined (DPAREN_ARITHMETIC)
+  if (pushed_string_list)
+    return 1;
+#endif
+  return (shell_input_line && shell_input_line[shell_input_line_index]);
+}
+
 /* Return a line of text, taken from wherever yylex () reads input.
    If there is no more input, then we return NULL.  If REMOVE_QUOTED_NEWLINE
    is non-zero, we remove unquoted \<newline> pairs.  This is used by
@@ -2690,6 +2713,7 @@ alias_expand_token (tokstr)
 	(parser_state & PST_CASEPAT) == 0)
     {
       ap = find_alias (tokstr);
+      parse_cache_note_alias (tokstr, ap ? ap->value : (char *)NULL, ap ? ap->flags : 0);
 
       /* Currently expanding this token. */
       if (ap && (ap->flags & AL_BEINGEXPANDED))
@@ -2887,7 +2911,8 @@ reset_parser ()
       shell_input_line_size = shell_input_line_index = 0;
     }
 
-  FREE (word_desc_to_read);
+  if (word_desc_to_read)
+    dispose_word_desc (word_desc_to_read);
   word_desc_to_read = (WORD_DESC *)NULL;
 
   eol_ungetc_lookahead = 0;
@@ -4698,7 +4723,7 @@ got_token:
 #endif
     CHECK_FOR_RESERVED_WORD (token);
 
-  the_word = (WORD_DESC *)xmalloc (sizeof (WORD_DESC));
+  the_word = (WORD_DESC *)cmd_node_alloc (sizeof (WORD_DESC));
   the_word->word = (char *)xmalloc (1 + token_index);
   the_word->flags = 0;
   strcpy (the_word->word, token);
@@ -0,0 +1,1296 @@
+/* parsecache.c -- save the commands parsed from sourced files and read
+   them back instead of parsing the file again. */
+
+/* Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This file is part of GNU Bash, the Bourne Again SHell.
+
+   Bash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Bash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Bash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* When the variable BASH_PARSE_CACHE names a directory, each file read by
+   `.', `source', or as a startup file has the commands parsed from it
+   saved in that directory.  Commands are recorded one at a time, as
+   parse_and_execute () parses them, along with the parser state that
+   could change how the command parses: the shell options that affect the
+   parser and the result of each alias lookup.  The next time the same
+   file is read, parse_and_execute () takes the commands from the cache
+   instead of calling the parser, after checking the saved state against
+   the current state.  When it does not match, the rest of the file is
+   parsed normally, starting where the last cached command ended.
+
+   The cache file is keyed by the file's name, device, inode, size,
+   modification time, and contents, and by the shell version.  Anything
+   that does not match, including a damaged cache file, means the file
+   is parsed as if the cache did not exist.
+
+   Since the commands in a cache file are executed, the cache is used
+   only if the directory and the cache file belong to the effective user
+   and nobody else can write them, and never by a privileged or
+   restricted shell. */
+
+#include "config.h"
+
+#include "bashtypes.h"
+#include "posixstat.h"
+#include "filecntl.h"
+
+#if defined (HAVE_UNISTD_H)
+#  include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <errno.h>
+
+#include "bashansi.h"
+
+#include "shell.h"
+#include "flags.h"
+#include "trap.h"
+#include "input.h"
+#include "parsecache.h"
+
+#if defined (ALIAS)
+#  include "alias.h"
+#endif
+
+#if !defined (O_NOFOLLOW)
+#  define O_NOFOLLOW 0
+#endif
+
+#if !defined (errno)
+extern int errno;
+#endif
+
+extern int posixly_correct, line_number;
+extern int expand_aliases, extended_quote;
+extern int interactive_comments, dump_translatable_strings;
+#if defined (EXTENDED_GLOB)
+extern int extended_glob;
+#endif
+
+#define PC_MAGIC	"VBPC"
+#define PC_FORMAT	1
+
+/* Values for the mode of a PARSE_CACHE */
+#define PC_NONE		0	/* not reading or recording */
+#define PC_READ		1	/* returning commands from the cache */
+#define PC_WRITE	2	/* recording commands as they are parsed */
+
+/* Record types following the header in a cache file */
+#define PC_COMMAND	1
+#define PC_END		2
+
+/* Bits in the parser state saved with each command */
+#define PCS_EXTGLOB	0x01
+#define PCS_EXTQUOTE	0x02
+#define PCS_POSIX	0x04
+#define PCS_INTERACTIVE	0x08
+#define PCS_COMMENTS	0x10
+#define PCS_ALIASES	0x20
+
+/* The largest cache file we will read. */
+#define PC_MAXSIZE	(64 * 1024 * 1024)
+
+struct parse_cache {
+  int mode;
+  pid_t pid;		/* the shell that opened the cache */
+  char *path;		/* cache file name */
+  char *string;		/* the text parse_and_execute is reading */
+  size_t len;		/* and its length */
+
+  char *buf;		/* cache file contents */
+  size_t bsize;		/* bytes allocated for BUF */
+  size_t blen;		/* bytes used in BUF */
+  size_t bind;		/* read offset in BUF */
+  int error;		/* read past the end of BUF or found bad data */
+
+  int translated;	/* the command parsed used $"..." */
+  int nalias;		/* number of alias lookups in ABUF */
+  char *abuf;		/* alias lookups made parsing the current command */
+  size_t asize, alen;
+};
+
+PARSE_CACHE *parse_cache_pending = (PARSE_CACHE *)NULL;
+
+unsigned long parse_cache_hits = 0;
+unsigned long parse_cache_misses = 0;
+unsigned long parse_cache_fallbacks = 0;
+unsigned long parse_cache_writes = 0;
+
+/* The cache recording the command being parsed, if any. */
+static PARSE_CACHE *parse_cache_current = (PARSE_CACHE *)NULL;
+
+static int parse_cache_state __P((void));
+static int parse_cache_trusted __P((struct stat *));
+static int parse_cache_enabled __P((const char *));
+static char *parse_cache_filename __P((const char *, char *, struct stat *));
+static unsigned int parse_cache_checksum __P((char *, size_t));
+static int parse_cache_read __P((PARSE_CACHE *));
+static void parse_cache_header __P((PARSE_CACHE *, const char *, struct stat *, unsigned int));
+static int parse_cache_replay __P((PARSE_CACHE *));
+static void parse_cache_record __P((PARSE_CACHE *, int));
+
+static void put_bytes __P((char **, size_t *, size_t *, const char *, size_t));
+static void put_ulong __P((PARSE_CACHE *, unsigned long));
+static void put_int __P((PARSE_CACHE *, int));
+static void put_string __P((PARSE_CACHE *, const char *));
+static void put_word __P((PARSE_CACHE *, WORD_DESC *));
+static void put_words __P((PARSE_CACHE *, WORD_LIST *));
+static void put_redirects __P((PARSE_CACHE *, REDIRECT *));
+#if defined (COND_COMMAND)
+static void put_cond __P((PARSE_CACHE *, COND_COM *));
+#endif
+static void put_command __P((PARSE_CACHE *, COMMAND *));
+
+static unsigned long get_ulong __P((PARSE_CACHE *));
+static int get_int __P((PARSE_CACHE *));
+static unsigned long get_count __P((PARSE_CACHE *));
+static char *get_string __P((PARSE_CACHE *));
+static WORD_DESC *get_word __P((PARSE_CACHE *));
+static WORD_LIST *get_words __P((PARSE_CACHE *));
+static REDIRECT *get_redirects __P((PARSE_CACHE *));
+#if defined (COND_COMMAND)
+static COND_COM *get_cond __P((PARSE_CACHE *));
+#endif
+static COMMAND *get_command __P((PARSE_CACHE *));
+
+/* **************************************************************** */
+/*								    */
+/*		  Opening, Saving, and Disposing		    */
+/*								    */
+/* **************************************************************** */
+
+/* Return the parser state that a saved command depends on. */
+static int
+parse_cache_state ()
+{
+  int state;
+
+  state = 0;
+#if defined (EXTENDED_GLOB)
+  if (extended_glob)
+    state |= PCS_EXTGLOB;
+#endif
+  if (extended_quote)
+    state |= PCS_EXTQUOTE;
+  if (posixly_correct)
+    state |= PCS_POSIX;
+  if (interactive)
+    state |= PCS_INTERACTIVE;
+  if (interactive_comments)
+    state |= PCS_COMMENTS;
+  if (expand_aliases)
+    state |= PCS_ALIASES;
+  return state;
+}
+
+/* Return non-zero if the file or directory FINFO describes belongs to the
+   effective user and only the owner can write it. */
+static int
+parse_cache_trusted (finfo)
+     struct stat *finfo;
+{
+  return (finfo->st_uid == current_user.euid &&
+	  (finfo->st_mode & (S_IWGRP|S_IWOTH)) == 0);
+}
+
+/* Return non-zero if the commands saved in DIR may be used. */
+static int
+parse_cache_enabled (dir)
+     const char *dir;
+{
+  struct stat sb;
+
+  if (privileged_mode || restricted || current_user.euid != current_user.uid)
+    return 0;
+  return (stat (dir, &sb) == 0 && S_ISDIR (sb.st_mode) && parse_cache_trusted (&sb));
+}
+
+/* Return the name of the file in DIR that caches the commands in FILENAME. */
+static char *
+parse_cache_filename (dir, filename, finfo)
+     const char *dir;
+     char *filename;
+     struct stat *finfo;
+{
+  char *ret;
+
+  ret = (char *)xmalloc (strlen (dir) + 2 + 8 + 1 + INT_STRLEN_BOUND (unsigned long) + 3);
+  sprintf (ret, "%s/%08x-%lx.pc", dir, hash_string (filename),
+	   (unsigned long)finfo->st_ino);
+  return ret;
+}
+
+/* FNV-1 over the LEN bytes in S, which may contain NULs. */
+static unsigned int
+parse_cache_checksum (s, len)
+     char *s;
+     size_t len;
+{
+  unsigned int h;
+  size_t i;
+
+  for (h = 2166136261u, i = 0; i < len; i++)
+    {
+      h *= 16777619;
+      h ^= (unsigned char)s[i];
+    }
+  return h;
+}
+
+/* Read the cache file for PC into its buffer and check the trailing
+   checksum.  A symbolic link or a file someone else could have written
+   is not read.  Returns 0 on success. */
+static int
+parse_cache_read (pc)
+     PARSE_CACHE *pc;
+{
+  struct stat sb;
+  ssize_t nr;
+  unsigned int sum;
+  int fd;
+
+  fd = open (pc->path, O_RDONLY|O_NOFOLLOW);
+  if (fd < 0)
+    return -1;
+  if (fstat (fd, &sb) < 0 || S_ISREG (sb.st_mode) == 0 || parse_cache_trusted (&sb) == 0 ||
+	sb.st_size <= (off_t)sizeof (sum) || sb.st_size > PC_MAXSIZE)
+    {
+      close (fd);
+      return -1;
+    }
+
+  pc->bsize = sb.st_size;
+  pc->buf = (char *)xmalloc (pc->bsize);
+  nr = read (fd, pc->buf, pc->bsize);
+  close (fd);
+  if (nr != (ssize_t)pc->bsize)
+    return -1;
+
+  pc->blen = pc->bsize - sizeof (sum);
+  memcpy (&sum, pc->buf + pc->blen, sizeof (sum));
+  return (sum == parse_cache_checksum (pc->buf, pc->blen) ? 0 : -1);
+}
+
+/* Write the header identifying the file STRING was read from into PC. */
+static void
+parse_cache_header (pc, filename, finfo, hash)
+     PARSE_CACHE *pc;
+     const char *filename;
+     struct stat *finfo;
+     unsigned int hash;
+{
+  put_bytes (&pc->buf, &pc->bsize, &pc->blen, PC_MAGIC, sizeof (PC_MAGIC) - 1);
+  put_ulong (pc, PC_FORMAT);
+  put_string (pc, shell_version_string ());
+  put_string (pc, filename);
+  put_ulong (pc, (unsigned long)finfo->st_dev);
+  put_ulong (pc, (unsigned long)finfo->st_ino);
+  put_ulong (pc, (unsigned long)finfo->st_size);
+  put_ulong (pc, (unsigned long)finfo->st_mtime);
+  put_ulong (pc, (unsigned long)pc->len);
+  put_ulong (pc, hash);
+}
+
+/* Set up to read the commands in STRING, LEN bytes read from FILENAME,
+   from the parse cache, or to record them as they are parsed.  FINFO is
+   the result of stat(2) on FILENAME.  Returns NULL if the parse cache is
+   not enabled. */
+PARSE_CACHE *
+parse_cache_open (filename, string, len, finfo)
+     const char *filename;
+     char *string;
+     size_t len;
+     struct stat *finfo;
+{
+  PARSE_CACHE *pc;
+  char *dir, *header;
+  unsigned int hash;
+  size_t hlen, hsize;
+
+  dir = get_string_value ("BASH_PARSE_CACHE");
+  if (dir == 0 || *dir == 0 || dump_translatable_strings || echo_input_at_read ||
+      S_ISREG (finfo->st_mode) == 0 || parse_cache_enabled (dir) == 0)
+    return ((PARSE_CACHE *)NULL);
+
+  pc = (PARSE_CACHE *)xmalloc (sizeof (PARSE_CACHE));
+  pc->mode = PC_NONE;
+  pc->pid = getpid ();
+  pc->path = parse_cache_filename (dir, (char *)filename, finfo);
+  pc->string = string;
+  pc->len = len;
+  pc->buf = pc->abuf = (char *)NULL;
+  pc->bsize = pc->blen = pc->bind = pc->asize = pc->alen = 0;
+  pc->error = pc->translated = pc->nalias = 0;
+
+  /* Build the header we expect and compare it with the cache file's. */
+  hash = hash_string (string);
+  parse_cache_header (pc, filename, finfo, hash);
+  header = pc->buf;
+  hlen = pc->blen;
+  hsize = pc->bsize;
+
+  pc->buf = (char *)NULL;
+  if (parse_cache_read (pc) == 0 && pc->blen > hlen && memcmp (pc->buf, header, hlen) == 0)
+    {
+      free (header);
+      pc->mode = PC_READ;
+      pc->bind = hlen;
+      parse_cache_hits++;
+      return pc;
+    }
+
+  /* Start recording, with the header already in place. */
+  FREE (pc->buf);
+  pc->buf = header;
+  pc->blen = hlen;
+  pc->bsize = hsize;
+  pc->bind = 0;
+  pc->mode = PC_WRITE;
+  parse_cache_misses++;
+  return pc;
+}
+
+/* Stop reading or recording commands.  Used when the parse of a recorded
+   command is interrupted, or the cache no longer matches. */
+void
+parse_cache_abort (pc)
+     PARSE_CACHE *pc;
+{
+  if (pc == 0)
+    return;
+  if (parse_cache_current == pc)
+    parse_cache_current = (PARSE_CACHE *)NULL;
+  pc->mode = PC_NONE;
+  FREE (pc->buf);
+  pc->buf = (char *)NULL;
+  pc->bsize = pc->blen = pc->bind = 0;
+}
+
+/* All of the commands in the file have been recorded: write the cache
+   file.  The file is written under a temporary name and renamed, so
+   other shells never read a partial file. */
+void
+parse_cache_save (pc)
+     PARSE_CACHE *pc;
+{
+  char *tmp;
+  unsigned int sum;
+  int fd;
+  ssize_t nw;
+
+  if (pc == 0 || pc->mode != PC_WRITE || pc->pid != getpid ())
+    return;
+
+  put_ulong (pc, PC_END);
+  put_int (pc, line_number);
+  put_ulong (pc, (unsigned long)pc->len);
+  sum = parse_cache_checksum (pc->buf, pc->blen);
+  put_bytes (&pc->buf, &pc->bsize, &pc->blen, (char *)&sum, sizeof (sum));
+
+  tmp = (char *)xmalloc (strlen (pc->path) + INT_STRLEN_BOUND (long) + 2);
+  sprintf (tmp, "%s.%ld", pc->path, (long)pc->pid);
+  fd = open (tmp, O_WRONLY|O_CREAT|O_TRUNC|O_EXCL|O_NOFOLLOW, 0600);
+  if (fd >= 0)
+    {
+      nw = write (fd, pc->buf, pc->blen);
+      if (close (fd) == 0 && nw == (ssize_t)pc->blen && rename (tmp, pc->path) == 0)
+	parse_cache_writes++;
+      else
+	unlink (tmp);
+    }
+  free (tmp);
+  parse_cache_abort (pc);
+}
+
+void
+parse_cache_dispose (pc)
+     PARSE_CACHE *pc;
+{
+  parse_cache_abort (pc);
+  free (pc->path);
+  FREE (pc->abuf);
+  free (pc);
+}
+
+/* **************************************************************** */
+/*								    */
+/*		   Reading and Recording Commands		    */
+/*								    */
+/* **************************************************************** */
+
+#if defined (ALIAS)
+/* The parser looked up NAME as an alias; VALUE and FLAGS describe the
+   alias it found, if VALUE is non-null.  Each lookup is saved as three
+   strings: the name, the value, and "0" if there was no alias, "1" if
+   there was, or "2" if it was an alias whose expansion is also checked
+   for aliases. */
+void
+parse_cache_note_alias (name, value, flags)
+     char *name, *value;
+     int flags;
+{
+  PARSE_CACHE *pc;
+
+  if ((pc = parse_cache_current) == 0)
+    return;
+  put_bytes (&pc->abuf, &pc->asize, &pc->alen, name, strlen (name) + 1);
+  if (value)
+    put_bytes (&pc->abuf, &pc->asize, &pc->alen, value, strlen (value));
+  put_bytes (&pc->abuf, &pc->asize, &pc->alen, "", 1);
+  put_bytes (&pc->abuf, &pc->asize, &pc->alen, value ? ((flags & AL_EXPANDNEXT) ? "2" : "1") : "0", 2);
+  pc->nalias++;
+}
+#endif /* ALIAS */
+
+/* The parser translated a $"..." string. */
+void
+parse_cache_note_translation ()
+{
+  if (parse_cache_current)
+    parse_cache_current->translated = 1;
+}
+
+/* Parse the next command from the input, or take it from PC.  Returns
+   what parse_command () would return, leaving the command in
+   global_command. */
+int
+parse_cache_parse_command (pc)
+     PARSE_CACHE *pc;
+{
+  int r, state;
+
+  /* With set -v the parser echoes its input as it reads it, which taking
+     a command from the cache would skip. */
+  if (pc && pc->mode != PC_NONE && echo_input_at_read)
+    {
+      if (pc->mode == PC_READ)
+	parse_cache_fallbacks++;
+      parse_cache_abort (pc);
+    }
+
+  if (pc && pc->mode == PC_READ)
+    {
+      if (parse_cache_replay (pc) == 0)
+	return 0;
+      parse_cache_fallbacks++;
+      parse_cache_abort (pc);
+    }
+
+  if (pc == 0 || pc->mode != PC_WRITE)
+    return (parse_command ());
+
+  /* Run pending traps now, so their commands are not recorded as part of
+     this one. */
+  run_pending_traps ();
+
+  state = parse_cache_state ();
+  pc->nalias = pc->translated = 0;
+  pc->alen = 0;
+  parse_cache_current = pc;
+
+  r = parse_command ();
+
+  if (parse_cache_current != pc || r != 0 || pc->translated ||
+	(state & PCS_INTERACTIVE) || state != parse_cache_state () ||
+	parser_input_pending ())
+    parse_cache_abort (pc);
+  else
+    {
+      parse_cache_current = (PARSE_CACHE *)NULL;
+      if (global_command)
+	parse_cache_record (pc, state);
+    }
+  return r;
+}
+
+/* Append the command just parsed to PC, with the parser state STATE and
+   the alias lookups made while parsing it. */
+static void
+parse_cache_record (pc, state)
+     PARSE_CACHE *pc;
+     int state;
+{
+  put_ulong (pc, PC_COMMAND);
+  put_int (pc, state);
+  put_ulong (pc, (unsigned long)pc->nalias);
+  put_ulong (pc, (unsigned long)pc->alen);
+  if (pc->alen)
+    put_bytes (&pc->buf, &pc->bsize, &pc->blen, pc->abuf, pc->alen);
+  put_int (pc, line_number);
+  put_ulong (pc, (unsigned long)(bash_input.location.string - pc->string));
+  put_command (pc, global_command);
+}
+
+/* Take the next command from PC, after checking that the parser state and
+   aliases it was parsed with still hold.  Returns 0 and leaves the input
+   where the parser would have left it if the command can be used, -1 if
+   the rest of the input has to be parsed. */
+static int
+parse_cache_replay (pc)
+     PARSE_CACHE *pc;
+{
+  unsigned long type, n, alen, offset;
+  int line;
+  char *s, *end, *name, *value;
+  COMMAND *command;
+#if defined (ALIAS)
+  alias_t *ap;
+#endif
+
+  /* parse_command () would run these before parsing the command. */
+  run_pending_traps ();
+
+  type = get_ulong (pc);
+  if (type == PC_COMMAND)
+    {
+      if (get_int (pc) != parse_cache_state ())
+	return -1;
+
+      n = get_ulong (pc);
+      alen = get_ulong (pc);
+      if (pc->error || alen > pc->blen - pc->bind || (alen && pc->buf[pc->bind + alen - 1]))
+	return -1;
+      end = pc->buf + pc->bind + alen;
+      for (s = pc->buf + pc->bind; n--; s += strlen (s) + 1)
+	{
+	  name = s;
+	  value = (name < end) ? name + strlen (name) + 1 : end;
+	  s = (value < end) ? value + strlen (value) + 1 : end;
+	  if (s >= end)
+	    return -1;
+#if defined (ALIAS)
+	  ap = find_alias (name);
+	  if (*s == '0' ? (ap != 0) : (ap == 0 || STREQ (ap->value, value) == 0 ||
+		((ap->flags & AL_EXPANDNEXT) != 0) != (*s == '2')))
+	    return -1;
+#else
+	  if (*s != '0')
+	    return -1;
+#endif
+	}
+      pc->bind += alen;
+
+      line = get_int (pc);
+      offset = get_ulong (pc);
+      command = get_command (pc);
+      if (pc->error || offset > pc->len)
+	{
+	  dispose_command (command);
+	  return -1;
+	}
+    }
+  else if (type == PC_END)
+    {
+      line = get_int (pc);
+      offset = get_ulong (pc);
+      if (pc->error || offset != pc->len)
+	return -1;
+      command = (COMMAND *)NULL;
+    }
+  else
+    return -1;
+
+  bash_input.location.string = pc->string + offset;
+  line_number = line;
+  global_command = command;
+  return 0;
+}
+
+/* **************************************************************** */
+/*								    */
+/*		   Writing Commands to the Buffer		    */
+/*								    */
+/* **************************************************************** */
+
+/* Numbers are written seven bits at a time, low-order bits first; signed
+   numbers are folded so that small negative numbers stay small. */
+
+static void
+put_bytes (bufp, sizep, lenp, s, n)
+     char **bufp;
+     size_t *sizep, *lenp;
+     const char *s;
+     size_t n;
+{
+  if (*lenp + n >= *sizep)
+    {
+      while (*lenp + n >= *sizep)
+	*sizep = *sizep ? *sizep * 2 : 1024;
+      *bufp = (char *)xrealloc (*bufp, *sizep);
+    }
+  memcpy (*bufp + *lenp, s, n);
+  *lenp += n;
+}
+
+static void
+put_ulong (pc, n)
+     PARSE_CACHE *pc;
+     unsigned long n;
+{
+  char b[(sizeof (unsigned long) * 8 + 6) / 7];
+  int i;
+
+  i = 0;
+  do
+    {
+      b[i] = n & 0x7f;
+      n >>= 7;
+      if (n)
+	b[i] |= 0x80;
+      i++;
+    }
+  while (n);
+  put_bytes (&pc->buf, &pc->bsize, &pc->blen, b, i);
+}
+
+static void
+put_int (pc, n)
+     PARSE_CACHE *pc;
+     int n;
+{
+  put_ulong (pc, n < 0 ? ((~(unsigned long)n) << 1) | 1 : (unsigned long)n << 1);
+}
+
+/* Strings are written as their length plus one, so a null pointer can be
+   written as 0. */
+static void
+put_string (pc, s)
+     PARSE_CACHE *pc;
+     const char *s;
+{
+  size_t n;
+
+  if (s == 0)
+    {
+      put_ulong (pc, 0);
+      return;
+    }
+  n = strlen (s);
+  put_ulong (pc, n + 1);
+  put_bytes (&pc->buf, &pc->bsize, &pc->blen, s, n);
+}
+
+static void
+put_word (pc, w)
+     PARSE_CACHE *pc;
+     WORD_DESC *w;
+{
+  put_string (pc, w->word);
+  put_int (pc, w->flags);
+}
+
+static void
+put_words (pc, list)
+     PARSE_CACHE *pc;
+     WORD_LIST *list;
+{
+  put_ulong (pc, list_length (list));
+  for ( ; list; list = list->next)
+    put_word (pc, list->word);
+}
+
+static void
+put_redirects (pc, list)
+     PARSE_CACHE *pc;
+     REDIRECT *list;
+{
+  REDIRECT *r;
+
+  put_ulong (pc, list_length (list));
+  for (r = list; r; r = r->next)
+    {
+      put_int (pc, r->rflags);
+      put_int (pc, r->flags);
+      put_ulong (pc, r->instruction);
+      if (r->rflags & REDIR_VARASSIGN)
+	put_word (pc, r->redirector.filename);
+      else
+	put_int (pc, r->redirector.dest);
+
+      switch (r->instruction)
+	{
+	case r_reading_until:
+	case r_deblank_reading_until:
+	  put_string (pc, r->here_doc_eof);
+	  /*FALLTHROUGH*/
+	case r_reading_string:
+	case r_appending_to:
+	case r_output_direction:
+	case r_input_direction:
+	case r_inputa_direction:
+	case r_err_and_out:
+	case r_append_err_and_out:
+	case r_input_output:
+	case r_output_force:
+	case r_duplicating_input_word:
+	case r_duplicating_output_word:
+	case r_move_input_word:
+	case r_move_output_word:
+	  put_word (pc, r->redirectee.filename);
+	  break;
+	case r_duplicating_input:
+	case r_duplicating_output:
+	case r_move_input:
+	case r_move_output:
+	case r_close_this:
+	  put_int (pc, r->redirectee.dest);
+	  break;
+	}
+    }
+}
+
+#if defined (COND_COMMAND)
+static void
+put_cond (pc, cond)
+     PARSE_CACHE *pc;
+     COND_COM *cond;
+{
+  if (cond == 0)
+    {
+      put_ulong (pc, 0);
+      return;
+    }
+  put_ulong (pc, 1);
+  put_int (pc, cond->flags);
+  put_int (pc, cond->line);
+  put_int (pc, cond->type);
+  put_ulong (pc, cond->op != 0);
+  if (cond->op)
+    put_word (pc, cond->op);
+  put_cond (pc, cond->left);
+  put_cond (pc, cond->right);
+}
+#endif
+
+/* A command is written as its type plus one, so a null command can be
+   written as 0, followed by the fields that copy_command () copies. */
+static void
+put_command (pc, command)
+     PARSE_CACHE *pc;
+     COMMAND *command;
+{
+  PATTERN_LIST *p;
+
+  if (command == 0)
+    {
+      put_ulong (pc, 0);
+      return;
+    }
+
+  put_ulong (pc, (unsigned long)command->type + 1);
+  put_int (pc, command->flags);
+  put_int (pc, command->line);
+  put_redirects (pc, command->redirects);
+
+  switch (command->type)
+    {
+    case cm_for:
+#if defined (SELECT_COMMAND)
+    case cm_select:
+#endif
+      {
+	FOR_COM *c;
+
+#if defined (SELECT_COMMAND)
+	if (command->type == cm_select)
+	  c = (FOR_COM *)command->value.Select;
+	else
+#endif
+	c = command->value.For;
+	put_int (pc, c->flags);
+	put_int (pc, c->line);
+	put_word (pc, c->name);
+	put_words (pc, c->map_list);
+	put_command (pc, c->action);
+	break;
+      }
+
+#if defined (ARITH_FOR_COMMAND)
+    case cm_arith_for:
+      put_int (pc, command->value.ArithFor->flags);
+      put_int (pc, command->value.ArithFor->line);
+      put_words (pc, command->value.ArithFor->init);
+      put_words (pc, command->value.ArithFor->test);
+      put_words (pc, command->value.ArithFor->step);
+      put_command (pc, command->value.ArithFor->action);
+      break;
+#endif
+
+    case cm_group:
+      put_int (pc, command->value.Group->ignore);
+      put_command (pc, command->value.Group->command);
+      break;
+
+    case cm_subshell:
+      put_int (pc, command->value.Subshell->flags);
+      put_command (pc, command->value.Subshell->command);
+      break;
+
+    case cm_coproc:
+      put_int (pc, command->value.Coproc->flags);
+      put_string (pc, command->value.Coproc->name);
+      put_command (pc, command->value.Coproc->command);
+      break;
+
+    case cm_case:
+      put_int (pc, command->value.Case->flags);
+      put_int (pc, command->value.Case->line);
+      put_word (pc, command->value.Case->word);
+      put_ulong (pc, list_length (command->value.Case->clauses));
+      for (p = command->value.Case->clauses; p; p = p->next)
+	{
+	  put_int (pc, p->flags);
+	  put_words (pc, p->patterns);
+	  put_command (pc, p->action);
+	}
+      break;
+
+    case cm_until:
+    case cm_while:
+      put_int (pc, command->value.While->flags);
+      put_command (pc, command->value.While->test);
+      put_command (pc, command->value.While->action);
+      break;
+
+    case cm_if:
+      put_int (pc, command->value.If->flags);
+      put_command (pc, command->value.If->test);
+      put_command (pc, command->value.If->true_case);
+      put_command (pc, command->value.If->false_case);
+      break;
+
+#if defined (DPAREN_ARITHMETIC)
+    case cm_arith:
+      put_int (pc, command->value.Arith->flags);
+      put_int (pc, command->value.Arith->line);
+      put_words (pc, command->value.Arith->exp);
+      break;
+#endif
+
+#if defined (COND_COMMAND)
+    case cm_cond:
+      put_cond (pc, command->value.Cond);
+      break;
+#endif
+
+    case cm_simple:
+      put_int (pc, command->value.Simple->flags);
+      put_int (pc, command->value.Simple->line);
+      put_words (pc, command->value.Simple->words);
+      put_redirects (pc, command->value.Simple->redirects);
+      break;
+
+    case cm_connection:
+      put_int (pc, command->value.Connection->ignore);
+      put_int (pc, command->value.Connection->connector);
+      put_command (pc, command->value.Connection->first);
+      put_command (pc, command->value.Connection->second);
+      break;
+
+    case cm_function_def:
+      put_int (pc, command->value.Function_def->flags);
+      put_int (pc, command->value.Function_def->line);
+      put_word (pc, command->value.Function_def->name);
+      put_string (pc, command->value.Function_def->source_file);
+      put_command (pc, command->value.Function_def->command);
+      break;
+    }
+}
+
+/* **************************************************************** */
+/*								    */
+/*		  Reading Commands from the Buffer		    */
+/*								    */
+/* **************************************************************** */
+
+/* These set PC->error when they run out of data or find something that
+   cannot be right, but they always return a complete structure that
+   dispose_command () can free, so the callers need not check for errors
+   until the whole command has been read. */
+
+static unsigned long
+get_ulong (pc)
+     PARSE_CACHE *pc;
+{
+  unsigned long n;
+  unsigned int shift;
+  unsigned char c;
+
+  n = shift = 0;
+  do
+    {
+      if (pc->bind >= pc->blen || shift >= sizeof (unsigned long) * 8)
+	{
+	  pc->error = 1;
+	  return 0;
+	}
+      c = pc->buf[pc->bind++];
+      n |= (unsigned long)(c & 0x7f) << shift;
+      shift += 7;
+    }
+  while (c & 0x80);
+  return n;
+}
+
+static int
+get_int (pc)
+     PARSE_CACHE *pc;
+{
+  unsigned long n;
+
+  n = get_ulong (pc);
+  return ((n & 1) ? (int)~(n >> 1) : (int)(n >> 1));
+}
+
+static char *
+get_string (pc)
+     PARSE_CACHE *pc;
+{
+  unsigned long n;
+  char *s;
+
+  n = get_ulong (pc);
+  if (n-- == 0)
+    return ((char *)NULL);
+  if (n > pc->blen - pc->bind)
+    {
+      pc->error = 1;
+      return ((char *)NULL);
+    }
+  s = (char *)xmalloc (n + 1);
+  memcpy (s, pc->buf + pc->bind, n);
+  s[n] = '\0';
+  pc->bind += n;
+  return s;
+}
+
+static WORD_DESC *
+get_word (pc)
+     PARSE_CACHE *pc;
+{
+  WORD_DESC *w;
+
+  w = alloc_word_desc ();
+  w->word = get_string (pc);
+  if (w->word == 0)
+    w->word = savestring ("");
+  w->flags = get_int (pc);
+  return w;
+}
+
+/* Return a count of list elements.  Each element takes at least one byte,
+   so a count larger than the data left is an error. */
+static unsigned long
+get_count (pc)
+     PARSE_CACHE *pc;
+{
+  unsigned long n;
+
+  n = get_ulong (pc);
+  if (n > pc->blen - pc->bind)
+    {
+      pc->error = 1;
+      return 0;
+    }
+  return n;
+}
+
+static WORD_LIST *
+get_words (pc)
+     PARSE_CACHE *pc;
+{
+  WORD_LIST *list;
+  unsigned long n;
+
+  for (list = (WORD_LIST *)NULL, n = get_count (pc); n; n--)
+    list = make_word_list (get_word (pc), list);
+  return (REVERSE_LIST (list, WORD_LIST *));
+}
+
+static REDIRECT *
+get_redirects (pc)
+     PARSE_CACHE *pc;
+{
+  REDIRECT *list, *r;
+  unsigned long n;
+
+  for (list = (REDIRECT *)NULL, n = get_count (pc); n; n--)
+    {
+      r = (REDIRECT *)cmd_node_alloc (sizeof (REDIRECT));
+      r->rflags = get_int (pc);
+      r->flags = get_int (pc);
+      r->instruction = (enum r_instruction)get_ulong (pc);
+      if (r->instruction > r_append_err_and_out)
+	{
+	  pc->error = 1;
+	  r->instruction = r_close_this;
+	}
+      if (r->rflags & REDIR_VARASSIGN)
+	r->redirector.filename = get_word (pc);
+      else
+	r->redirector.dest = get_int (pc);
+      r->here_doc_eof = (char *)NULL;
+
+      switch (r->instruction)
+	{
+	case r_reading_until:
+	case r_deblank_reading_until:
+	  r->here_doc_eof = get_string (pc);
+	  if (r->here_doc_eof == 0)
+	    r->here_doc_eof = savestring ("");
+	  /*FALLTHROUGH*/
+	case r_reading_string:
+	case r_appending_to:
+	case r_output_direction:
+	case r_input_direction:
+	case r_inputa_direction:
+	case r_err_and_out:
+	case r_append_err_and_out:
+	case r_input_output:
+	case r_output_force:
+	case r_duplicating_input_word:
+	case r_duplicating_output_word:
+	case r_move_input_word:
+	case r_move_output_word:
+	  r->redirectee.filename = get_word (pc);
+	  break;
+	case r_duplicating_input:
+	case r_duplicating_output:
+	case r_move_input:
+	case r_move_output:
+	case r_close_this:
+	  r->redirectee.dest = get_int (pc);
+	  break;
+	}
+      r->next = list;
+      list = r;
+    }
+  return (REVERSE_LIST (list, REDIRECT *));
+}
+
+#if defined (COND_COMMAND)
+static COND_COM *
+get_cond (pc)
+     PARSE_CACHE *pc;
+{
+  COND_COM *cond;
+
+  if (get_ulong (pc) == 0)
+    return ((COND_COM *)NULL);
+
+  cond = (COND_COM *)cmd_node_alloc (sizeof (COND_COM));
+  cond->flags = get_int (pc);
+  cond->line = get_int (pc);
+  cond->type = get_int (pc);
+  cond->op = get_ulong (pc) ? get_word (pc) : (WORD_DESC *)NULL;
+  cond->left = get_cond (pc);
+  cond->right = get_cond (pc);
+  return cond;
+}
+#endif
+
+static COMMAND *
+get_command (pc)
+     PARSE_CACHE *pc;
+{
+  COMMAND *command;
+  PATTERN_LIST *clauses, *p;
+  FUNCTION_DEF *f;
+  unsigned long type, n;
+#if defined (DEBUGGER) && defined (ARRAY_VARS)
+  SHELL_VAR *bash_source_v;
+  ARRAY *bash_source_a;
+#endif
+
+  type = get_ulong (pc);
+  if (type-- == 0 || pc->error)
+    return ((COMMAND *)NULL);
+
+  command = (COMMAND *)cmd_node_alloc (sizeof (COMMAND));
+  command->type = (enum command_type)type;
+  command->flags = get_int (pc);
+  command->line = get_int (pc);
+  command->redirects = get_redirects (pc);
+
+  switch (command->type)
+    {
+    case cm_for:
+#if defined (SELECT_COMMAND)
+    case cm_select:
+#endif
+      {
+	FOR_COM *c;
+
+	c = (FOR_COM *)cmd_node_alloc (sizeof (FOR_COM));
+	c->flags = get_int (pc);
+	c->line = get_int (pc);
+	c->name = get_word (pc);
+	c->map_list = get_words (pc);
+	c->action = get_command (pc);
+#if defined (SELECT_COMMAND)
+	if (command->type == cm_select)
+	  command->value.Select = (SELECT_COM *)c;
+	else
+#endif
+	command->value.For = c;
+	break;
+      }
+
+#if defined (ARITH_FOR_COMMAND)
+    case cm_arith_for:
+      command->value.ArithFor = (ARITH_FOR_COM *)cmd_node_alloc (sizeof (ARITH_FOR_COM));
+      command->value.ArithFor->flags = get_int (pc);
+      command->value.ArithFor->line = get_int (pc);
+      command->value.ArithFor->init = get_words (pc);
+      command->value.ArithFor->test = get_words (pc);
+      command->value.ArithFor->step = get_words (pc);
+      command->value.ArithFor->action = get_command (pc);
+      break;
+#endif
+
+    case cm_group:
+      command->value.Group = (GROUP_COM *)cmd_node_alloc (sizeof (GROUP_COM));
+      command->value.Group->ignore = get_int (pc);
+      command->value.Group->command = get_command (pc);
+      break;
+
+    case cm_subshell:
+      command->value.Subshell = (SUBSHELL_COM *)cmd_node_alloc (sizeof (SUBSHELL_COM));
+      command->value.Subshell->flags = get_int (pc);
+      command->value.Subshell->command = get_command (pc);
+      break;
+
+    case cm_coproc:
+      command->value.Coproc = (COPROC_COM *)cmd_node_alloc (sizeof (COPROC_COM));
+      command->value.Coproc->flags = get_int (pc);
+      command->value.Coproc->name = get_string (pc);
+      if (command->value.Coproc->name == 0)
+	command->value.Coproc->name = savestring ("");
+      command->value.Coproc->command = get_command (pc);
+      break;
+
+    case cm_case:
+      command->value.Case = (CASE_COM *)cmd_node_alloc (sizeof (CASE_COM));
+      command->value.Case->flags = get_int (pc);
+      command->value.Case->line = get_int (pc);
+      command->value.Case->word = get_word (pc);
+      for (clauses = (PATTERN_LIST *)NULL, n = get_count (pc); n; n--)
+	{
+	  p = (PATTERN_LIST *)cmd_node_alloc (sizeof (PATTERN_LIST));
+	  p->flags = get_int (pc);
+	  p->patterns = get_words (pc);
+	  p->action = get_command (pc);
+	  p->next = clauses;
+	  clauses = p;
+	}
+      command->value.Case->clauses = REVERSE_LIST (clauses, PATTERN_LIST *);
+      break;
+
+    case cm_until:
+    case cm_while:
+      command->value.While = (WHILE_COM *)cmd_node_alloc (sizeof (WHILE_COM));
+      command->value.While->flags = get_int (pc);
+      command->value.While->test = get_command (pc);
+      command->value.While->action = get_command (pc);
+      break;
+
+    case cm_if:
+      command->value.If = (IF_COM *)cmd_node_alloc (sizeof (IF_COM));
+      command->value.If->flags = get_int (pc);
+      command->value.If->test = get_command (pc);
+      command->value.If->true_case = get_command (pc);
+      command->value.If->false_case = get_command (pc);
+      break;
+
+#if defined (DPAREN_ARITHMETIC)
+    case cm_arith:
+      command->value.Arith = (ARITH_COM *)cmd_node_alloc (sizeof (ARITH_COM));
+      command->value.Arith->flags = get_int (pc);
+      command->value.Arith->line = get_int (pc);
+      command->value.Arith->exp = get_words (pc);
+      break;
+#endif
+
+#if defined (COND_COMMAND)
+    case cm_cond:
+      command->value.Cond = get_cond (pc);
+      if (command->value.Cond == 0)
+	{
+	  /* dispose_command () needs a node to free */
+	  pc->error = 1;
+	  command->value.Cond = (COND_COM *)cmd_node_alloc (sizeof (COND_COM));
+	  command->value.Cond->op = (WORD_DESC *)NULL;
+	  command->value.Cond->left = command->value.Cond->right = (COND_COM *)NULL;
+	}
+      break;
+#endif
+
+    case cm_simple:
+      command->value.Simple = (SIMPLE_COM *)cmd_node_alloc (sizeof (SIMPLE_COM));
+      command->value.Simple->flags = get_int (pc);
+      command->value.Simple->line = get_int (pc);
+      command->value.Simple->words = get_words (pc);
+      command->value.Simple->redirects = get_redirects (pc);
+      break;
+
+    case cm_connection:
+      command->value.Connection = (CONNECTION *)cmd_node_alloc (sizeof (CONNECTION));
+      command->value.Connection->ignore = get_int (pc);
+      command->value.Connection->connector = get_int (pc);
+      command->value.Connection->first = get_command (pc);
+      command->value.Connection->second = get_command (pc);
+      break;
+
+    case cm_function_def:
+      f = (FUNCTION_DEF *)cmd_node_alloc (sizeof (FUNCTION_DEF));
+      f->flags = get_int (pc);
+      f->line = get_int (pc);
+      f->name = get_word (pc);
+      f->source_file = get_string (pc);
+      f->command = get_command (pc);
+      command->value.Function_def = f;
+
+      /* make_function_def () records where the function was defined as
+	 the command is parsed. */
+#if defined (DEBUGGER)
+      if (pc->error == 0 && f->command)
+	{
+	  char *sfile;
+
+	  sfile = f->source_file;
+#  if defined (ARRAY_VARS)
+	  GET_ARRAY_FROM_VAR ("BASH_SOURCE", bash_source_v, bash_source_a);
+	  if (bash_source_a && array_num_elements (bash_source_a) > 0)
+	    f->source_file = array_reference (bash_source_a, 0);
+#  endif
+	  bind_function_def (f->name->word, f);
+	  f->source_file = sfile;
+	}
+#endif
+      break;
+
+    default:
+      /* A type we don't know how to read: turn it into an empty simple
+	 command so it can be disposed. */
+      pc->error = 1;
+      command->type = cm_simple;
+      command->value.Simple = (SIMPLE_COM *)cmd_node_alloc (sizeof (SIMPLE_COM));
+      command->value.Simple->words = (WORD_LIST *)NULL;
+      command->value.Simple->redirects = (REDIRECT *)NULL;
+      break;
+    }
+  return command;
+}
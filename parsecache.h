@@ -0,0 +1,46 @@
+/* parsecache.h -- Functions appearing in parsecache.c. */
+
+/* Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This file is part of GNU Bash, the Bourne Again SHell.
+
+   Bash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Bash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Bash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined (_PARSECACHE_H_)
+#define _PARSECACHE_H_
+
+#include "stdc.h"
+#include "posixstat.h"
+
+/* The saved parse of a file being read by parse_and_execute (), or the
+   record of the parse being made.  Opaque outside of parsecache.c. */
+typedef struct parse_cache PARSE_CACHE;
+
+/* Handed from _evalfile () to the next call to parse_and_execute (). */
+extern PARSE_CACHE *parse_cache_pending;
+
+extern unsigned long parse_cache_hits, parse_cache_misses;
+extern unsigned long parse_cache_fallbacks, parse_cache_writes;
+
+extern PARSE_CACHE *parse_cache_open __P((const char *, char *, size_t, struct stat *));
+extern int parse_cache_parse_command __P((PARSE_CACHE *));
+extern void parse_cache_abort __P((PARSE_CACHE *));
+extern void parse_cache_save __P((PARSE_CACHE *));
+extern void parse_cache_dispose __P((PARSE_CACHE *));
+
+extern void parse_cache_note_alias __P((char *, char *, int));
+extern void parse_cache_note_translation __P((void));
+
+#endif /* _PARSECACHE_H_ */
@@ -0,0 +1,504 @@
+/* pathindex.c -- remember the names in directories searched for commands. */
+
+/* Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This file is part of GNU Bash, the Bourne Again SHell.
+
+   Bash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Bash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Bash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* An index of a directory is a sorted list of the names in it, read once
+   and used both to complete command names and to skip directories that
+   cannot contain a command while searching $PATH.
+
+   An index is used only while the directory is unchanged.  Where inotify
+   is available, the shell watches each indexed directory and reads the
+   pending notifications before using an index, so a single read covers
+   every directory.  Otherwise, and in subshells, which share the parent's
+   inotify descriptor and must not consume its notifications, the
+   directory's device, inode, and modification time are compared with
+   those it had when it was read.  An index read during the same second
+   the directory was last modified is not trusted, since a later change
+   in that second would not change the modification time.
+
+   Searching $PATH for a command uses an index only when notifications
+   are available, since checking a directory's modification time costs as
+   much as looking for the command in it, and only after the directory
+   has been searched a few times, so that scripts running a handful of
+   commands do not pay for reading large directories.  Completion indexes
+   every absolute directory in $PATH the first time it is used.
+
+   Callers call path_index_sync () before a search or completion, which
+   reads the notifications once for all the directories looked at. */
+
+#include "config.h"
+
+#include "bashtypes.h"
+#include "posixstat.h"
+#include "posixdir.h"
+#include "posixtime.h"
+#include "filecntl.h"
+
+#if defined (HAVE_UNISTD_H)
+#  include <unistd.h>
+#endif
+
+#include <stdio.h>
+
+#include "bashansi.h"
+
+#include "shell.h"
+#include "hashlib.h"
+#include "pathindex.h"
+
+#if defined (HAVE_SYS_INOTIFY_H) && defined (HAVE_INOTIFY_INIT1)
+#  include <sys/inotify.h>
+#  define PATH_INDEX_INOTIFY
+#endif
+
+/* The most directories indexed at once. */
+#define PATH_INDEX_MAX		256
+#define PATH_INDEX_BUCKETS	64
+
+/* Searches of a directory for a command before it is indexed. */
+#define PATH_INDEX_LOOKUPS	4
+
+typedef struct path_index {
+  char *dir;			/* the key in PATH_INDEXES */
+  char **names;			/* sorted; point into NAMEBUF */
+  char *namebuf;
+  int nnames;
+  int flags;
+  int lookups;			/* searches since the index was last valid */
+  int wd;			/* inotify watch descriptor, or -1 */
+  dev_t dev;
+  ino_t ino;
+  time_t mtime;			/* DIR's modification time when read */
+  time_t stamp;			/* when DIR was read */
+} PATH_INDEX;
+
+/* Values for PATH_INDEX flags */
+#define PI_VALID	0x01	/* NAMES holds the directory's contents */
+#define PI_NOINDEX	0x02	/* the directory cannot be read */
+
+int path_index_enabled = 1;
+
+static HASH_TABLE *path_indexes;
+
+/* Non-zero if the last call to path_index_sync () found that this process
+   is notified of changes to indexed directories. */
+static int pi_notified;
+
+#if defined (PATH_INDEX_INOTIFY)
+#define PI_EVENTS	(IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_DELETE_SELF|IN_MOVE_SELF|IN_ONLYDIR)
+
+static int inotify_fd = -1;
+static int inotify_failed;
+static pid_t inotify_pid;	/* the process that may read notifications */
+static dev_t inotify_dev;	/* to notice if something else takes the fd */
+static ino_t inotify_ino;
+
+static void pi_watch_init __P((void));
+static void pi_read_events __P((void));
+#endif
+
+static int pi_watching __P((void));
+static void pi_invalidate __P((int, int));
+static PATH_INDEX *pi_find __P((const char *));
+static void pi_clear __P((PATH_INDEX *));
+static int pi_current __P((PATH_INDEX *));
+static int pi_build __P((PATH_INDEX *));
+static int pi_lower __P((PATH_INDEX *, const char *, int));
+static int pi_strcmp __P((char **, char **));
+
+#if defined (PATH_INDEX_INOTIFY)
+static void
+pi_watch_init ()
+{
+  struct stat sb;
+  int fd;
+
+  fd = inotify_init1 (IN_NONBLOCK|IN_CLOEXEC);
+  if (fd < 0)
+    {
+      inotify_failed = 1;
+      return;
+    }
+  fd = move_to_high_fd (fd, 1, -1);
+  SET_CLOSE_ON_EXEC (fd);
+
+  if (fstat (fd, &sb) < 0)
+    {
+      close (fd);
+      inotify_failed = 1;
+      return;
+    }
+  inotify_fd = fd;
+  inotify_pid = getpid ();
+  inotify_dev = sb.st_dev;
+  inotify_ino = sb.st_ino;
+}
+
+/* Read the pending notifications and invalidate the indexes of the
+   directories they are about. */
+static void
+pi_read_events ()
+{
+  union {
+    struct inotify_event ev;
+    char buf[4096];
+  } u;
+  struct inotify_event *ev;
+  char *p;
+  ssize_t n;
+  int i;
+
+  while ((n = read (inotify_fd, u.buf, sizeof (u.buf))) > 0)
+    for (p = u.buf; p < u.buf + n; p += sizeof (struct inotify_event) + ev->len)
+      {
+	ev = (struct inotify_event *)p;
+	pi_invalidate ((ev->mask & IN_Q_OVERFLOW) ? -1 : ev->wd, ev->mask & IN_IGNORED);
+      }
+}
+#endif /* PATH_INDEX_INOTIFY */
+
+/* Mark the indexes of the directories watched with watch descriptor WD,
+   or of every directory if WD is -1, out of date.  Several names may refer
+   to the same directory.  If FORGET is non-zero, the watch has gone. */
+static void
+pi_invalidate (wd, forget)
+     int wd, forget;
+{
+  BUCKET_CONTENTS *item;
+  PATH_INDEX *pi;
+  int i;
+
+  if (path_indexes == 0)
+    return;
+
+  for (i = 0; i < path_indexes->nbuckets; i++)
+    for (item = hash_items (i, path_indexes); item; item = item->next)
+      {
+	pi = (PATH_INDEX *)item->data;
+	if (wd == -1 || pi->wd == wd)
+	  {
+	    pi->flags &= ~PI_VALID;
+	    pi->lookups = 0;
+	    if (forget)
+	      pi->wd = -1;
+	  }
+      }
+}
+
+/* Return 1 if this process is notified of changes to indexed directories,
+   after reading any notifications waiting. */
+static int
+pi_watching ()
+{
+#if defined (PATH_INDEX_INOTIFY)
+  struct stat sb;
+
+  if (inotify_fd < 0)
+    {
+      if (inotify_failed)
+	return 0;
+      pi_watch_init ();
+      return (inotify_fd >= 0);
+    }
+
+  if (getpid () != inotify_pid)
+    return 0;
+
+  if (fstat (inotify_fd, &sb) < 0 || sb.st_dev != inotify_dev || sb.st_ino != inotify_ino)
+    {
+      /* The descriptor was closed or reused by a redirection. */
+      pi_invalidate (-1, 1);
+      inotify_fd = -1;
+      inotify_failed = 1;
+      return 0;
+    }
+
+  pi_read_events ();
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+/* Return the index for DIR, creating an empty one if there is none. */
+static PATH_INDEX *
+pi_find (dir)
+     const char *dir;
+{
+  BUCKET_CONTENTS *item;
+  PATH_INDEX *pi;
+
+  item = hash_search (dir, path_indexes, 0);
+  if (item)
+    return ((PATH_INDEX *)item->data);
+
+  if (HASH_ENTRIES (path_indexes) >= PATH_INDEX_MAX)
+    path_index_flush ();
+  if (path_indexes == 0)
+    path_indexes = hash_create (PATH_INDEX_BUCKETS);
+
+  pi = (PATH_INDEX *)xmalloc (sizeof (PATH_INDEX));
+  bzero ((char *)pi, sizeof (PATH_INDEX));
+  pi->dir = savestring (dir);
+  pi->wd = -1;
+
+  item = hash_insert (pi->dir, path_indexes, HASH_NOSRCH);
+  item->data = (PTR_T)pi;
+  return (pi);
+}
+
+static void
+pi_clear (pi)
+     PATH_INDEX *pi;
+{
+  FREE (pi->names);
+  FREE (pi->namebuf);
+  pi->names = (char **)NULL;
+  pi->namebuf = (char *)NULL;
+  pi->nnames = 0;
+  pi->flags &= ~PI_VALID;
+}
+
+/* Return 1 if PI still holds the contents of its directory. */
+static int
+pi_current (pi)
+     PATH_INDEX *pi;
+{
+  struct stat sb;
+
+  if (pi_notified && pi->wd >= 0)
+    return (pi->flags & PI_VALID);
+
+  if ((pi->flags & PI_VALID) == 0 || stat (pi->dir, &sb) < 0)
+    return 0;
+  return (sb.st_dev == pi->dev && sb.st_ino == pi->ino &&
+	  sb.st_mtime == pi->mtime && pi->mtime < pi->stamp);
+}
+
+static int
+pi_strcmp (s1, s2)
+     char **s1, **s2;
+{
+  return (strcmp (*s1, *s2));
+}
+
+/* Read PI's directory.  Returns 1 if it was read, 0 if it does not exist,
+   and -1 if it cannot be read. */
+static int
+pi_build (pi)
+     PATH_INDEX *pi;
+{
+  struct stat sb;
+  struct dirent *dp;
+  DIR *d;
+  size_t used, size, len;
+  int n, i;
+  char *s;
+
+  pi_clear (pi);
+
+  /* Start watching first, so changes made while reading are noticed. */
+#if defined (PATH_INDEX_INOTIFY)
+  if (pi->wd < 0 && pi_notified)
+    pi->wd = inotify_add_watch (inotify_fd, pi->dir, PI_EVENTS);
+#endif
+
+  if (stat (pi->dir, &sb) < 0 || S_ISDIR (sb.st_mode) == 0)
+    return 0;
+
+  d = opendir (pi->dir);
+  if (d == 0)
+    {
+      pi->flags |= PI_NOINDEX;
+      return -1;
+    }
+
+  used = size = 0;
+  n = 0;
+  while (dp = readdir (d))
+    {
+      if (REAL_DIR_ENTRY (dp) == 0 || (dp->d_name[0] == '.' &&
+	    (dp->d_name[1] == '\0' || (dp->d_name[1] == '.' && dp->d_name[2] == '\0'))))
+	continue;
+      len = D_NAMLEN (dp) + 1;
+      if (used + len > size)
+	{
+	  while (used + len > size)
+	    size += 4096;
+	  pi->namebuf = (char *)xrealloc (pi->namebuf, size);
+	}
+      memcpy (pi->namebuf + used, dp->d_name, len);
+      used += len;
+      n++;
+    }
+  closedir (d);
+
+  pi->names = strvec_create (n + 1);
+  for (i = 0, s = pi->namebuf; i < n; i++, s += strlen (s) + 1)
+    pi->names[i] = s;
+  pi->names[n] = (char *)NULL;
+  pi->nnames = n;
+  qsort (pi->names, n, sizeof (char *), (QSFUNC *)pi_strcmp);
+
+  pi->dev = sb.st_dev;
+  pi->ino = sb.st_ino;
+  pi->mtime = sb.st_mtime;
+  pi->stamp = NOW;
+  pi->flags |= PI_VALID;
+  return 1;
+}
+
+/* Return the index of the first name in PI that is not less than the
+   first LEN characters of S. */
+static int
+pi_lower (pi, s, len)
+     PATH_INDEX *pi;
+     const char *s;
+     int len;
+{
+  int lo, hi, mid;
+
+  lo = 0;
+  hi = pi->nnames;
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (strncmp (pi->names[mid], s, len) < 0)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+/* Get ready to use the indexes.  Returns 1 if path_index_lookup () may
+   be used. */
+int
+path_index_sync ()
+{
+  pi_notified = path_index_enabled && pi_watching ();
+  return (pi_notified);
+}
+
+/* Return 1 if directory DIR contains NAME, 0 if it does not, and -1 if
+   there is no up-to-date index of DIR and it must be searched. */
+int
+path_index_lookup (dir, name)
+     const char *dir, *name;
+{
+  PATH_INDEX *pi;
+  int i;
+
+  if (path_index_enabled == 0 || *dir != '/' || pi_notified == 0)
+    return -1;
+
+  pi = pi_find (dir);
+  if (pi->flags & PI_NOINDEX)
+    return -1;
+
+  if ((pi->flags & PI_VALID) == 0 &&
+      (++pi->lookups < PATH_INDEX_LOOKUPS || pi_build (pi) <= 0))
+    return -1;
+  /* Without notifications the index would have to be checked each time. */
+  if (pi->wd < 0)
+    return -1;
+
+  i = pi_lower (pi, name, strlen (name) + 1);
+  return (i < pi->nnames && STREQ (pi->names[i], name));
+}
+
+/* Return a NULL-terminated list of the names in directory DIR that begin
+   with PREFIX, ignoring case if IGNCASE is non-zero, or NULL if DIR cannot
+   be indexed.  The caller frees the list and its members. */
+char **
+path_index_matches (dir, prefix, igncase)
+     const char *dir, *prefix;
+     int igncase;
+{
+  PATH_INDEX *pi;
+  char **ret;
+  int i, n, first, len;
+
+  if (path_index_enabled == 0 || *dir != '/')
+    return ((char **)NULL);
+
+  pi = pi_find (dir);
+  if (pi->flags & PI_NOINDEX)
+    return ((char **)NULL);
+  if (pi_current (pi) == 0 && pi_build (pi) < 0)
+    return ((char **)NULL);
+
+  len = strlen (prefix);
+  if (igncase)
+    {
+      for (i = n = 0; i < pi->nnames; i++)
+	if (strncasecmp (pi->names[i], prefix, len) == 0)
+	  n++;
+      ret = strvec_create (n + 1);
+      for (i = n = 0; i < pi->nnames; i++)
+	if (strncasecmp (pi->names[i], prefix, len) == 0)
+	  ret[n++] = savestring (pi->names[i]);
+    }
+  else
+    {
+      first = pi_lower (pi, prefix, len);
+      for (i = first; i < pi->nnames && strncmp (pi->names[i], prefix, len) == 0; i++)
+	;
+      ret = strvec_create (i - first + 1);
+      for (i = first, n = 0; i < pi->nnames && strncmp (pi->names[i], prefix, len) == 0; i++)
+	ret[n++] = savestring (pi->names[i]);
+    }
+  ret[n] = (char *)NULL;
+  return (ret);
+}
+
+/* Forget every index.  `hash -r' calls this. */
+void
+path_index_flush ()
+{
+  BUCKET_CONTENTS *item, *next;
+  PATH_INDEX *pi;
+  int i;
+
+  if (path_indexes)
+    {
+      for (i = 0; i < path_indexes->nbuckets; i++)
+	for (item = hash_items (i, path_indexes); item; item = next)
+	  {
+	    next = item->next;
+	    pi = (PATH_INDEX *)item->data;
+	    pi_clear (pi);
+	    free (pi->dir);		/* also the key */
+	    free (pi);
+	    free (item);
+	  }
+      hash_dispose (path_indexes);
+      path_indexes = (HASH_TABLE *)NULL;
+    }
+
+#if defined (PATH_INDEX_INOTIFY)
+  /* Closing the descriptor removes all the watches.  A subshell leaves the
+     descriptor it shares with its parent alone. */
+  if (inotify_fd >= 0 && pi_watching ())
+    close (inotify_fd);
+  inotify_fd = -1;
+  inotify_failed = 0;
+#endif
+  pi_notified = 0;
+}
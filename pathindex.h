@@ -0,0 +1,34 @@
+/* pathindex.h -- Functions appearing in pathindex.c. */
+
+/* Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This file is part of GNU Bash, the Bourne Again SHell.
+
+   Bash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Bash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Bash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined (_PATHINDEX_H_)
+#define _PATHINDEX_H_
+
+#include "stdc.h"
+
+/* Non-zero if directories in $PATH may be indexed (shopt pathindex). */
+extern int path_index_enabled;
+
+extern int path_index_sync __P((void));
+extern int path_index_lookup __P((const char *, const char *));
+extern char **path_index_matches __P((const char *, const char *, int));
+extern void path_index_flush __P((void));
+
+#endif /* _PATHINDEX_H_ */
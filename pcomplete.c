@@ -75,6 +75,30 @@
 
 typedef SHELL_VAR **SVFUNC ();
 
+/* Matches generated by the shell function and command of a compspec with
+   the `cache' option, saved so that completing the same words again, or
+   a longer version of the same word, does not run them again. */
+#define PCOMP_CACHE_SIZE	32
+
+/* How long cached matches last, in seconds, if COMP_CACHE_TTL is unset. */
+#define PCOMP_CACHE_TTL		30
+
+typedef struct pcomp_cache_entry {
+  char *funcname;		/* the compspec's -F function */
+  char *command;		/* the compspec's -C command */
+  char *cmd;			/* the command being completed */
+  char *text;			/* the word being completed */
+  char **words;			/* COMP_WORDS */
+  int nwords;
+  int cword;			/* COMP_CWORD */
+  char *generation;		/* COMP_CACHE_GENERATION when saved */
+  time_t stamp;			/* when saved */
+  int found;
+  int opts_on, opts_off;	/* options changed by compopt while generating */
+  int prefixed;			/* all matches begin with TEXT */
+  STRINGLIST *matches;
+} PCOMP_CACHE_ENTRY;
+
 #ifndef HAVE_STRPBRK
 extern char *strpbrk __P((char *, char *));
 #endif
@@ -124,6 +148,15 @@ static STRINGLIST *gen_shell_function_matches __P((COMPSPEC *, const char *,
 static STRINGLIST *gen_command_matches __P((COMPSPEC *, const char *, char *,
 					    int, WORD_LIST *, int, int));
 
+static void pcomp_cache_clear __P((PCOMP_CACHE_ENTRY *));
+static intmax_t pcomp_cache_ttl __P((void));
+static int pcomp_cache_compare __P((PCOMP_CACHE_ENTRY *, COMPSPEC *, const char *,
+				    const char *, WORD_LIST *, int));
+static int pcomp_cache_lookup __P((COMPSPEC *, const char *, const char *,
+				   WORD_LIST *, int, STRINGLIST **, int *));
+static void pcomp_cache_save __P((COMPSPEC *, const char *, const char *,
+				  WORD_LIST *, int, STRINGLIST *, int, int));
+
 static STRINGLIST *gen_progcomp_completions __P((const char *, const char *,
 						 const char *,
 						 int, int, int *, int *,
@@ -173,6 +206,9 @@ ITEMLIST it_variables = { LIST_DYNAMIC, it_init_variables, (STRINGLIST *)0 };
 COMPSPEC *pcomp_curcs;
 const char *pcomp_curcmd;
 
+static PCOMP_CACHE_ENTRY pcomp_cache[PCOMP_CACHE_SIZE];
+static int pcomp_cache_next;	/* next slot to replace */
+
 #ifdef DEBUG
 /* Debugging code */
 static void
@@ -1203,6 +1239,213 @@ command_line_to_word_list (line, llen, sentinel, nwp, cwp)
   return (ret);
 }
 
+/* Functions to manage the completion cache. */
+
+#define PCOMP_STREQ(a, b)	((a) == (b) || ((a) && (b) && STREQ ((a), (b))))
+
+static void
+pcomp_cache_clear (e)
+     PCOMP_CACHE_ENTRY *e;
+{
+  FREE (e->funcname);
+  FREE (e->command);
+  FREE (e->cmd);
+  FREE (e->text);
+  if (e->words)
+    strvec_dispose (e->words);
+  FREE (e->generation);
+  strlist_dispose (e->matches);
+  bzero ((char *)e, sizeof (PCOMP_CACHE_ENTRY));
+}
+
+/* Discard everything in the completion cache.  Called whenever a compspec
+   is defined or removed. */
+void
+pcomp_cache_flush ()
+{
+  register int i;
+
+  for (i = 0; i < PCOMP_CACHE_SIZE; i++)
+    if (pcomp_cache[i].text)
+      pcomp_cache_clear (pcomp_cache + i);
+  pcomp_cache_next = 0;
+}
+
+/* Return the number of seconds cached matches last. */
+static intmax_t
+pcomp_cache_ttl ()
+{
+  char *v;
+  intmax_t n;
+
+  v = get_string_value ("COMP_CACHE_TTL");
+  if (v == 0 || legal_number (v, &n) == 0 || n < 0)
+    return (PCOMP_CACHE_TTL);
+  return (n);
+}
+
+/* Return 2 if cache entry E holds the matches CS generates for TEXT, an
+   argument to CMD, given the words in LWORDS; 1 if E holds the matches for
+   a prefix of TEXT and all of them begin with that prefix, so the matches
+   for TEXT may be selected from them; and 0 otherwise. */
+static int
+pcomp_cache_compare (e, cs, cmd, text, lwords, cw)
+     PCOMP_CACHE_ENTRY *e;
+     COMPSPEC *cs;
+     const char *cmd, *text;
+     WORD_LIST *lwords;
+     int cw;
+{
+  WORD_LIST *l;
+  int i, ndiff;
+
+  if (e->cword != cw || PCOMP_STREQ (e->cmd, cmd) == 0 ||
+      PCOMP_STREQ (e->funcname, cs->funcname) == 0 ||
+      PCOMP_STREQ (e->command, cs->command) == 0)
+    return 0;
+
+  /* Only the word being completed may differ, and only by growing. */
+  for (i = ndiff = 0, l = lwords; l && i < e->nwords; l = l->next, i++)
+    if (STREQ (e->words[i], l->word->word) == 0 &&
+	(ndiff++ || STREQN (e->words[i], l->word->word, strlen (e->words[i])) == 0))
+      return 0;
+  if (l || i < e->nwords)
+    return 0;
+
+  if (STREQ (e->text, text))
+    return (ndiff ? 0 : 2);
+  return ((e->prefixed && STREQN (e->text, text, strlen (e->text))) ? 1 : 0);
+}
+
+/* Look in the cache for the matches CS's function and command generate
+   for TEXT.  If there are any, return 1 with a copy of them in *SLP and the
+   saved value of FOUND in *FOUNDP, after making the changes to CS's options
+   that the function made with compopt.  Expired entries and entries saved
+   before COMP_CACHE_GENERATION last changed are discarded as we go. */
+static int
+pcomp_cache_lookup (cs, cmd, text, lwords, cw, slp, foundp)
+     COMPSPEC *cs;
+     const char *cmd, *text;
+     WORD_LIST *lwords;
+     int cw;
+     STRINGLIST **slp;
+     int *foundp;
+{
+  PCOMP_CACHE_ENTRY *e, *best;
+  STRINGLIST *sl;
+  char *gen;
+  intmax_t ttl;
+  time_t now;
+  int i, n, r, m, tlen;
+
+  ttl = pcomp_cache_ttl ();
+  gen = get_string_value ("COMP_CACHE_GENERATION");
+  now = NOW;
+
+  best = (PCOMP_CACHE_ENTRY *)NULL;
+  for (i = m = 0; i < PCOMP_CACHE_SIZE && m < 2; i++)
+    {
+      e = pcomp_cache + i;
+      if (e->text == 0)
+	continue;
+      if (now < e->stamp || now - e->stamp >= ttl || PCOMP_STREQ (e->generation, gen) == 0)
+	{
+	  pcomp_cache_clear (e);
+	  continue;
+	}
+      r = pcomp_cache_compare (e, cs, cmd, text, lwords, cw);
+      /* Prefer the longest prefix, which leaves the fewest matches to check. */
+      if (r > m || (r && r == m && strlen (e->text) > strlen (best->text)))
+	{
+	  best = e;
+	  m = r;
+	}
+    }
+
+  if (best == 0)
+    return 0;
+
+  if (m == 2 || best->matches == 0)
+    sl = best->matches ? strlist_copy (best->matches) : (STRINGLIST *)NULL;
+  else
+    {
+      tlen = strlen (text);
+      sl = strlist_create (best->matches->list_len + 1);
+      for (i = n = 0; i < best->matches->list_len; i++)
+	if (STREQN (best->matches->list[i], text, tlen))
+	  sl->list[n++] = savestring (best->matches->list[i]);
+      sl->list[n] = (char *)NULL;
+      sl->list_len = n;
+    }
+
+  *slp = sl;
+  *foundp = best->found;
+
+  if (best->opts_on)
+    {
+      pcomp_set_compspec_options (cs, best->opts_on, 1);
+      pcomp_set_readline_variables (best->opts_on, 1);
+    }
+  if (best->opts_off)
+    {
+      pcomp_set_compspec_options (cs, best->opts_off, 0);
+      pcomp_set_readline_variables (best->opts_off, 0);
+    }
+
+  return 1;
+}
+
+/* Save SL, the matches CS's function and command generated for TEXT, in
+   the cache, replacing the oldest entry.  OLDOPTS is CS's options before
+   the function ran. */
+static void
+pcomp_cache_save (cs, cmd, text, lwords, cw, sl, found, oldopts)
+     COMPSPEC *cs;
+     const char *cmd, *text;
+     WORD_LIST *lwords;
+     int cw;
+     STRINGLIST *sl;
+     int found, oldopts;
+{
+  PCOMP_CACHE_ENTRY *e;
+  WORD_LIST *l;
+  int i, tlen;
+
+  if (found == 0 || (found & PCOMP_RETRYFAIL) || pcomp_cache_ttl () <= 0)
+    return;
+
+  e = pcomp_cache + pcomp_cache_next;
+  pcomp_cache_next = (pcomp_cache_next + 1) % PCOMP_CACHE_SIZE;
+  if (e->text)
+    pcomp_cache_clear (e);
+
+  e->funcname = STRDUP (cs->funcname);
+  e->command = STRDUP (cs->command);
+  e->cmd = STRDUP (cmd);
+  e->text = savestring (text);
+  e->nwords = list_length (lwords);
+  e->words = strvec_create (e->nwords + 1);
+  for (i = 0, l = lwords; l; l = l->next)
+    e->words[i++] = savestring (l->word->word);
+  e->words[i] = (char *)NULL;
+  e->cword = cw;
+  e->generation = STRDUP (get_string_value ("COMP_CACHE_GENERATION"));
+  e->stamp = NOW;
+  e->found = found;
+  e->opts_on = cs->options & ~oldopts;
+  e->opts_off = oldopts & ~cs->options;
+  e->matches = sl ? strlist_copy (sl) : (STRINGLIST *)NULL;
+
+  tlen = strlen (text);
+  e->prefixed = 1;
+  for (i = 0; sl && i < sl->list_len; i++)
+    if (STREQN (sl->list[i], text, tlen) == 0)
+      {
+	e->prefixed = 0;
+	break;
+      }
+}
+
 /* Evaluate COMPSPEC *cs and return all matches for WORD. */
 
 STRINGLIST *
@@ -1213,9 +1456,9 @@ gen_compspec_completions (cs, cmd, word, start, end, foundp)
      int start, end;
      int *foundp;
 {
-  STRINGLIST *ret, *tmatches;
+  STRINGLIST *ret, *tmatches, *gmatches;
   char *line;
-  int llen, nw, cw, found, foundf;
+  int llen, nw, cw, found, foundf, cached, oldopts;
   WORD_LIST *lwords;
   COMPSPEC *tcs;
 
@@ -1303,7 +1546,19 @@ gen_compspec_completions (cs, cmd, word, start, end, foundp)
 #endif
     }
 
-  if (cs->funcname)
+  /* Matches from the function and command may come from the cache. */
+  gmatches = (STRINGLIST *)NULL;
+  cached = 0;
+  if ((cs->command || cs->funcname) && (cs->options & COPT_CACHE))
+    {
+      cached = pcomp_cache_lookup (cs, cmd, word, lwords, cw, &gmatches, &foundf);
+      if (cached)
+	found = foundf;
+    }
+  oldopts = cs->options;
+  foundf = 1;
+
+  if (cs->funcname && cached == 0)
     {
       foundf = 0;
       tmatches = gen_shell_function_matches (cs, word, line, rl_point - start, lwords, nw, cw, &foundf);
@@ -1319,12 +1574,12 @@ gen_compspec_completions (cs, cmd, word, start, end, foundp)
 	      rl_on_new_line ();
 	    }
 #endif
-	  ret = strlist_append (ret, tmatches);
+	  gmatches = strlist_append (gmatches, tmatches);
 	  strlist_dispose (tmatches);
 	}
     }
 
-  if (cs->command)
+  if (cs->command && cached == 0)
     {
       tmatches = gen_command_matches (cs, word, line, rl_point - start, lwords, nw, cw);
       if (tmatches)
@@ -1337,13 +1592,22 @@ gen_compspec_completions (cs, cmd, word, start, end, foundp)
 	      rl_on_new_line ();
 	    }
 #endif
-	  ret = strlist_append (ret, tmatches);
+	  gmatches = strlist_append (gmatches, tmatches);
 	  strlist_dispose (tmatches);
 	}
     }
 
   if (cs->command || cs->funcname)
     {
+      /* A function that was not found is not cached, so that defining it
+	 takes effect at once. */
+      if (cached == 0 && (oldopts & COPT_CACHE) && foundf)
+	pcomp_cache_save (cs, cmd, word, lwords, cw, gmatches, found, oldopts);
+      if (gmatches)
+	{
+	  ret = strlist_append (ret, gmatches);
+	  strlist_dispose (gmatches);
+	}
       if (lwords)
 	dispose_words (lwords);
       FREE (line);
@@ -73,6 +73,7 @@ typedef struct compspec {
 #define COPT_NOSPACE	(1<<4)
 #define COPT_BASHDEFAULT (1<<5)
 #define COPT_PLUSDIRS	(1<<6)
+#define COPT_CACHE	(1<<7)
 
 /* List of items is used by the code that implements the programmable
    completions. */
@@ -158,4 +159,6 @@ extern char **programmable_completions __P((const char *, const char *, int, int
 
 extern void pcomp_set_readline_variables __P((int, int));
 extern void pcomp_set_compspec_options __P((COMPSPEC *, int, int));
+
+extern void pcomp_cache_flush __P((void));
 #endif /* _PCOMPLETE_H_ */
@@ -137,6 +137,7 @@ progcomp_flush ()
 {
   if (prog_completes)
     hash_flush (prog_completes, free_progcomp);
+  pcomp_cache_flush ();
 }
 
 void
@@ -145,6 +146,7 @@ progcomp_dispose ()
   if (prog_completes)
     hash_dispose (prog_completes);
   prog_completes = (HASH_TABLE *)NULL;
+  pcomp_cache_flush ();
 }
 
 int
@@ -156,6 +158,7 @@ progcomp_remove (cmd)
   if (prog_completes == 0)
     return 1;
 
+  pcomp_cache_flush ();
   item = hash_remove (cmd, prog_completes, 0);
   if (item)
     {
@@ -182,6 +185,7 @@ progcomp_insert (cmd, cs)
     progcomp_create ();
 
   cs->refcount++;
+  pcomp_cache_flush ();
   item = hash_insert (cmd, prog_completes, 0);
   if (item->data)
     free_progcomp (item->data);
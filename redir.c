@@ -1104,6 +1104,10 @@ add_undo_redirect (fd, ri, fdbase)
 
   clexec_flag = fcntl (fd, F_GETFD, 0);
 
+#if defined (BUFFERED_INPUT)
+  save_read_stream (fd, new_fd);
+#endif
+
   sd.dest = new_fd;
   rd.dest = 0;
   closer = make_redirection (sd, r_close_this, rd, 0);
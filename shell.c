@@ -62,6 +62,7 @@
 #include "input.h"
 #include "execute_cmd.h"
 #include "findcmd.h"
+#include "startuptime.h"
 
 #if defined (USING_BASH_MALLOC) && defined (DEBUG) && !defined (DISABLE_MALLOC_WRAPPERS)
 #  include <malloc/shmalloc.h>
@@ -380,6 +381,8 @@ main (argc, argv, env)
 
   xtrace_init ();
 
+  startup_timing_init ();
+
 #if defined (USING_BASH_MALLOC) && defined (DEBUG) && !defined (DISABLE_MALLOC_WRAPPERS)
 #  if 1
   malloc_set_register (1);
@@ -449,6 +452,7 @@ main (argc, argv, env)
   shell_start_time = NOW;	/* NOW now defined in general.h */
 
   /* Parse argument flags from the input line. */
+  STARTUP_PHASE_BEGIN ("parse_options");
 
   /* Find full word arguments first. */
   arg_index = parse_long_options (argv, arg_index, argc);
@@ -502,8 +506,9 @@ main (argc, argv, env)
       arg_index++;
     }
   this_command_name = (char *)NULL;
+  STARTUP_END ();
 
-  cmd_init();		/* initialize the command object caches */
+  cmd_init();		/* initialize the command object pools */
 
   /* First, let the outside world know about our interactive status.
      A shell is interactive if the `-i' flag was given, or if all of
@@ -555,10 +560,14 @@ main (argc, argv, env)
 
   /* From here on in, the shell must be a normal functioning shell.
      Variables from the environment are expected to be set, etc. */
+  STARTUP_PHASE_BEGIN ("shell_initialize");
   shell_initialize ();
+  STARTUP_END ();
 
+  STARTUP_PHASE_BEGIN ("locale");
   set_default_lang ();
   set_default_locale_vars ();
+  STARTUP_END ();
 
   /*
    * M-x term -> TERM=eterm EMACS=22.1 (term:0.96)	(eterm)
@@ -646,7 +655,9 @@ main (argc, argv, env)
       old_errexit_flag = exit_immediately_on_error;
       exit_immediately_on_error = 0;
 
+      STARTUP_PHASE_BEGIN ("run_startup_files");
       run_startup_files ();
+      STARTUP_END ();
       exit_immediately_on_error += old_errexit_flag;
     }
 
@@ -683,6 +694,8 @@ main (argc, argv, env)
       if (debugging_mode)
 	start_debugger ();
 
+      startup_timing_report ();
+
 #if defined (ONESHOT)
       executing = 1;
       run_one_command (command_execution_string);
@@ -726,19 +739,23 @@ main (argc, argv, env)
 
 #if defined (HISTORY)
       /* Initialize the interactive history stuff. */
+      STARTUP_PHASE_BEGIN ("history");
       bash_initialize_history ();
       /* Don't load the history from the history file if we've already
 	 saved some lines in this session (e.g., by putting `history -s xx'
 	 into one of the startup files). */
       if (shell_initialized == 0 && history_lines_this_session == 0)
 	load_history ();
+      STARTUP_END ();
 #endif /* HISTORY */
 
       /* Initialize terminal state for interactive shells after the
 	 .bash_profile and .bashrc are interpreted. */
       get_tty_state ();
 
+      STARTUP_PHASE_BEGIN ("initialize_logging");
       initialize_logging();
+      STARTUP_END ();
     }
 
 #if !defined (ONESHOT)
@@ -747,6 +764,13 @@ main (argc, argv, env)
 
   shell_initialized = 1;
 
+  /* Readline is initialized when the first prompt is read, so interactive
+     shells that edit lines write the startup timing report then. */
+#if defined (READLINE)
+  if (interactive == 0 || no_line_editing)
+#endif
+    startup_timing_report ();
+
   /* Read commands until exit condition. */
   reader_loop ();
   exit_shell (last_command_exit_value);
@@ -923,6 +947,11 @@ exit_shell (s)
   coproc_flush ();
 #endif
 
+  flush_command_log (1);
+
+  /* In case the shell exits from a startup file. */
+  startup_timing_report ();
+
 #if defined (JOB_CONTROL)
   /* If the user has run `shopt -s huponexit', hangup all jobs when we exit
      an interactive login shell.  ksh does this unconditionally. */
@@ -1706,14 +1735,18 @@ shell_initialize ()
   /* Initialize internal and environment variables.  Don't import shell
      functions from the environment if we are running in privileged or
      restricted mode or if the shell is running setuid. */
+  STARTUP_PHASE_BEGIN ("initialize_shell_variables");
 #if defined (RESTRICTED_SHELL)
   initialize_shell_variables (shell_environment, privileged_mode||restricted||running_setuid);
 #else
   initialize_shell_variables (shell_environment, privileged_mode||running_setuid);
 #endif
+  STARTUP_END ();
 
   /* Initialize the data structures for storing and running jobs. */
+  STARTUP_PHASE_BEGIN ("initialize_job_control");
   initialize_job_control (0);
+  STARTUP_END ();
 
   /* Initialize input streams to null. */
   initialize_bash_input ();
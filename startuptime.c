@@ -0,0 +1,240 @@
+/* startuptime.c -- time the phases of shell startup. */
+
+/* Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This file is part of GNU Bash, the Bourne Again SHell.
+
+   Bash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Bash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Bash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* When BASH_STARTUP_TIMING names a file in the shell's environment, main ()
+   and the functions it calls mark the start and end of each startup phase
+   and of each file sourced while the shell starts.  The marks are kept in
+   memory and appended to the file as a single write when the shell is
+   ready for its first command, so the report costs nothing until then and
+   reports from concurrent shells do not interleave.
+
+   Each line of the report has six tab-separated fields:
+
+	pid  kind  depth  start  elapsed  name
+
+   KIND is `shell', `phase', or `file'.  START and ELAPSED are in
+   microseconds; START is measured from when timing started.  DEPTH
+   counts the enclosing phases and files.  The first line, of kind `shell',
+   gives the monotonic clock reading when the shell started as its START,
+   the time until it was ready for the first command as its ELAPSED, and
+   the shell name, version, and type as its NAME. */
+
+#include "config.h"
+
+#include "bashtypes.h"
+#include "posixtime.h"
+#include "filecntl.h"
+
+#if defined (HAVE_UNISTD_H)
+#  include <unistd.h>
+#endif
+
+#include <stdio.h>
+
+#include "bashansi.h"
+
+#include "shell.h"
+#include "flags.h"
+#include "startuptime.h"
+
+/* The environment variable naming the report file. */
+#define STARTUP_TIMING_VAR	"BASH_STARTUP_TIMING"
+
+/* Marks nested deeper than this are recorded but never closed. */
+#define STARTUP_MAXDEPTH	32
+
+typedef struct startup_mark {
+  const char *kind;		/* "phase" or "file" */
+  char *name;
+  int depth;
+  intmax_t start;		/* microseconds since timing started */
+  intmax_t elapsed;		/* -1 until the phase ends */
+} STARTUP_MARK;
+
+extern int login_shell, interactive_shell;
+extern char *shell_name;
+
+int startup_timing = 0;
+
+static char *timing_file;
+static pid_t timing_pid;	/* children forked during startup don't report */
+static intmax_t timing_base;	/* monotonic clock when timing started */
+
+static STARTUP_MARK *marks;
+static int nmarks, marks_size;
+
+static int open_marks[STARTUP_MAXDEPTH];
+static int mark_depth;
+
+static intmax_t monotonic_usec __P((void));
+static char *format_mark __P((char *, const char *, int, intmax_t, intmax_t, const char *));
+
+/* Return a reading of the monotonic clock in microseconds, or of the
+   system clock if there is no monotonic clock. */
+static intmax_t
+monotonic_usec ()
+{
+#if defined (CLOCK_MONOTONIC)
+  struct timespec ts;
+#endif
+  struct timeval tv;
+
+#if defined (CLOCK_MONOTONIC)
+  if (clock_gettime (CLOCK_MONOTONIC, &ts) == 0)
+    return ((intmax_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+#endif
+  gettimeofday (&tv, (struct timezone *)NULL);
+  return ((intmax_t)tv.tv_sec * 1000000 + tv.tv_usec);
+}
+
+/* Start timing if the environment asks for it.  Called at the top of
+   main (), before anything worth timing. */
+void
+startup_timing_init ()
+{
+  char *s;
+
+  s = getenv (STARTUP_TIMING_VAR);
+  if (s == 0 || *s == '\0')
+    return;
+
+  timing_file = savestring (s);
+  timing_pid = getpid ();
+  timing_base = monotonic_usec ();
+  startup_timing = 1;
+}
+
+/* Mark the start of the startup phase or sourced file NAME. */
+void
+startup_timing_begin (kind, name)
+     const char *kind, *name;
+{
+  STARTUP_MARK *m;
+
+  if (nmarks == marks_size)
+    {
+      marks_size += 16;
+      marks = (STARTUP_MARK *)xrealloc (marks, marks_size * sizeof (STARTUP_MARK));
+    }
+
+  m = marks + nmarks;
+  m->kind = kind;
+  m->name = savestring (name ? name : "");
+  m->depth = mark_depth;
+  m->start = monotonic_usec () - timing_base;
+  m->elapsed = -1;
+
+  if (mark_depth < STARTUP_MAXDEPTH)
+    open_marks[mark_depth] = nmarks;
+  mark_depth++;
+  nmarks++;
+}
+
+/* Mark the end of the innermost phase or file that has not ended. */
+void
+startup_timing_end ()
+{
+  STARTUP_MARK *m;
+
+  if (mark_depth == 0)
+    return;
+
+  mark_depth--;
+  if (mark_depth < STARTUP_MAXDEPTH)
+    {
+      m = marks + open_marks[mark_depth];
+      m->elapsed = monotonic_usec () - timing_base - m->start;
+    }
+}
+
+/* Append one line of the report to S and return the new end of S. */
+static char *
+format_mark (s, kind, depth, start, elapsed, name)
+     char *s;
+     const char *kind, *name;
+     int depth;
+     intmax_t start, elapsed;
+{
+  char nbuf[INT_STRLEN_BOUND (intmax_t) + 1];
+
+  s += sprintf (s, "%ld\t%s\t%d\t", (long)timing_pid, kind, depth);
+  s += sprintf (s, "%s\t", inttostr (start, nbuf, sizeof (nbuf)));
+  s += sprintf (s, "%s\t%s\n", inttostr (elapsed, nbuf, sizeof (nbuf)), name);
+  return s;
+}
+
+/* Stop timing and append the report to the file named by
+   BASH_STARTUP_TIMING.  Phases that have not ended are reported as
+   lasting until now.  Called when the shell is ready to read its first
+   command, and on exit in case that never happens.  Nothing is written
+   by shells still running setuid or in privileged or restricted mode, or by
+   subshells forked while the shell was starting. */
+void
+startup_timing_report ()
+{
+  char *report, *s, *desc;
+  size_t len;
+  intmax_t now;
+  int i, fd;
+
+  if (startup_timing == 0)
+    return;
+  startup_timing = 0;
+
+  now = monotonic_usec () - timing_base;
+
+  if (current_user.uid != current_user.euid || current_user.gid != current_user.egid ||
+      privileged_mode || restricted || getpid () != timing_pid)
+    goto done;
+
+  desc = (char *)xmalloc (strlen (shell_name ? shell_name : "") + strlen (shell_version_string ()) + 32);
+  sprintf (desc, "%s %s%s%s", shell_name ? shell_name : "", shell_version_string (),
+	   login_shell ? " login" : "", interactive_shell ? " interactive" : "");
+
+  len = strlen (desc) + 128;
+  for (i = 0; i < nmarks; i++)
+    len += strlen (marks[i].name) + 128;
+  report = (char *)xmalloc (len);
+
+  s = format_mark (report, "shell", 0, timing_base, now, desc);
+  for (i = 0; i < nmarks; i++)
+    s = format_mark (s, marks[i].kind, marks[i].depth + 1, marks[i].start,
+		     (marks[i].elapsed >= 0) ? marks[i].elapsed : now - marks[i].start,
+		     marks[i].name);
+
+  fd = open (timing_file, O_WRONLY|O_APPEND|O_CREAT, 0600);
+  if (fd >= 0)
+    {
+      write (fd, report, s - report);
+      close (fd);
+    }
+
+  free (report);
+  free (desc);
+
+done:
+  for (i = 0; i < nmarks; i++)
+    free (marks[i].name);
+  FREE (marks);
+  marks = (STARTUP_MARK *)NULL;
+  nmarks = marks_size = mark_depth = 0;
+  FREE (timing_file);
+  timing_file = (char *)NULL;
+}
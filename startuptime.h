@@ -0,0 +1,42 @@
+/* startuptime.h -- Functions appearing in startuptime.c. */
+
+/* Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This file is part of GNU Bash, the Bourne Again SHell.
+
+   Bash is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Bash is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Bash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if !defined (_STARTUPTIME_H_)
+#define _STARTUPTIME_H_
+
+#include "stdc.h"
+
+/* Non-zero while the startup phases are being timed. */
+extern int startup_timing;
+
+extern void startup_timing_init __P((void));
+extern void startup_timing_begin __P((const char *, const char *));
+extern void startup_timing_end __P((void));
+extern void startup_timing_report __P((void));
+
+/* Time a startup phase or a sourced file.  Cheap when timing is off. */
+#define STARTUP_PHASE_BEGIN(name) \
+  do { if (startup_timing) startup_timing_begin ("phase", (name)); } while (0)
+#define STARTUP_FILE_BEGIN(name) \
+  do { if (startup_timing) startup_timing_begin ("file", (name)); } while (0)
+#define STARTUP_END() \
+  do { if (startup_timing) startup_timing_end (); } while (0)
+
+#endif /* _STARTUPTIME_H_ */
@@ -37,6 +37,10 @@
 #  include <unistd.h>
 #endif
 
+#if defined (HAVE_MEMFD_CREATE)
+#  include <sys/mman.h>
+#endif
+
 #include "bashansi.h"
 #include "posixstat.h"
 #include "bashintl.h"
@@ -145,6 +149,19 @@ unsigned char ifs_firstc;
    we use the temporary environment when looking up variable values. */
 int assigning_in_environment;
 
+/* Statistics about reading command substitution output and about command
+   substitutions run without forking, reported as the comsub_* elements of
+   $BASH_STATS. */
+unsigned long comsub_nreads = 0;
+unsigned long comsub_nreallocs = 0;
+unsigned long comsub_nbytes = 0;
+unsigned long comsub_nnoforks = 0;
+
+/* If non-zero, command substitutions that only run builtins and shell
+   functions which can't change the shell's state run in this shell
+   instead of a child.  Set by `shopt nofork_comsub'. */
+int nofork_comsub = 1;
+
 /* Used to hold a list of variable assignments preceding a command.  Global
    so the SIGCHLD handler in jobs.c can unwind-protect it when it runs a
    SIGCHLD trap and so it can be saved and restored by the trap handlers. */
@@ -163,6 +180,8 @@ extern struct fd_bitmap *current_fds_to_close;
 extern int wordexp_only;
 extern int expanding_redir;
 extern int tempenv_assign_error;
+extern int loop_level, executing_list, comsub_ignore_return;
+extern char *the_printed_command_except_trap;
 
 #if !defined (HAVE_WCSDUP) && defined (HANDLE_MULTIBYTE)
 extern wchar_t *wcsdup __P((const wchar_t *));
@@ -237,6 +256,9 @@ static int skip_matched_pair __P((const char *, int, int, int, int));
 static char *pos_params __P((char *, int, int, int));
 
 static unsigned char *mb_getcharlens __P((char *, int));
+#if defined (HANDLE_MULTIBYTE)
+static int ascii_string __P((const char *));
+#endif
 
 static char *remove_upattern __P((char *, char *, int));
 #if defined (HANDLE_MULTIBYTE) 
@@ -314,6 +336,27 @@ static int make_internal_declare __P((char *, char *));
 static WORD_LIST *shell_expand_word_list __P((WORD_LIST *, int));
 static WORD_LIST *expand_word_list_internal __P((WORD_LIST *, int));
 
+static int nofork_word_ok __P((WORD_DESC *));
+static int nofork_words_ok __P((WORD_LIST *));
+static int nofork_stdout_word __P((WORD_DESC *));
+static int nofork_local_p __P((STRINGLIST *, char *));
+static int nofork_value_ok __P((WORD_DESC *, char *));
+static int nofork_assignment_ok __P((WORD_DESC *, STRINGLIST *));
+static int nofork_local_ok __P((WORD_LIST *, STRINGLIST *, int));
+#if defined (PROGRAMMABLE_COMPLETION)
+static int nofork_compgen_ok __P((WORD_LIST *));
+#endif
+static int nofork_simple_ok __P((SIMPLE_COM *, int, STRINGLIST *, int));
+#if defined (COND_COMMAND)
+static int nofork_cond_ok __P((COND_COM *));
+#endif
+static int nofork_command_ok __P((COMMAND *, int, STRINGLIST *, int));
+static int nofork_function_ok __P((SHELL_VAR *, int));
+static int nofork_comsub_possible __P((void));
+static int comsub_buffer_fd __P((void));
+static void restore_comsub_stdout __P((int));
+static int command_substitute_nofork __P((char *, int, int, char **, int *));
+
 /* **************************************************************** */
 /*								    */
 /*			Utility Functions			    */
@@ -3705,6 +3748,21 @@ mb_getcharlens (string, len)
   return ret;
 }
 #endif
+
+/* Return 1 if STRING has only ASCII characters.  Such strings match the
+   same way as bytes and as wide characters, so there is no need to
+   translate them before matching. */
+static int
+ascii_string (string)
+     const char *string;
+{
+  register const unsigned char *s;
+
+  for (s = (const unsigned char *)string; *s; s++)
+    if (*s > 0177)
+      return 0;
+  return 1;
+}
 #endif
 
 /* Remove the portion of PARAM matched by PATTERN according to OP, where OP
@@ -3872,7 +3930,7 @@ remove_pattern (param, pattern, op)
     return (savestring (param));
 
 #if defined (HANDLE_MULTIBYTE)
-  if (MB_CUR_MAX > 1)
+  if (MB_CUR_MAX > 1 && (ascii_string (param) == 0 || ascii_string (pattern) == 0))
     {
       wchar_t *ret, *oret;
       size_t n;
@@ -4204,7 +4262,7 @@ match_pattern (string, pat, mtype, sp, ep)
     return (0);
 
 #if defined (HANDLE_MULTIBYTE)
-  if (MB_CUR_MAX > 1)
+  if (MB_CUR_MAX > 1 && (ascii_string (string) == 0 || ascii_string (pat) == 0))
     {
       n = xdupmbstowcs (&wpat, NULL, pat);
       if (n == (size_t)-1)
@@ -4906,17 +4964,27 @@ process_substitute (string, open_for_read_in_child)
 /*				   */
 /***********************************/
 
+/* read_comsub starts reading with a COMSUB_BUFMIN-byte buffer on the stack.
+   A command that fills the buffer probably has more output coming, so each
+   full read doubles the buffer, up to COMSUB_BUFMAX bytes. */
+#define COMSUB_BUFMIN	128
+#define COMSUB_BUFMAX	65536
+
 static char *
 read_comsub (fd, quoted, rflag)
      int fd, quoted;
      int *rflag;
 {
-  char *istring, buf[128], *bufp, *s;
+  char *istring, sbuf[COMSUB_BUFMIN], *buf, *bufp, *s;
   int istring_index, istring_size, c, tflag, skip_ctlesc, skip_ctlnul;
+  int grow;
+  size_t bufsize;
   ssize_t bufn;
 
   istring = (char *)NULL;
-  istring_index = istring_size = bufn = tflag = 0;
+  istring_index = istring_size = bufn = tflag = grow = 0;
+  buf = sbuf;
+  bufsize = sizeof (sbuf);
 
   for (skip_ctlesc = skip_ctlnul = 0, s = ifs_value; s && *s; s++)
     skip_ctlesc |= *s == CTLESC, skip_ctlnul |= *s == CTLNUL;
@@ -4933,10 +5001,35 @@ read_comsub (fd, quoted, rflag)
 	break;
       if (--bufn <= 0)
 	{
-	  bufn = zread (fd, buf, sizeof (buf));
+	  /* The last buffer has been consumed, so there's nothing to copy. */
+	  if (grow)
+	    {
+	      if (buf != sbuf)
+		free (buf);
+	      bufsize <<= 1;
+	      buf = (char *)xmalloc (bufsize);
+	    }
+	  bufn = zread (fd, buf, bufsize);
+	  comsub_nreads++;
 	  if (bufn <= 0) 
 	    break;
+	  comsub_nbytes += bufn;
+	  grow = bufn == bufsize && bufsize < COMSUB_BUFMAX;
 	  bufp = buf;
+
+	  /* Make room for everything we just read, in case every character
+	     needs to be quoted, and the trailing NUL.  Growing ISTRING
+	     geometrically keeps the copying linear in the size of the
+	     output. */
+	  if (istring_index + 2 * bufn + 1 > istring_size)
+	    {
+	      if (istring_size == 0)
+		istring_size = DEFAULT_ARRAY_SIZE;
+	      while (istring_index + 2 * bufn + 1 > istring_size)
+		istring_size <<= 1;
+	      istring = (char *)xrealloc (istring, istring_size);
+	      comsub_nreallocs++;
+	    }
 	}
       c = *bufp++;
 
@@ -4948,9 +5041,6 @@ read_comsub (fd, quoted, rflag)
 	  continue;
 	}
 
-      /* Add the character to ISTRING, possibly after resizing it. */
-      RESIZE_MALLOCED_BUFFER (istring, istring_index, 2, istring_size, DEFAULT_ARRAY_SIZE);
-
       /* This is essentially quote_string inline */
       if ((quoted & (Q_HERE_DOCUMENT|Q_DOUBLE_QUOTES)) /* || c == CTLESC || c == CTLNUL */)
 	istring[istring_index++] = CTLESC;
@@ -4978,6 +5068,9 @@ read_comsub (fd, quoted, rflag)
 #endif
     }
 
+  if (buf != sbuf)
+    free (buf);
+
   if (istring)
     istring[istring_index] = '\0';
 
@@ -5017,6 +5110,609 @@ read_comsub (fd, quoted, rflag)
   return istring;
 }
 
+/* Command substitutions that run only a few builtins, and shell functions
+   built from them, can run in this shell with their standard output going
+   to an in-memory file instead of running in a child.  The nofork_*
+   functions look at the parsed command to decide whether that gives the
+   same results as a subshell: nothing the command runs or expands may
+   change the shell's state, except for variables local to the shell
+   functions it calls, which go away when the functions return. */
+
+/* How deeply nofork_command_ok follows calls to shell functions. */
+#define NOFORK_MAXDEPTH	8
+
+/* Non-zero while a command substitution is running in this shell. */
+static int nofork_comsub_level;
+
+/* Return non-zero if expanding W can't change the shell's state or expand
+   differently in a child.  That rules out command, process, and arithmetic
+   substitution, ${name=word}, ${name?word}, indirect expansion, array
+   subscripts and substring offsets, which are arithmetic expressions, and
+   $RANDOM and $BASHPID. */
+static int
+nofork_word_ok (w)
+     WORD_DESC *w;
+{
+  char *s, *p;
+
+  s = w->word;
+  if (strchr (s, '`') || strstr (s, "$(") || strstr (s, "$[") ||
+      strstr (s, "<(") || strstr (s, ">(") ||
+      strstr (s, "RANDOM") || strstr (s, "BASHPID"))
+    return 0;
+
+  for (p = strstr (s, "${"); p; p = strstr (p, "${"))
+    {
+      p += 2;
+      if (*p == '!')
+	return 0;
+      if (*p == '#')
+	p++;
+      if (DIGIT (*p))
+	while (DIGIT (*p))
+	  p++;
+      else if (legal_variable_starter (*p))
+	while (legal_variable_char (*p))
+	  p++;
+      else if (*p && *p != '}')
+	p++;
+
+      if (*p == '[')
+	{
+	  if ((p[1] != '@' && p[1] != '*') || p[2] != ']')
+	    return 0;
+	  p += 3;
+	}
+
+      if ((*p == ':' && p[1] != '-' && p[1] != '+') || *p == '=' || *p == '?')
+	return 0;
+    }
+
+  return 1;
+}
+
+static int
+nofork_words_ok (list)
+     WORD_LIST *list;
+{
+  for ( ; list; list = list->next)
+    if (nofork_word_ok (list->word) == 0)
+      return 0;
+  return 1;
+}
+
+/* Return non-zero if W names the standard output, which test and [[ would
+   see as the in-memory file instead of the pipe to the parent. */
+static int
+nofork_stdout_word (w)
+     WORD_DESC *w;
+{
+  char *s;
+
+  s = w->word;
+  return (strstr (s, "/dev/stdout") || strstr (s, "/dev/fd/") ||
+	  strstr (s, "/proc/self/fd/"));
+}
+
+/* Return non-zero if NAME is one of the LOCALS. */
+static int
+nofork_local_p (locals, name)
+     STRINGLIST *locals;
+     char *name;
+{
+  int i;
+
+  for (i = 0; locals && i < locals->list_len; i++)
+    if (STREQ (locals->list[i], name))
+      return 1;
+  return 0;
+}
+
+/* Return non-zero if the assignment W, whose variable name ends at T,
+   assigns a value that is safe to expand.  Compound assignments with
+   subscripts are not. */
+static int
+nofork_value_ok (w, t)
+     WORD_DESC *w;
+     char *t;
+{
+  if (*t == '+')
+    t++;
+  if (*t != '=' || (t[1] == '(' && strchr (t, '[')))
+    return 0;
+  return (nofork_word_ok (w));
+}
+
+/* Return non-zero if the assignment statement W sets one of the LOCALS,
+   the variables already declared local to the shell function being
+   looked at, to a safe value. */
+static int
+nofork_assignment_ok (w, locals)
+     WORD_DESC *w;
+     STRINGLIST *locals;
+{
+  char *s, *t, *name;
+  int r;
+
+  s = w->word;
+  if (legal_variable_starter (*s) == 0)
+    return 0;
+  for (t = s + 1; legal_variable_char (*t); t++)
+    ;
+
+  name = substring (s, 0, t - s);
+  r = nofork_local_p (locals, name);
+  free (name);
+
+  return (r && nofork_value_ok (w, t));
+}
+
+/* Return non-zero if the arguments to `local' in LIST declare variables
+   with literal names and safe values, and without the integer attribute.
+   If TOP is non-zero, the declaration always runs before the rest of the
+   function body, so add the names to LOCALS. */
+static int
+nofork_local_ok (list, locals, top)
+     WORD_LIST *list;
+     STRINGLIST *locals;
+     int top;
+{
+  char *s, *t;
+
+  for ( ; list; list = list->next)
+    {
+      s = list->word->word;
+      if (*s == '-' || *s == '+')
+	{
+	  if (strpbrk (s, "i$`"))
+	    return 0;
+	  continue;
+	}
+
+      if (legal_variable_starter (*s) == 0)
+	return 0;
+      for (t = s + 1; legal_variable_char (*t); t++)
+	;
+      if (*t && nofork_value_ok (list->word, t) == 0)
+	return 0;
+
+      if (top)
+	{
+	  if (locals->list_len + 1 > locals->list_size)
+	    strlist_resize (locals, locals->list_size + 8);
+	  locals->list[locals->list_len++] = substring (s, 0, t - s);
+	  locals->list[locals->list_len] = (char *)NULL;
+	}
+    }
+
+  return 1;
+}
+
+#if defined (PROGRAMMABLE_COMPLETION)
+/* compgen is safe unless it calls a shell function or runs a command
+   (-F and -C), or has a -W word list that will be expanded again. */
+static int
+nofork_compgen_ok (list)
+     WORD_LIST *list;
+{
+  char *s, *arg;
+
+  for ( ; list; list = list->next)
+    {
+      s = list->word->word;
+      if (*s != '-' || s[1] == '\0' || STREQ (s, "--"))
+	break;
+      if (strpbrk (s, "$`"))
+	return 0;
+
+      for (s++; *s; s++)
+	{
+	  if (*s == 'F' || *s == 'C')
+	    return 0;
+	  if (strchr ("AGPSWXo", *s) == 0)
+	    continue;
+
+	  /* The rest of the word or the next word is the option argument. */
+	  if (s[1])
+	    arg = s + 1;
+	  else if (list->next)
+	    {
+	      list = list->next;
+	      arg = list->word->word;
+	    }
+	  else
+	    arg = (char *)NULL;
+	  if (*s == 'W' && arg && strpbrk (arg, "$`"))
+	    return 0;
+	  break;
+	}
+    }
+
+  return 1;
+}
+#endif
+
+/* Return non-zero if the simple command SIMPLE is safe to run without a
+   child.  DEPTH is the number of shell function calls SIMPLE is nested
+   in; LOCALS and TOP are as for nofork_local_ok. */
+static int
+nofork_simple_ok (simple, depth, locals, top)
+     SIMPLE_COM *simple;
+     int depth;
+     STRINGLIST *locals;
+     int top;
+{
+  WORD_LIST *w, *l;
+  SHELL_VAR *f;
+  sh_builtin_func_t *b;
+  char *name;
+
+  if (simple->redirects)
+    return 0;
+
+  /* Assignment statements may only set local variables, and assignments
+     preceding a command name are not allowed at all. */
+  for (w = simple->words; w && (w->word->flags & W_ASSIGNMENT); w = w->next)
+    if (nofork_assignment_ok (w->word, locals) == 0)
+      return 0;
+  if (w == 0)
+    return 1;
+  else if (w != simple->words)
+    return 0;
+
+  name = w->word->word;
+  if (*name == '\0' || strpbrk (name, "$`\\'\"/"))
+    return 0;
+
+  /* Look the name up the same way execute_simple_command does, without
+     loading a function that hasn't been read yet; it might not be safe. */
+  b = posixly_correct ? find_special_builtin (name) : (sh_builtin_func_t *)NULL;
+  if (b == 0 && (f = find_function_noload (name)))
+    return (autoload_p (f) == 0 && depth < NOFORK_MAXDEPTH &&
+	    nofork_words_ok (w->next) &&
+	    nofork_function_ok (f, depth + 1));
+  if (b == 0 && (b = find_shell_builtin (name)) == 0)
+    return 0;
+
+  w = w->next;
+  if (b == local_builtin)
+    return (depth > 0 && nofork_local_ok (w, locals, top));
+  else if (b == return_builtin)
+    return (depth > 0 && nofork_words_ok (w));
+  else if (b == printf_builtin)
+    {
+      /* printf -v assigns a variable. */
+      if (w && (w->word->word[0] == '-' || strpbrk (w->word->word, "$`")))
+	return 0;
+    }
+#if defined (PROGRAMMABLE_COMPLETION)
+  else if (b == compgen_builtin)
+    {
+      if (nofork_compgen_ok (w) == 0)
+	return 0;
+    }
+#endif
+  else if (b == test_builtin)
+    {
+      for (l = w; l; l = l->next)
+	if (nofork_stdout_word (l->word))
+	  return 0;
+    }
+  else if (b != echo_builtin && b != colon_builtin && b != false_builtin)
+    return 0;
+
+  return (nofork_words_ok (w));
+}
+
+#if defined (COND_COMMAND)
+/* [[ ... ]] is safe unless it uses =~, which sets BASH_REMATCH, or an
+   arithmetic comparison, which evaluates its operands as expressions, or
+   tests a file that names the standard output. */
+static int
+nofork_cond_ok (cond)
+     COND_COM *cond;
+{
+  char *op;
+
+  if (cond == 0)
+    return 1;
+
+  switch (cond->type)
+    {
+    case COND_AND:
+    case COND_OR:
+      return (nofork_cond_ok (cond->left) && nofork_cond_ok (cond->right));
+    case COND_EXPR:
+      return (nofork_cond_ok (cond->left));
+    case COND_UNARY:
+      return (nofork_word_ok (cond->op) && nofork_cond_ok (cond->left));
+    case COND_BINARY:
+      op = cond->op->word;
+      if (STREQ (op, "=~") || STREQ (op, "-eq") || STREQ (op, "-ne") ||
+	  STREQ (op, "-lt") || STREQ (op, "-le") || STREQ (op, "-gt") ||
+	  STREQ (op, "-ge"))
+	return 0;
+      return (nofork_cond_ok (cond->left) && nofork_cond_ok (cond->right));
+    case COND_TERM:
+      return (nofork_word_ok (cond->op) && nofork_stdout_word (cond->op) == 0);
+    default:
+      return 0;
+    }
+}
+#endif
+
+/* Return non-zero if COMMAND is safe to run without a child.  TOP is
+   non-zero if COMMAND always runs when the function body containing it
+   does, before anything that follows it. */
+static int
+nofork_command_ok (command, depth, locals, top)
+     COMMAND *command;
+     int depth;
+     STRINGLIST *locals;
+     int top;
+{
+  CONNECTION *c;
+  FOR_COM *f;
+  PATTERN_LIST *p;
+
+  if (command == 0)
+    return 1;
+  if (command->redirects || (command->flags & CMD_TIME_PIPELINE))
+    return 0;
+
+  switch (command->type)
+    {
+    case cm_simple:
+      return (nofork_simple_ok (command->value.Simple, depth, locals, top));
+
+    case cm_connection:
+      c = command->value.Connection;
+      if (c->connector == '&' || c->connector == '|')
+	return 0;
+      if (c->connector != ';')
+	top = 0;		/* && or || */
+      return (nofork_command_ok (c->first, depth, locals, top) &&
+	      nofork_command_ok (c->second, depth, locals, top));
+
+    case cm_group:
+      return (nofork_command_ok (command->value.Group->command, depth, locals, top));
+
+    case cm_if:
+      return (nofork_command_ok (command->value.If->test, depth, locals, 0) &&
+	      nofork_command_ok (command->value.If->true_case, depth, locals, 0) &&
+	      nofork_command_ok (command->value.If->false_case, depth, locals, 0));
+
+    case cm_while:
+    case cm_until:
+      return (nofork_command_ok (command->value.While->test, depth, locals, 0) &&
+	      nofork_command_ok (command->value.While->action, depth, locals, 0));
+
+    case cm_for:
+      /* The loop variable has to be local. */
+      f = command->value.For;
+      return (nofork_local_p (locals, f->name->word) &&
+	      nofork_words_ok (f->map_list) &&
+	      nofork_command_ok (f->action, depth, locals, 0));
+
+    case cm_case:
+      if (nofork_word_ok (command->value.Case->word) == 0)
+	return 0;
+      for (p = command->value.Case->clauses; p; p = p->next)
+	if (nofork_words_ok (p->patterns) == 0 ||
+	    nofork_command_ok (p->action, depth, locals, 0) == 0)
+	  return 0;
+      return 1;
+
+#if defined (COND_COMMAND)
+    case cm_cond:
+      return (nofork_cond_ok (command->value.Cond));
+#endif
+
+    default:
+      return 0;
+    }
+}
+
+/* Return non-zero if calling the shell function VAR is safe without a
+   child. */
+static int
+nofork_function_ok (var, depth)
+     SHELL_VAR *var;
+     int depth;
+{
+  STRINGLIST *locals;
+  int r;
+
+  locals = strlist_create (0);
+  r = nofork_command_ok (function_cell (var), depth, locals, 1);
+  strlist_dispose (locals);
+  return r;
+}
+
+/* Return non-zero if a command substitution may run without a child at
+   the moment.  Traps would run in this shell rather than in the child,
+   in posix mode the -e option would make this shell exit, and builtins
+   would take over a temporary environment that is still being built. */
+static int
+nofork_comsub_possible ()
+{
+  return (nofork_comsub && nofork_comsub_level == 0 &&
+	  temporary_env == 0 && assigning_in_environment == 0 &&
+	  (exit_immediately_on_error == 0 || posixly_correct == 0) &&
+	  signal_is_trapped (DEBUG_TRAP) == 0 &&
+	  signal_is_trapped (ERROR_TRAP) == 0 &&
+	  signal_is_trapped (RETURN_TRAP) == 0 &&
+	  any_signals_trapped () < 0);
+}
+
+/* Return a file descriptor open on a new, empty in-memory file, or on a
+   deleted temporary file if the system has no memfd_create. */
+static int
+comsub_buffer_fd ()
+{
+  int fd;
+  char *filename;
+
+#if defined (HAVE_MEMFD_CREATE)
+  fd = memfd_create ("comsub", MFD_CLOEXEC);
+  if (fd >= 0)
+    return fd;
+#endif
+
+  fd = sh_mktmpfd ("sh-comsub", MT_USERANDOM|MT_USETMPDIR|MT_READWRITE, &filename);
+  if (fd >= 0)
+    {
+      unlink (filename);
+      free (filename);
+      SET_CLOSE_ON_EXEC (fd);
+    }
+  return fd;
+}
+
+/* Flush the output of a command substitution run without a child and
+   make FD standard output again. */
+static void
+restore_comsub_stdout (fd)
+     int fd;
+{
+  fflush (stdout);
+  dup2 (fd, 1);
+  close (fd);
+}
+
+/* Run the command substitution STRING in this shell if that is safe and
+   return 0, or return -1 if it has to run in a child.  When it runs here,
+   set *ISTRINGP and *RFLAG as read_comsub would, and set
+   last_command_exit_value to what the child's exit status would have
+   been.  PFLAGS are the flags the child would pass to parse_and_execute. */
+static int
+command_substitute_nofork (string, quoted, pflags, istringp, rflag)
+     char *string;
+     int quoted, pflags;
+     char **istringp;
+     int *rflag;
+{
+  sh_parser_state_t ps;
+  COMMAND *command;
+  struct fd_bitmap *bitmap;
+  char *s, *lastarg, *printed;
+  int fd, ofd, code, result;
+
+  *istringp = (char *)NULL;
+
+  /* We may be expanding a prompt or running a completion function while
+     the parser is in the middle of reading a command. */
+  save_parser_state (&ps);
+
+  s = savestring (string);
+  remove_quoted_escapes (s);
+  if (parse_string_to_command (s, "command substitution", pflags|SEVAL_NONINT|SEVAL_NOHIST, &command))
+    {
+      /* The child would have printed the same error and exited. */
+      restore_parser_state (&ps);
+      last_command_exit_value = EXECUTION_FAILURE;
+      return 0;
+    }
+  else if (command == 0)
+    {
+      restore_parser_state (&ps);
+      last_command_exit_value = EXECUTION_SUCCESS;
+      return 0;
+    }
+
+  /* If standard output is closed, let the child deal with it. */
+  ofd = fd = -1;
+  if (nofork_command_ok (command, 0, (STRINGLIST *)NULL, 0) == 0 ||
+      (ofd = dup (1)) < 0 || (fd = comsub_buffer_fd ()) < 0)
+    goto fork_instead;
+
+  fflush (stdout);
+  if (dup2 (fd, 1) < 0)
+    goto fork_instead;
+
+  lastarg = get_string_value ("_");
+  lastarg = lastarg ? savestring (lastarg) : (char *)NULL;
+  printed = the_printed_command_except_trap ? savestring (the_printed_command_except_trap) : (char *)NULL;
+
+  bitmap = new_fd_bitmap (FD_BITMAP_SIZE);
+  begin_unwind_frame ("nofork comsub");
+  add_unwind_protect (restore_parser_state, (char *)&ps);
+  add_unwind_protect (restore_comsub_stdout, ofd);
+  unwind_protect_jmp_buf (top_level);
+  unwind_protect_int (nofork_comsub_level);
+  unwind_protect_int (parse_and_execute_level);
+  unwind_protect_int (subshell_level);
+  unwind_protect_int (interactive);
+  unwind_protect_int (exit_immediately_on_error);
+  unwind_protect_int (comsub_ignore_return);
+  unwind_protect_int (line_number);
+  unwind_protect_int (loop_level);
+  unwind_protect_int (executing_list);
+  unwind_protect_int (last_command_exit_signal);
+  unwind_protect_int (expanding_redir);
+  unwind_protect_int (expand_no_split_dollar_star);
+  unwind_protect_pointer (this_command_name);
+  unwind_protect_pointer (subst_assign_varlist);
+  unwind_protect_pointer (garglist);
+  unwind_protect_pointer (cmd_arena);
+  add_unwind_protect (dispose_fd_bitmap, bitmap);
+  add_unwind_protect (dispose_command, command);
+  end_unwind_frame ();
+
+  /* Set things up the way command_substitute does in the child.  Raising
+     parse_and_execute_level keeps an expansion error from running every
+     unwind-protect on its way back to top_level. */
+  nofork_comsub_level++;
+  parse_and_execute_level++;
+  subshell_level++;
+  interactive = 0;
+  exit_immediately_on_error = 0;
+  comsub_ignore_return = 0;
+  subst_assign_varlist = (WORD_LIST *)NULL;
+  cmd_arena = (CMD_ARENA *)NULL;
+  comsub_nnoforks++;
+
+  code = setjmp (top_level);
+  if (code == 0)
+    result = execute_command_internal (command, 0, NO_PIPE, NO_PIPE, bitmap);
+  else if (nofork_comsub_level == 0)
+    {
+      /* An interrupt ran all of the unwind-protects, ours included, before
+	 jumping here.  Pass the jump on. */
+      close (fd);
+      FREE (lastarg);
+      FREE (printed);
+      jump_to_top_level (code);
+    }
+  else
+    /* An error the child would have exited for. */
+    result = (code == ERREXIT || code == EXITPROG) ? last_command_exit_value
+						   : EXECUTION_FAILURE;
+
+  run_unwind_frame ("nofork comsub");
+
+  bind_variable ("_", lastarg, 0);
+  FREE (lastarg);
+  FREE (the_printed_command_except_trap);
+  the_printed_command_except_trap = printed;
+
+  lseek (fd, 0, SEEK_SET);
+  *istringp = read_comsub (fd, quoted, rflag);
+  close (fd);
+
+  last_command_exit_value = result;
+  return 0;
+
+fork_instead:
+  if (fd >= 0)
+    close (fd);
+  if (ofd >= 0)
+    close (ofd);
+  restore_parser_state (&ps);
+  dispose_command (command);
+  return -1;
+}
+
 /* Perform command substitution on STRING.  This returns a WORD_DESC * with the
    contained string possibly quoted. */
 WORD_DESC *
@@ -5042,6 +5738,22 @@ command_substitute (string, quoted)
       jump_to_top_level (EXITPROG);
     }
 
+  /* Flags to pass to parse_and_execute() */
+  pflags = (interactive && sourcelevel == 0) ? SEVAL_RESETLINE : 0;
+
+  /* Don't fork if the command substitution can run in this shell. */
+  if (nofork_comsub_possible () &&
+      command_substitute_nofork (string, quoted, pflags, &istring, &tflag) == 0)
+    {
+      last_command_subst_pid = getpid ();
+
+      ret = alloc_word_desc ();
+      ret->word = istring;
+      ret->flags = tflag;
+
+      return ret;
+    }
+
   /* We're making the assumption here that the command substitution will
      eventually run a command from the file system.  Since we'll run
      maybe_make_export_env in this subshell before executing that command,
@@ -5054,9 +5766,6 @@ command_substitute (string, quoted)
   if (subst_assign_varlist == 0 || garglist == 0)
     maybe_make_export_env ();	/* XXX */
 
-  /* Flags to pass to parse_and_execute() */
-  pflags = (interactive && sourcelevel == 0) ? SEVAL_RESETLINE : 0;
-
   /* Pipe the output of executing STRING into the current shell. */
   if (pipe (fildes) < 0)
     {
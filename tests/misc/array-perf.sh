@@ -0,0 +1,54 @@
+# Time indexed array assignment and reference as the array size doubles.
+# The times should roughly double along with the size; a quadratic array
+# implementation makes them grow fourfold.  The sparse case assigns every
+# third index and reads the elements back in order.  The reverse and
+# shuffled cases fill the array from the highest index down and in a
+# scattered order, then read it back in a scattered order.  The unset
+# case fills the array, unsets all but the last element, and assigns a
+# few scattered indices again.
+# usage: bash array-perf.sh [elements [doublings]]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+ELEMENTS=${1:-10000}
+STEPS=${2:-4}
+
+${THIS_SH} --norc --noprofile -c '
+n=$1 steps=$2
+while [ $steps -gt 0 ]
+do
+	echo "$n elements"
+	unset a
+	TIMEFORMAT="  assign      %3R"
+	time for ((i = 0; i < n; i++)); do a[i]=$i; done
+	TIMEFORMAT="  sequential  %3R"
+	time for ((i = 0; i < n; i++)); do : ${a[i]}; done
+	TIMEFORMAT="  random      %3R"
+	time for ((i = 0; i < n; i++)); do : ${a[i * 7919 % n]}; done
+	unset a
+	TIMEFORMAT="  sparse      %3R"
+	time {
+		for ((i = 0; i < n; i++)); do a[i * 3]=$i; done
+		for ((i = 0; i < n; i++)); do : ${a[i * 3]}; done
+	}
+	unset a
+	TIMEFORMAT="  reverse     %3R"
+	time {
+		for ((i = n - 1; i >= 0; i--)); do a[i]=$i; done
+		for ((i = 0; i < n; i++)); do : ${a[i * 7919 % n]}; done
+	}
+	unset a
+	TIMEFORMAT="  shuffled    %3R"
+	time {
+		for ((i = 0; i < n; i++)); do a[i * 7919 % n]=$i; done
+		for ((i = 0; i < n; i++)); do : ${a[i * 7919 % n]}; done
+	}
+	unset a
+	TIMEFORMAT="  unset       %3R"
+	time {
+		for ((i = 0; i < n; i++)); do a[i]=$i; done
+		for ((i = 0; i < n - 1; i++)); do unset "a[i]"; done
+		for ((i = 0; i < n; i += 100)); do a[i * 7919 % n]=$i; done
+	}
+	n=$((n * 2)) steps=$((steps - 1))
+done 2>&1' array-perf $ELEMENTS $STEPS
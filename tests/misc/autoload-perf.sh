@@ -0,0 +1,65 @@
+# Compare starting shells that source a large library of functions with
+# starting shells that register the same functions with `autoload', so
+# that only the functions actually called are read.  Reports the time to
+# start the shells and the resident set size of one shell (Linux only).
+# usage: bash autoload-perf.sh [functions [shells]]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+FUNCS=${1:-2000}
+SHELLS=${2:-20}
+
+TMPDIR=${TMPDIR:-/tmp}
+LIB=$TMPDIR/autoload-perf-$$.sh
+INDEX=$TMPDIR/autoload-perf-$$.idx
+trap 'rm -f $LIB $INDEX' 0
+
+# Write the library and an index of autoload commands giving the byte
+# range of each definition.
+LC_ALL=C
+off=0
+i=0
+: > $LIB
+while [ $i -lt $FUNCS ]; do
+	def="_comp_$i ()
+{
+	local cur prev words cword
+	cur=\${COMP_WORDS[COMP_CWORD]} prev=\${COMP_WORDS[COMP_CWORD-1]}
+	case \$prev in
+	-f|--file)	COMPREPLY=( \$(compgen -f -- \"\$cur\") ); return 0 ;;
+	-d|--dir)	COMPREPLY=( \$(compgen -d -- \"\$cur\") ); return 0 ;;
+	esac
+	if [[ \$cur == -* ]]; then
+		COMPREPLY=( \$(compgen -W '--file --dir --help --version' -- \"\$cur\") )
+	else
+		for w in \"\${COMP_WORDS[@]}\"; do [ \"\$w\" = -- ] && break; done
+	fi
+}
+"
+	printf '%s' "$def" >> $LIB
+	echo "autoload -f $LIB -o $off -l ${#def} _comp_$i"
+	off=$((off + ${#def}))
+	i=$((i + 1))
+done > $INDEX
+
+# Each shell calls one of the functions.
+CALL='COMP_WORDS=(cmd0 --f) COMP_CWORD=1; _comp_0'
+
+run()
+{
+	local start end n=0
+	start=$(date +%s%N)
+	while [ $n -lt $SHELLS ]; do
+		${THIS_SH} --norc --noprofile -c ". $1; $CALL"
+		n=$((n + 1))
+	done
+	end=$(date +%s%N)
+	rss=$(${THIS_SH} --norc --noprofile -c ". $1; $CALL
+		while read key value; do
+			[ \"\$key\" = VmRSS: ] && echo \$value
+		done < /proc/\$\$/status")
+	echo "$2: $SHELLS shells in $(( (end - start) / 1000000 ))ms, ${rss:-?} resident"
+}
+
+run $LIB "source library"
+run $INDEX "autoload index"
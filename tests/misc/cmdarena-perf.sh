@@ -0,0 +1,42 @@
+# Time running many short commands through eval, as completion functions
+# do, and sourcing a large generated script, with the cmdarena option
+# enabled and disabled.  Reports the time taken and how many parse tree
+# nodes were allocated one at a time and from arenas.
+# usage: bash cmdarena-perf.sh [iterations]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+ITER=${1:-20000}
+
+TMPDIR=${TMPDIR:-/tmp}
+SCRIPT=$TMPDIR/cmdarena-perf-$$.sh
+trap 'rm -f $SCRIPT' 0
+
+i=0
+while [ $i -lt 500 ]; do
+	echo "f$i () { local a=\$1 b; case \$a in x*) b=\${a#x} ;; *) b=\$a ;; esac; [[ -n \$b ]] && : \"\$b\"; }"
+	echo "if [ $i -gt 0 ]; then for w in a b c; do f$i \"x\$w\"; done; fi"
+	i=$((i + 1))
+done > $SCRIPT
+
+TEST='
+i=0
+while (( i++ < '$ITER' )); do
+	eval "w=(\$i x y); [[ \${w[0]} == 1* ]] && : \${w[1]}"
+done
+. '$SCRIPT'
+echo "heap ${BASH_STATS[cmd_heap_nodes]} nodes, ${BASH_STATS[cmd_heap_frees]} frees; arena ${BASH_STATS[cmd_arena_nodes]} nodes, ${BASH_STATS[cmd_arena_blocks]} blocks"'
+
+run()
+{
+	local start end out
+	start=$(date +%s%N)
+	out=$(BASH_STATS= ${THIS_SH} --norc --noprofile -c "shopt $1 cmdarena
+$TEST")
+	end=$(date +%s%N)
+	echo "$2: $(( (end - start) / 1000000 ))ms"
+	echo "  $out"
+}
+
+run -s "cmdarena on"
+run -u "cmdarena off"
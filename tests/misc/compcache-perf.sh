@@ -0,0 +1,40 @@
+# Run a completion function that builds its matches from a large word list
+# the way a configuration-tree completion does, for repeated and narrowing
+# completions of the same word, with and without the `cache' compspec
+# option, and report the time taken and how many times the function ran.
+# usage: bash compcache-perf.sh [words [rounds]]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+WORDS=${1:-5000}
+ROUNDS=${2:-50}
+
+${THIS_SH} --norc --noprofile -c '
+	nwords=$1 rounds=$2
+	list=()
+	for (( i = 0; i < nwords; i++ )); do list[i]=node$i; done
+	_comp() {
+		local w
+		(( calls++ ))
+		COMPREPLY=()
+		for w in "${list[@]}"; do
+			[[ $w == "$2"* ]] && COMPREPLY+=("$w")
+		done
+	}
+
+	run() {
+		local start end r
+		calls=0
+		start=$(date +%s%N)
+		for (( r = 0; r < rounds; r++ )); do
+			for w in n no nod node node1 node12; do
+				compgen $1 -F _comp -- $w >/dev/null 2>&1
+			done
+		done
+		end=$(date +%s%N)
+		echo "$2: $rounds rounds in $(( (end - start) / 1000000 ))ms, function ran $calls times"
+	}
+
+	run "" "no cache"
+	run "-o cache" "cache"
+' compcache-perf $WORDS $ROUNDS
@@ -0,0 +1,32 @@
+# Time a loop of command substitutions that run only builtins and shell
+# functions, first with the nofork_comsub option enabled and then with
+# each substitution run in a forked child, and report how many ran
+# without a child.
+# usage: bash comsub-perf.sh [iterations]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+ITER=${1:-5000}
+
+SCRIPT='
+join() { local IFS=$1; shift; echo "$*"; }
+n=0 i=0
+while [ $i -lt '$ITER' ]; do
+	v=$(join , a b c)
+	w=$(printf "%s-%s" x "$i")
+	n=$(( n + ${#v} + ${#w} ))
+	i=$(( i + 1 ))
+done
+echo "$n ${BASH_STATS[comsub_noforks]}"'
+
+run()
+{
+	local start end out
+	start=$(date +%s%N)
+	out=$(BASH_STATS= ${THIS_SH} --norc --noprofile -c "shopt $1 nofork_comsub; $SCRIPT")
+	end=$(date +%s%N)
+	echo "$2: $ITER iterations in $(( (end - start) / 1000000 ))ms, ${out#* } without a child"
+}
+
+run -s "nofork_comsub on"
+run -u "nofork_comsub off"
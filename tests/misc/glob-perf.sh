@@ -0,0 +1,40 @@
+# Build a synthetic directory with many entries, most of them files and
+# some of them directories, and time globbing it with patterns that list
+# the files, list only the directories, and look inside the directories.
+# With strace available, also report how many stat calls each pattern
+# makes.
+# usage: bash glob-perf.sh [entries [directory]]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+ENTRIES=${1:-100000}
+TMPDIR=${TMPDIR:-/tmp}
+GDIR=${2:-$TMPDIR/glob-perf-$$}
+
+if [ -z "$2" ]; then
+	trap 'rm -rf $GDIR' 0
+	mkdir -p $GDIR || exit 1
+	${THIS_SH} -c '
+		cd $1 || exit 1
+		for (( i = 0; i < $2; i++ )); do
+			if (( i % 100 == 0 )); then
+				mkdir node$i && : > node$i/node.def
+			else
+				: > file$i.def
+			fi
+		done
+	' glob-perf $GDIR $ENTRIES
+fi
+
+for pat in '*' '*.def' 'node*/' '*/node.def' '*/*.def'; do
+	start=$(date +%s%N)
+	n=$(cd $GDIR && ${THIS_SH} -c 'set -- '"$pat"'; echo $#')
+	end=$(date +%s%N)
+	line="$(printf '%-12s %7d names %6dms' "$pat" $n $(( (end - start) / 1000000 )))"
+	if type strace >/dev/null 2>&1; then
+		stats=$(cd $GDIR && strace -f -c -e trace=stat,lstat,newfstatat,statx ${THIS_SH} -c 'set -- '"$pat" 2>&1 >/dev/null |
+			awk '$NF ~ /stat/ { n += $4 } END { print n + 0 }')
+		line="$line $(printf '%7d stats' $stats)"
+	fi
+	echo "$line"
+done
@@ -0,0 +1,99 @@
+# Time shells starting up with a large history file, with and without
+# shopt -s histappendonly, then run many interactive shells at once that
+# each append a few entries when they exit, and count the entries that
+# were lost or mangled in the history file they share.  Last, read a
+# history file reached through a symbolic link while it is rewritten in
+# place, and count the readers that crashed.
+# usage: bash histfile-perf.sh [entries [shells [writers]]]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+ENTRIES=${1:-1000000}
+SHELLS=${2:-10}
+WRITERS=${3:-20}
+
+TMPDIR=${TMPDIR:-/tmp}
+HFILE=$TMPDIR/histfile-perf-$$
+RCFILE=$TMPDIR/histfile-perf-rc-$$
+HLINK=$TMPDIR/histfile-perf-link-$$
+trap 'rm -f $HFILE $RCFILE $HLINK' 0
+
+awk -v n=$ENTRIES 'BEGIN {
+	for (i = 0; i < n; i++)
+		printf "#%d\ncommand %d --with some arguments\n", 1300000000 + i, i
+}' > $HFILE
+
+for mode in off on; do
+	start=$(date +%s%N)
+	for (( i = 0; i < SHELLS; i++ )); do
+		HISTFILE=$HFILE HISTSIZE=500 HISTFILESIZE=$(( ENTRIES * 2 )) \
+			${THIS_SH} --norc --noprofile -c "
+				[ $mode = on ] && shopt -s histappendonly
+				set -o history" </dev/null
+	done
+	end=$(date +%s%N)
+	echo "histappendonly $mode: $ENTRIES entries: $SHELLS startups in $(( (end - start) / 1000000 ))ms"
+done
+
+# Each writer runs ten shells one after another; each shell enters five
+# commands and keeps the last 200 entries in the file.
+for mode in off on; do
+	[ $mode = on ] && echo 'shopt -s histappendonly' > $RCFILE || : > $RCFILE
+	: > $HFILE
+	for (( w = 0; w < WRITERS; w++ )); do
+		(
+		for (( s = 0; s < 10; s++ )); do
+			for (( i = 0; i < 5; i++ )); do
+				echo ": entry $w.$s.$i"
+			done | HISTFILE=$HFILE HISTSIZE=100 HISTFILESIZE=200 \
+				${THIS_SH} --rcfile $RCFILE -i >/dev/null 2>&1
+		done
+		) &
+	done
+	wait
+	sleep 1		# let the last compaction finish
+
+	# every shell whose entries are in the file, except the oldest, whose
+	# first entries may have been truncated, should have all five
+	awk -v mode=$mode '
+	/^: entry [0-9]+\.[0-9]+\.[0-4]$/ {
+		split($3, e, ".")
+		if (NR == 1)
+			first = e[1] "." e[2]
+		n[e[1] "." e[2]]++
+		next
+	}
+	{ bad++ }
+	END {
+		for (s in n)
+			if (n[s] != 5 && s != first)
+				partial++
+		printf "histappendonly %s: %d lines mangled, %d shells with entries missing\n", mode, bad, partial
+	}' $HFILE
+done
+
+# A symbolic link is rewritten in place, alternately with all of the
+# entries and with just a few, while other shells read it.
+awk -v n=$ENTRIES 'BEGIN { for (i = 0; i < n; i++) printf "command %d\n", i }' > $RCFILE
+ln -s $HFILE $HLINK
+cp $RCFILE $HFILE
+${THIS_SH} --norc --noprofile -c "
+	shopt -s histappendonly; HISTFILE=$HLINK; set -o history
+	for (( i = 0; i < 10; i++ )); do
+		HISTSIZE=$ENTRIES; history -c; history -r $RCFILE; history -w
+		HISTSIZE=100; history -w
+	done" </dev/null &
+readers=()
+for (( w = 0; w < WRITERS; w++ )); do
+	${THIS_SH} --norc --noprofile -c "
+		shopt -s histappendonly; HISTFILE=$HLINK; HISTSIZE=$ENTRIES
+		set -o history
+		for (( i = 0; i < 10; i++ )); do history -c; history -r; done" </dev/null >/dev/null 2>&1 &
+	readers+=($!)
+done
+crashed=0
+for pid in ${readers[@]}; do
+	wait $pid 2>/dev/null || crashed=$(( crashed + 1 ))
+done
+wait
+echo "histappendonly on: $crashed of $WRITERS readers crashed reading a file rewritten in place"
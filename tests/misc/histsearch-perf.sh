@@ -0,0 +1,48 @@
+# Load history lists of increasing size and time searches that have to
+# look at every entry: `!?string?' and `!string' history expansion, which
+# use the same search functions as readline's history searches.  The
+# strings searched for appear only in the oldest entry.
+# usage: bash histsearch-perf.sh [searches [entries...]]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+SEARCHES=${1:-20}
+shift
+SIZES=${@:-10000 100000 1000000}
+
+TMPDIR=${TMPDIR:-/tmp}
+HFILE=$TMPDIR/histsearch-perf-$$
+trap 'rm -f $HFILE' 0
+
+for size in $SIZES; do
+	awk -v n=$size 'BEGIN {
+		split("git commit -m fix;make -j8 all;ls -l /var/log;cd /usr/src;grep -rn TODO .;ssh build-host uptime;vim config.h;tail -f messages", cmds, ";")
+		print "oldest-entry --needle"
+		for (i = 1; i < n; i++)
+			printf "%s %d\n", cmds[i % 8 + 1], i
+	}' > $HFILE
+
+	${THIS_SH} --norc --noprofile -c '
+		HISTSIZE=$(( $1 + 100 )) searches=$3
+		unset HISTFILE
+
+		# Defined before history is turned on, so that the history
+		# does not end with a line containing the search strings.
+		search()
+		{
+			for (( i = 0; i < searches; i++ )); do
+				history -p "!?--needle?" >/dev/null
+				history -p "!oldest" >/dev/null
+			done
+		}
+
+		set -o history
+		history -r $2
+
+		start=$(date +%s%N)
+		search
+		end=$(date +%s%N)
+
+		echo "$1 entries: $searches searches in $(( (end - start) / 1000000 ))ms"
+	' histsearch-perf $size $HFILE $SEARCHES
+done
@@ -0,0 +1,53 @@
+# Time sourcing a large file of function definitions, the way login shells
+# source completion scripts, with and without BASH_PARSE_CACHE.  Each
+# source runs in a new shell; the first cached run writes the cache file.
+# usage: bash parsecache-perf.sh [functions [shells]]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+FUNCS=${1:-500}
+SHELLS=${2:-20}
+
+TMPDIR=${TMPDIR:-/tmp}
+SCRIPT=$TMPDIR/parsecache-perf-$$.sh
+CACHE=$TMPDIR/parsecache-perf-$$.d
+trap 'rm -rf $SCRIPT $CACHE' 0
+mkdir $CACHE
+
+i=0
+while [ $i -lt $FUNCS ]; do
+	cat <<EOF
+_comp_$i()
+{
+	local cur prev words cword
+	cur=\${COMP_WORDS[COMP_CWORD]} prev=\${COMP_WORDS[COMP_CWORD-1]}
+	case \$prev in
+	-f|--file)	COMPREPLY=( \$(compgen -f -- "\$cur") ); return 0 ;;
+	-d|--dir)	COMPREPLY=( \$(compgen -d -- "\$cur") ); return 0 ;;
+	esac
+	if [[ \$cur == -* ]]; then
+		COMPREPLY=( \$(compgen -W '--file --dir --help --version' -- "\$cur") )
+	else
+		for w in "\${COMP_WORDS[@]}"; do [ "\$w" = -- ] && break; done
+	fi
+} && complete -F _comp_$i cmd$i
+EOF
+	i=$((i + 1))
+done > $SCRIPT
+
+run()
+{
+	local start end n=0
+	start=$(date +%s%N)
+	while [ $n -lt $SHELLS ]; do
+		${THIS_SH} --norc --noprofile -c ". $SCRIPT"
+		n=$((n + 1))
+	done
+	end=$(date +%s%N)
+	echo "$1: $SHELLS shells in $(( (end - start) / 1000000 ))ms"
+}
+
+run "no cache"
+BASH_PARSE_CACHE=$CACHE ${THIS_SH} --norc --noprofile -c ". $SCRIPT"
+BASH_PARSE_CACHE=$CACHE run "cached"
+BASH_STATS= BASH_PARSE_CACHE=$CACHE ${THIS_SH} --norc --noprofile -c '. "$1"; echo "hits ${BASH_STATS[parse_cache_hits]} misses ${BASH_STATS[parse_cache_misses]}"' sh $SCRIPT
@@ -0,0 +1,47 @@
+# Fill a number of directories with files, put them at the front of PATH,
+# and time searching PATH for a command in the last directory of PATH and
+# completing command names, the way command-position completion does, so
+# that the cost of rescanning the directories can be compared with the
+# cost of using their indexes (shopt pathindex).
+# usage: bash pathindex-perf.sh [directories [files [rounds]]]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+DIRS=${1:-8}
+FILES=${2:-2000}
+ROUNDS=${3:-200}
+
+TMPDIR=${TMPDIR:-/tmp}
+TOP=$TMPDIR/pathindex-perf-$$
+trap 'rm -rf $TOP' 0
+
+p=
+d=0
+while [ $d -lt $DIRS ]; do
+	mkdir -p $TOP/d$d
+	(cd $TOP/d$d && i=0 && while [ $i -lt $FILES ]; do
+		: > cmd$d-$i; i=$((i + 1))
+	done && chmod +x cmd*)
+	p=$p$TOP/d$d:
+	d=$((d + 1))
+done
+mkdir -p $TOP/last
+printf '#!/bin/sh\n' > $TOP/last/lastcmd
+chmod +x $TOP/last/lastcmd
+
+for opt in -u -s; do
+	PATH=$p$TOP/last:$PATH ${THIS_SH} --norc --noprofile -c '
+		shopt $1 pathindex
+		rounds=$2
+		start=$(date +%s%N)
+		for (( r = 0; r < rounds; r++ )); do
+			type -P lastcmd >/dev/null
+		done
+		mid=$(date +%s%N)
+		for (( r = 0; r < rounds / 10; r++ )); do
+			compgen -c cmd1-1 >/dev/null
+		done
+		end=$(date +%s%N)
+		echo "shopt $1 pathindex: $rounds searches in $(( (mid - start) / 1000000 ))ms, $(( rounds / 10 )) completions in $(( (end - mid) / 1000000 ))ms"
+	' pathindex-perf $opt $ROUNDS
+done
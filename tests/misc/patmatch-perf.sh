@@ -0,0 +1,39 @@
+# Match one string against the same `case' patterns, [[ == ]] patterns,
+# and ${var%pattern} removals many times, the way a script classifying
+# lines of input does, and report the time each takes.  Run it with the C
+# locale and with a UTF-8 locale to compare byte and multibyte matching.
+# usage: bash patmatch-perf.sh [iterations]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+ITERS=${1:-20000}
+
+${THIS_SH} --norc --noprofile -c '
+	n=$1
+	l=some/long/path/name/with/components/file12345.tar.gz
+
+	ms() { echo $(( ($(date +%s%N) - $1) / 1000000 )); }
+
+	start=$(date +%s%N)
+	for (( i = 0; i < n; i++ )); do
+		case $l in
+		*.c|*.h|*.cc|*.y|*.l|*.s|*.py|*.sh|*.pl|*.rb|*.go|*.js)	;;
+		*/src/*|*/lib/*|*/include/*|*/tests/*|*/doc/*)	;;
+		*[[:upper:]]*|*.tar.bz2|*.tar.xz|*.zip)	;;
+		some/*/file[0-9][0-9][0-9][0-9][0-9].tar.gz)	;;
+		esac
+	done
+	echo "case: $(ms $start)ms"
+
+	start=$(date +%s%N)
+	for (( i = 0; i < n; i++ )); do
+		[[ $l == *.tar.gz ]] && [[ $l == some/* ]] && [[ $l == *file?????.* ]]
+	done
+	echo "[[ == ]]: $(ms $start)ms"
+
+	start=$(date +%s%N)
+	for (( i = 0; i < n; i++ )); do
+		d=${l%%/*} b=${l##*/} e=${b%.*}
+	done
+	echo "\${var%pattern}: $(ms $start)ms"
+' patmatch-perf $ITERS
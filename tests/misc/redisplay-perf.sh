@@ -0,0 +1,64 @@
+# Replay typing, line editing, and a completion listing against a
+# pseudo-terminal, once with the batch-redisplay readline variable on and
+# once with it off, and report how many bytes the terminal received and
+# how many writes readline made to send them.  script(1) supplies the
+# pseudo-terminal; the write(2) count comes from /proc where there is one.
+# usage: bash redisplay-perf.sh [rounds [files]]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+ROUNDS=${1:-3}
+FILES=${2:-300}
+
+TMPDIR=${TMPDIR:-/tmp}
+DIR=$TMPDIR/redisplay-perf-$$
+trap 'rm -rf $DIR' 0
+mkdir -p $DIR/files || exit 1
+
+i=0
+while [ $i -lt $FILES ]; do
+	: > $DIR/files/file$i
+	i=$((i + 1))
+done
+
+cat > $DIR/rc <<'RC'
+PS1='$ '
+trap 'echo "${BASH_STATS[redisplay_bytes]} ${BASH_STATS[redisplay_writes]} $(sed -n "s/^syscw: //p" /proc/$$/io 2>/dev/null)" > $REPORT' EXIT
+RC
+
+# Type each character of $1 separately, so readline redraws the line
+# after each one instead of reading them as typeahead.
+type_keys()
+{
+	keys=$1
+	while [ -n "$keys" ]; do
+		rest=${keys#?}
+		printf '%s' "${keys%"$rest"}"
+		keys=$rest
+		sleep 0.02
+	done
+}
+
+session()
+{
+	sleep 0.5
+	r=0
+	while [ $r -lt $ROUNDS ]; do
+		type_keys "echo the quick brown fox jumps over the lazy dog"
+		type_keys "$(printf '\002\002\002\002\001\006\006\006\005\010\010\010')"
+		type_keys "$(printf '\025: %s/files/file1\t\t' $DIR)"
+		sleep 0.3
+		type_keys "$(printf '\025')"
+		r=$((r + 1))
+	done
+	printf 'exit\r'
+	sleep 0.5
+}
+
+for mode in on off; do
+	printf 'set batch-redisplay %s\nset page-completions off\nset completion-query-items 0\n' $mode > $DIR/inputrc
+	session | BASH_STATS= INPUTRC=$DIR/inputrc REPORT=$DIR/report TERM=${TERM:-xterm} \
+		script -qfc "$THIS_SH --rcfile $DIR/rc -i" /dev/null > $DIR/out
+	set -- $(cat $DIR/report 2>/dev/null)
+	echo "batch-redisplay $mode: $(wc -c < $DIR/out) bytes received, readline wrote ${1:-?} bytes in ${2:-?} batched writes, ${3:-?} write(2) calls in all"
+done
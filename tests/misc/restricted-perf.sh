@@ -0,0 +1,47 @@
+# Time Vyatta restricted mode command checking against large level files.
+# usage: bash restricted-perf.sh [entries [lines]]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+ENTRIES=${1:-5000}
+LINES=${2:-2000}
+
+LEVEL_DIR=/tmp/vbash-level-$$
+trap 'rm -rf $LEVEL_DIR' 0 1 2 3 15
+mkdir -p $LEVEL_DIR
+
+echo full > $LEVEL_DIR/restricted-mode
+
+i=0
+while [ $i -lt $ENTRIES ]
+do
+	echo "cmd$i"
+	i=$((i + 1))
+done > $LEVEL_DIR/allowed-op
+printf ':\necho\n' >> $LEVEL_DIR/allowed-op
+
+i=0
+while [ $i -lt $ENTRIES ]
+do
+	echo "pipe$i"
+	echo 2
+	i=$((i + 1))
+done > $LEVEL_DIR/allowed-pipe
+printf 'cat\n1\n' >> $LEVEL_DIR/allowed-pipe
+
+# alternate lines so that every line is checked against the tables
+i=0
+while [ $i -lt $LINES ]
+do
+	echo ": $i"
+	echo ": $i | cat"
+	i=$((i + 1))
+done > $LEVEL_DIR/input
+
+echo "$ENTRIES allowed commands, $((LINES * 2)) command lines"
+time VYATTA_USER_LEVEL_DIR=$LEVEL_DIR ${THIS_SH} --norc --noprofile -i \
+	< $LEVEL_DIR/input > /dev/null 2>&1
+
+echo 'echo "level files loaded in $VYATTA_LEVEL_LOAD_TIME usec"' |
+	VYATTA_USER_LEVEL_DIR=$LEVEL_DIR ${THIS_SH} --norc --noprofile -i 2>&1 |
+	grep -o 'level files loaded in [0-9]* usec'
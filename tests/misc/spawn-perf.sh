@@ -0,0 +1,28 @@
+# Measure how many external commands per second the shell can run, with
+# and without `shopt -s spawncmds'.  The shell first fills an array with
+# the given number of elements, so the cost of forking a large shell
+# shows up the way it does in a shell full of functions and variables.
+# usage: bash spawn-perf.sh [commands [array-elements]]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+COMMANDS=${1:-2000}
+ELEMENTS=${2:-0}
+
+for opt in -u -s
+do
+	${THIS_SH} --norc --noprofile -c '
+	n=$1 elements=$2 opt=$3
+	for ((i = 0; i < elements; i++)); do
+		a[i]=xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx$i
+	done
+	shopt $opt spawncmds
+	start=$(date +%s%N)
+	for ((i = 0; i < n; i++)); do /bin/true; done
+	end=$(date +%s%N)
+	usec=$(( (end - start) / 1000 ))
+	printf "shopt %s spawncmds: %d commands in %d.%03ds, %d commands/second\n" \
+		$opt $n $((usec / 1000000)) $((usec / 1000 % 1000)) \
+		$(( n * 1000000 / (usec ? usec : 1) ))
+	' spawn-perf $COMMANDS $ELEMENTS $opt
+done
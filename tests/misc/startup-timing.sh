@@ -0,0 +1,37 @@
+# Start a number of login shells with BASH_STARTUP_TIMING set and report
+# the average time spent in each startup phase and startup file, so that
+# login latency can be compared between releases.
+# usage: bash startup-timing.sh [shells [shell-options]]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+SHELLS=${1:-20}
+OPTS=${2:--l}
+
+TMPDIR=${TMPDIR:-/tmp}
+REPORT=$TMPDIR/startup-timing-$$.log
+trap 'rm -f $REPORT' 0
+
+n=0
+while [ $n -lt $SHELLS ]; do
+	BASH_STARTUP_TIMING=$REPORT ${THIS_SH} $OPTS -c : </dev/null >/dev/null 2>&1
+	n=$((n + 1))
+done
+
+if [ ! -s $REPORT ]; then
+	echo "$0: no timing report written" >&2
+	exit 1
+fi
+
+# Average the elapsed time of each entry, indented by depth, in the order
+# the entries first appear.
+awk -F'\t' '
+$2 == "shell"	{ name = "total"; shells++ }
+$2 != "shell"	{ name = sprintf("%*s%s", 2 * $3, "", $6) }
+!(name in sum)	{ order[++nnames] = name }
+		{ sum[name] += $5; count[name]++ }
+END {
+	printf "%d shells\n", shells
+	for (i = 1; i <= nnames; i++)
+		printf "%8.0fus  %s\n", sum[order[i]] / count[order[i]], order[i]
+}' $REPORT
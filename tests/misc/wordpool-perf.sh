@@ -0,0 +1,29 @@
+# Expand "${arr[@]}" over a large array many times, as arguments to a
+# function, to `set', and in an array assignment, and report the time taken
+# and how many word nodes were allocated and how many blocks the word pools
+# needed to supply them.
+# usage: bash wordpool-perf.sh [elements [rounds]]
+# Set THIS_SH if the vbash binary is not ../../vbash.
+
+: ${THIS_SH:=../../vbash}
+ELEMS=${1:-50000}
+ROUNDS=${2:-10}
+
+BASH_STATS= ${THIS_SH} --norc --noprofile -c '
+	elems=$1 rounds=$2
+	arr=()
+	for (( i = 0; i < elems; i++ )); do arr[i]=w$i; done
+	f() { return $#; }
+
+	start=$(date +%s%N)
+	for (( r = 0; r < rounds; r++ )); do
+		f "${arr[@]}"
+		set -- "${arr[@]}"
+		copy=("${arr[@]}")
+	done
+	end=$(date +%s%N)
+
+	echo "$rounds rounds over $elems elements in $(( (end - start) / 1000000 ))ms"
+	echo "word nodes allocated: ${BASH_STATS[cmd_heap_nodes]}"
+	echo "pool blocks allocated: ${BASH_STATS[cmd_pool_blocks]}"
+' wordpool-perf $ELEMS $ROUNDS
@@ -204,3 +204,6 @@ $THIS_SH ./varenv2.sub
 
 # make sure variable scoping is done right
 tt() { typeset a=b;echo a=$a; };a=z;echo a=$a;tt;echo a=$a
+
+# in-place updates of the export environment
+${THIS_SH} ./varenv3.sub
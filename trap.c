@@ -995,6 +995,29 @@ restore_original_signals ()
   reset_or_restore_signal_handlers (restore_signal);
 }
 
+#if defined (HAVE_POSIX_SIGNALS)
+/* Add to SET the signals restore_original_signals would set to SIG_DFL.
+   Children created with posix_spawn can't run restore_original_signals,
+   but signals the shell catches are reset by execve, so this only matters
+   for the signals the shell ignores itself, like SIGQUIT. */
+void
+get_original_signal_defaults (set)
+     sigset_t *set;
+{
+  register int i;
+
+  for (i = 1; i < NSIG; i++)
+    {
+      if ((sigmodes[i] & (SIG_TRAPPED|SIG_SPECIAL)) == 0)
+	continue;
+      if ((sigmodes[i] & SIG_TRAPPED) && trap_list[i] == (char *)IGNORE_SIG)
+	continue;
+      if (original_signals[i] == SIG_DFL)
+	sigaddset (set, i);
+    }
+}
+#endif
+
 /* If a trap handler exists for signal SIG, then call it; otherwise just
    return failure. */
 int
@@ -1035,6 +1058,19 @@ signal_is_trapped (sig)
   return (sigmodes[sig] & SIG_TRAPPED);
 }
 
+/* Return the first signal with a trap set, or -1 if no signal is trapped.
+   The pseudo-signals (EXIT, DEBUG, ERR, RETURN) don't count. */
+int
+any_signals_trapped ()
+{
+  register int i;
+
+  for (i = 1; i < NSIG; i++)
+    if (sigmodes[i] & SIG_TRAPPED)
+      return i;
+  return -1;
+}
+
 int
 signal_is_special (sig)
      int sig;
@@ -84,6 +84,9 @@ extern void run_return_trap __P((void));
 extern void free_trap_strings __P((void));
 extern void reset_signal_handlers __P((void));
 extern void restore_original_signals __P((void));
+#if defined (HAVE_POSIX_SIGNALS)
+extern void get_original_signal_defaults __P((sigset_t *));
+#endif
 
 extern char *signal_name __P((int));
 
@@ -91,6 +94,7 @@ extern int decode_signal __P((char *, int));
 extern void run_interrupt_trap __P((void));
 extern int maybe_call_trap_handler __P((int));
 extern int signal_is_trapped __P((int));
+extern int any_signals_trapped __P((void));
 extern int signal_is_ignored __P((int));
 extern int signal_is_special __P((int));
 extern void set_signal_ignored __P((int));
@@ -99,6 +99,12 @@ extern char *command_execution_string;
 extern time_t shell_start_time;
 extern int assigning_in_environment;
 extern int executing_builtin;
+extern unsigned long zreadc_nreads;
+extern unsigned long comsub_nreads, comsub_nreallocs, comsub_nbytes;
+extern unsigned long comsub_nnoforks;
+extern unsigned long parse_cache_hits, parse_cache_misses;
+extern unsigned long parse_cache_fallbacks, parse_cache_writes;
+extern sh_obj_pool_t wdpool, wlpool;
 
 #if defined (READLINE)
 extern int no_line_editing;
@@ -122,6 +128,10 @@ HASH_TABLE *shell_functions = (HASH_TABLE *)NULL;
 HASH_TABLE *shell_function_defs = (HASH_TABLE *)NULL;
 #endif
 
+/* Where to find the definitions of autoloaded functions that have not been
+   read yet, indexed by function name. */
+static HASH_TABLE *shell_function_autoloads = (HASH_TABLE *)NULL;
+
 /* The current variable context.  This is really a count of how deep into
    executing functions we are. */
 int variable_context = 0;
@@ -156,6 +166,16 @@ char **export_env = (char **)NULL;
 static int export_env_index;
 static int export_env_size;
 
+/* Maps the name of each entry in EXPORT_ENV to its index, so a changed
+   variable's entry can be replaced without searching the array.  Built
+   when first needed after maybe_make_export_env remakes EXPORT_ENV. */
+static HASH_TABLE *export_env_slots = (HASH_TABLE *)NULL;
+
+/* The number of times EXPORT_ENV has been remade from scratch and the
+   number of variable assignments that updated it in place. */
+static unsigned long export_env_rebuilds = 0;
+static unsigned long export_env_updates = 0;
+
 #if defined (READLINE)
 static int winsize_assignment;		/* currently assigning to LINES or COLUMNS */
 static int winsize_assigned;		/* assigned to LINES or COLUMNS */
@@ -228,6 +248,9 @@ static SHELL_VAR *build_aliasvar __P((SHELL_VAR *));
 static SHELL_VAR *get_aliasvar __P((SHELL_VAR *));
 static SHELL_VAR *assign_aliasvar __P((SHELL_VAR *,  char *, arrayind_t, char *));
 #  endif
+
+static void stats_insert __P((HASH_TABLE *, char *, unsigned long));
+static SHELL_VAR *get_bashstats __P((SHELL_VAR *));
 #endif
 
 static SHELL_VAR *get_funcname __P((SHELL_VAR *));
@@ -240,6 +263,8 @@ static SHELL_VAR *new_shell_variable __P((const char *));
 static SHELL_VAR *make_new_variable __P((const char *, HASH_TABLE *));
 static SHELL_VAR *bind_variable_internal __P((const char *, char *, HASH_TABLE *, int, int));
 
+static void unbind_function_autoload __P((const char *));
+
 static void dispose_variable_value __P((SHELL_VAR *));
 static void free_variable_hash_data __P((PTR_T));
 
@@ -269,6 +294,10 @@ static void propagate_temp_var __P((PTR_T));
 static void dispose_temporary_env __P((sh_free_func_t *));     
 
 static inline char *mk_env_string __P((const char *, const char *, int));
+static void index_export_env __P((void));
+static void discard_export_env_index __P((void));
+static int export_env_slot __P((char *));
+static void add_export_env_slot __P((char *, int));
 static char **make_env_array_from_var_list __P((SHELL_VAR **));
 static char **make_var_export_array __P((VAR_CONTEXT *));
 static char **make_func_export_array __P((void));
@@ -1032,7 +1061,10 @@ print_var_function (var)
 {
   char *x;
 
-  if (function_p (var) && var_isset (var))
+  if (function_p (var) && autoload_p (var))
+    var = autoload_function (var);
+
+  if (var && function_p (var) && var_isset (var))
     {
       x = named_function_string ((char *)NULL, function_cell(var), FUNC_MULTILINE|FUNC_EXTERNAL);
       printf ("%s", x);
@@ -1537,8 +1569,8 @@ build_hashcmd (self)
       return self;
     }
 
-  h = assoc_create (hashed_filenames->nbuckets);
-  for (i = 0; i < hashed_filenames->nbuckets; i++)
+  h = assoc_create (hashed_filenames->nchains);
+  for (i = 0; i < hashed_filenames->nchains; i++)
     {
       for (item = hash_items (i, hashed_filenames); item; item = item->next)
 	{
@@ -1591,8 +1623,8 @@ build_aliasvar (self)
       return self;
     }
 
-  h = assoc_create (aliases->nbuckets);
-  for (i = 0; i < aliases->nbuckets; i++)
+  h = assoc_create (aliases->nchains);
+  for (i = 0; i < aliases->nchains; i++)
     {
       for (item = hash_items (i, aliases); item; item = item->next)
 	{
@@ -1626,6 +1658,73 @@ assign_aliasvar (self, value, ind, key)
 }
 #endif /* ALIAS */
 
+static void
+stats_insert (h, key, n)
+     HASH_TABLE *h;
+     char *key;
+     unsigned long n;
+{
+  char buf[INT_STRLEN_BOUND (uintmax_t) + 1];
+
+  assoc_insert (h, savestring (key), uinttostr ((uintmax_t)n, buf, sizeof (buf)));
+}
+
+/* BASH_STATS reports counters kept by several parts of the shell.  It is
+   only set up if it is in the environment when the shell starts. */
+static SHELL_VAR *
+get_bashstats (self)
+     SHELL_VAR *self;
+{
+  HASH_TABLE *h;
+
+  h = assoc_cell (self);
+  if (h)
+    assoc_dispose (h);
+
+  h = assoc_create (32);
+
+  /* calls to read(2) made to read input a character at a time and to read
+     command substitution output, how often the command substitution result
+     had to grow, and how many command substitutions ran without forking */
+  stats_insert (h, "zreadc_reads", zreadc_nreads);
+  stats_insert (h, "comsub_reads", comsub_nreads);
+  stats_insert (h, "comsub_reallocs", comsub_nreallocs);
+  stats_insert (h, "comsub_bytes", comsub_nbytes);
+  stats_insert (h, "comsub_noforks", comsub_nnoforks);
+
+  /* how many times the environment passed to commands has been remade from
+     scratch, and how many variable assignments updated it in place */
+  stats_insert (h, "export_rebuilds", export_env_rebuilds);
+  stats_insert (h, "export_updates", export_env_updates);
+
+  /* how many sourced files were read from the parse cache and how many had
+     to be parsed, how many times a cached file stopped matching partway
+     through, and how many cache files were written */
+  stats_insert (h, "parse_cache_hits", parse_cache_hits);
+  stats_insert (h, "parse_cache_misses", parse_cache_misses);
+  stats_insert (h, "parse_cache_fallbacks", parse_cache_fallbacks);
+  stats_insert (h, "parse_cache_writes", parse_cache_writes);
+
+  /* how many command and word nodes have been allocated and freed one at a
+     time, and how many nodes and blocks have come from the arenas commands
+     are parsed into and from the word pools */
+  stats_insert (h, "cmd_heap_nodes", cmd_heap_nodes);
+  stats_insert (h, "cmd_heap_frees", cmd_heap_frees);
+  stats_insert (h, "cmd_arena_nodes", cmd_arena_nodes);
+  stats_insert (h, "cmd_arena_blocks", cmd_arena_blocks);
+  stats_insert (h, "cmd_pool_blocks", wdpool.nb + wlpool.nb);
+
+#if defined (READLINE)
+  /* how many bytes readline has sent to the terminal, and how many writes
+     it made to send redisplay output batched with `set batch-redisplay on' */
+  stats_insert (h, "redisplay_bytes", rl_output_bytes);
+  stats_insert (h, "redisplay_writes", rl_output_writes);
+#endif
+
+  var_setvalue (self, (char *)h);
+  return (self);
+}
+
 #endif /* ARRAY_VARS */
 
 /* If ARRAY_VARS is not defined, this just returns the name of any
@@ -1724,6 +1823,16 @@ initialize_dynamic_variables ()
 #  if defined (ALIAS)
   v = init_dynamic_assoc_var ("BASH_ALIASES", get_aliasvar, assign_aliasvar, att_nofree);
 #  endif
+
+  /* Listing the counters in every shell would change the output of set and
+     declare, so BASH_STATS replaces a variable imported from the
+     environment and isn't set up otherwise. */
+  v = find_variable ("BASH_STATS");
+  if (v && imported_p (v))
+    {
+      unbind_variable ("BASH_STATS");
+      v = init_dynamic_assoc_var ("BASH_STATS", get_bashstats, null_array_assign, att_noassign);
+    }
 #endif
 
   v = init_funcname_var ();
@@ -1810,11 +1919,23 @@ find_variable (name)
   return (find_variable_internal (name, (expanding_redir == 0 && (assigning_in_environment || executing_builtin))));
 }
 
-/* Look up the function entry whose name matches STRING.
-   Returns the entry or NULL. */
+/* Look up the function entry whose name matches STRING, reading the
+   definition of an autoloaded function first.  Returns the entry or NULL. */
 SHELL_VAR *
 find_function (name)
      const char *name;
+{
+  SHELL_VAR *var;
+
+  var = (SHELL_VAR *)hash_lookup (name, shell_functions);
+  return ((var && autoload_p (var)) ? autoload_function (var) : var);
+}
+
+/* Look up the function entry whose name matches STRING without reading
+   the definition of an autoloaded function.  Returns the entry or NULL. */
+SHELL_VAR *
+find_function_noload (name)
+     const char *name;
 {
   return (hash_lookup (name, shell_functions));
 }
@@ -1832,6 +1953,18 @@ find_function_def (name)
 #endif
 }
 
+/* Find where to read the definition of the autoloaded function named NAME.
+   Returns NULL if NAME is not an autoloaded function that has not been
+   read yet. */
+AUTOLOAD_DEF *
+find_function_autoload (name)
+     const char *name;
+{
+  if (shell_function_autoloads == 0)
+    return ((AUTOLOAD_DEF *)NULL);
+  return ((AUTOLOAD_DEF *)hash_lookup (name, shell_function_autoloads));
+}
+
 /* Return the value of VAR.  VAR is assumed to have been the result of a
    lookup without any subscript, if arrays are compiled into the shell. */
 char *
@@ -2257,7 +2390,7 @@ bind_variable_internal (name, value, table, hflags, aflags)
     VSETATTR (entry, att_exported);
 
   if (exported_p (entry))
-    array_needs_making = 1;
+    update_export_variable (entry);
 
   return (entry);
 }
@@ -2336,7 +2469,7 @@ bind_variable_value (var, value, aflags)
     VSETATTR (var, att_exported);
 
   if (exported_p (var))
-    array_needs_making = 1;
+    update_export_variable (var);
 
   return (var);
 }
@@ -2408,7 +2541,7 @@ bind_function (name, value)
 {
   SHELL_VAR *entry;
 
-  entry = find_function (name);
+  entry = find_function_noload (name);
   if (entry == 0)
     {
       BUCKET_CONTENTS *elt;
@@ -2420,6 +2553,12 @@ bind_function (name, value)
   else
     INVALIDATE_EXPORTSTR (entry);
 
+  if (autoload_p (entry))
+    {
+      unbind_function_autoload (name);
+      VUNSETATTR (entry, att_autoload);
+    }
+
   if (var_isset (entry))
     dispose_command (function_cell (entry));
 
@@ -2476,6 +2615,88 @@ bind_function_def (name, value)
 }
 #endif /* DEBUGGER */
 
+/* Make NAME an autoloaded function, whose definition is read from LENGTH
+   bytes of FILENAME starting at byte OFFSET the first time it is needed.
+   A LENGTH of -1 means to read the rest of the file.  If NAME is already
+   a function with a definition, it is left alone.  Returns the entry. */
+SHELL_VAR *
+bind_function_autoload (name, filename, offset, length)
+     const char *name, *filename;
+     intmax_t offset, length;
+{
+  SHELL_VAR *entry;
+  AUTOLOAD_DEF *def;
+  BUCKET_CONTENTS *elt;
+
+  entry = find_function_noload (name);
+  if (entry && autoload_p (entry) == 0)
+    return (entry);
+
+  if (entry == 0)
+    {
+      elt = hash_insert (savestring (name), shell_functions, HASH_NOSRCH);
+      entry = new_shell_variable (name);
+      elt->data = (PTR_T)entry;
+      VSETATTR (entry, (att_function|att_autoload));
+#if defined (PROGRAMMABLE_COMPLETION)
+      set_itemlist_dirty (&it_functions);
+#endif
+    }
+
+  if (shell_function_autoloads == 0)
+    shell_function_autoloads = hash_create (0);
+
+  def = find_function_autoload (name);
+  if (def)
+    free (def->file_name);
+  else
+    {
+      def = (AUTOLOAD_DEF *)xmalloc (sizeof (AUTOLOAD_DEF));
+      elt = hash_insert (savestring (name), shell_function_autoloads, HASH_NOSRCH);
+      elt->data = (PTR_T)def;
+    }
+
+  def->file_name = savestring (filename);
+  def->offset = offset;
+  def->length = length;
+
+  return (entry);
+}
+
+/* Read and execute the definition of VAR, an autoloaded function.  The
+   text read may contain only function definitions.  Returns the entry
+   for the function, or NULL after printing an error message if the
+   definition could not be read or did not define the function.  The
+   function stays autoloaded in that case, so a later use tries again. */
+SHELL_VAR *
+autoload_function (var)
+     SHELL_VAR *var;
+{
+  AUTOLOAD_DEF *def;
+  char *name, *filename;
+  int r;
+
+  def = find_function_autoload (var->name);
+  if (def == 0)
+    return ((SHELL_VAR *)NULL);
+
+  /* Binding the function discards DEF and may replace VAR, so save what
+     we need afterward first. */
+  name = savestring (var->name);
+  filename = savestring (def->file_name);
+
+  r = autoload_file (filename, name, def->offset, def->length);
+
+  var = find_function_noload (name);
+  if (r >= 0 && (var == 0 || autoload_p (var)))
+    internal_error (_("%s: function not defined by %s"), name, filename);
+
+  free (name);
+  free (filename);
+
+  return ((var && autoload_p (var) == 0) ? var : (SHELL_VAR *)NULL);
+}
+
 /* Add STRING, which is of the form foo=bar, to the temporary environment
    HASH_TABLE (temporary_env).  The functions in execute_cmd.c are
    responsible for moving the main temporary env to one of the other
@@ -2670,6 +2891,8 @@ unbind_func (name)
     {
       if (exported_p (func))
 	array_needs_making++;
+      if (autoload_p (func))
+	unbind_function_autoload (name);
       dispose_variable (func);
     }
 
@@ -2679,6 +2902,25 @@ unbind_func (name)
   return 0;  
 }
 
+/* Forget where to find the definition of the autoloaded function NAME. */
+static void
+unbind_function_autoload (name)
+     const char *name;
+{
+  BUCKET_CONTENTS *elt;
+  AUTOLOAD_DEF *def;
+
+  elt = shell_function_autoloads ? hash_remove (name, shell_function_autoloads, 0) : 0;
+  if (elt == 0)
+    return;
+
+  def = (AUTOLOAD_DEF *)elt->data;
+  free (def->file_name);
+  free (def);
+  free (elt->key);
+  free (elt);
+}
+
 #if defined (DEBUGGER)
 int
 unbind_function_def (name)
@@ -3327,6 +3569,7 @@ dispose_temporary_env (pushf)
   array_needs_making = 1;
 
   sv_ifs ("IFS");		/* XXX here for now */
+  sv_vyatta_env ((char *)NULL);	/* values may have been propagated */
 }
 
 void
@@ -3567,24 +3810,102 @@ add_or_supercede_exported_var (assign, do_alloc)
 
   /* If this is a function, then only supersede the function definition.
      We do this by including the `=() {' in the comparison, like
-     initialize_shell_variables does. */
+     initialize_shell_variables does.  The name index can't tell a
+     function from a variable with the same name, so search the array
+     and throw the index away. */
   if (assign[equal_offset + 1] == '(' &&
      strncmp (assign + equal_offset + 2, ") {", 3) == 0)		/* } */
-    equal_offset += 4;
-
-  for (i = 0; i < export_env_index; i++)
     {
-      if (STREQN (assign, export_env[i], equal_offset + 1))
+      equal_offset += 4;
+      discard_export_env_index ();
+
+      for (i = 0; i < export_env_index; i++)
 	{
-	  free (export_env[i]);
-	  export_env[i] = do_alloc ? savestring (assign) : assign;
-	  return (export_env);
+	  if (STREQN (assign, export_env[i], equal_offset + 1))
+	    {
+	      free (export_env[i]);
+	      export_env[i] = do_alloc ? savestring (assign) : assign;
+	      return (export_env);
+	    }
 	}
+      add_to_export_env (assign, do_alloc);
+      return (export_env);
+    }
+
+  assign[equal_offset] = '\0';
+  i = export_env_slot (assign);
+  if (i < 0)
+    add_export_env_slot (assign, export_env_index);
+  assign[equal_offset] = '=';
+
+  if (i >= 0)
+    {
+      free (export_env[i]);
+      export_env[i] = do_alloc ? savestring (assign) : assign;
     }
-  add_to_export_env (assign, do_alloc);
+  else
+    add_to_export_env (assign, do_alloc);
   return (export_env);
 }
 
+/* Build EXPORT_ENV_SLOTS from the current contents of EXPORT_ENV.  If a
+   name appears more than once, the first entry is the one superseded, as
+   it was when add_or_supercede_exported_var searched the array. */
+static void
+index_export_env ()
+{
+  register int i;
+  char *s;
+
+  export_env_slots = hash_create (export_env_size);
+  for (i = 0; i < export_env_index; i++)
+    {
+      s = strchr (export_env[i], '=');
+      if (s == 0)
+	continue;
+      *s = '\0';
+      if (hash_search (export_env[i], export_env_slots, 0) == 0)
+	add_export_env_slot (export_env[i], i);
+      *s = '=';
+    }
+}
+
+static void
+discard_export_env_index ()
+{
+  if (export_env_slots)
+    {
+      hash_flush (export_env_slots, 0);
+      hash_dispose (export_env_slots);
+      export_env_slots = (HASH_TABLE *)NULL;
+    }
+}
+
+/* Return the index of NAME's entry in EXPORT_ENV, or -1 if it has none. */
+static int
+export_env_slot (name)
+     char *name;
+{
+  BUCKET_CONTENTS *item;
+
+  if (export_env_slots == 0)
+    index_export_env ();
+  item = hash_search (name, export_env_slots, 0);
+  return (item ? *(int *)item->data : -1);
+}
+
+static void
+add_export_env_slot (name, ind)
+     char *name;
+     int ind;
+{
+  BUCKET_CONTENTS *item;
+
+  item = hash_insert (savestring (name), export_env_slots, HASH_NOSRCH);
+  item->data = xmalloc (sizeof (int));
+  *(int *)item->data = ind;
+}
+
 static void
 add_temp_array_to_env (temp_array, do_alloc, do_supercede)
      char **temp_array;
@@ -3644,6 +3965,8 @@ maybe_make_export_env ()
     {
       if (export_env)
 	strvec_flush (export_env);
+      discard_export_env_index ();
+      export_env_rebuilds++;
 
       /* Make a guess based on how many shell variables and functions we
 	 have.  Since there will always be array variables, and array
@@ -3692,6 +4015,48 @@ maybe_make_export_env ()
     }
 }
 
+/* Called when the value or export attribute of the exported variable VAR
+   changes.  If EXPORT_ENV is otherwise up to date and VAR is the variable
+   maybe_make_export_env would export under its name, replace or add VAR's
+   entry in place.  Anything else -- a temporary environment that shadows
+   VAR, a variable with no value, functions -- makes the environment be
+   remade from scratch before the next command runs. */
+void
+update_export_variable (var)
+     SHELL_VAR *var;
+{
+  char *value, *evar;
+
+  if (array_needs_making || export_env == 0 || temporary_env)
+    {
+      array_needs_making = 1;
+      return;
+    }
+
+  value = value_cell (var);
+  if (exported_p (var) == 0 || invisible_p (var) || tempvar_p (var) ||
+      function_p (var) || array_p (var) || assoc_p (var) || value == 0 ||
+      var_lookup (var->name, shell_variables) != var)
+    {
+      array_needs_making = 1;
+      return;
+    }
+
+#if defined (__CYGWIN__)
+  /* We don't use the exportstr stuff on Cygwin at all. */
+  INVALIDATE_EXPORTSTR (var);
+#endif
+  if (var->exportstr)
+    export_env = add_or_supercede_exported_var (var->exportstr, 1);
+  else
+    {
+      evar = mk_env_string (var->name, value, 0);
+      SAVE_EXPORTSTR (var, evar);
+      export_env = add_or_supercede_exported_var (evar, 0);
+    }
+  export_env_updates++;
+}
+
 /* This is an efficiency hack.  PWD and OLDPWD are auto-exported, so
    we will need to remake the exported environment every time we
    change directories.  `_' is always put into the environment for
@@ -4191,6 +4556,11 @@ static struct name_and_function special_vars[] = {
   { "TZ", sv_tz },
 #endif
 
+  { "VYATTA_ENABLE_SHELL_EXPANSION", sv_vyatta_env },
+  { "VYATTA_RESTRICTED_MODE", sv_vyatta_env },
+
+  { "_OFR_CONFIGURE", sv_vyatta_env },
+
 #if defined (HISTORY) && defined (BANG_HISTORY)
   { "histchars", sv_histchars },
 #endif /* HISTORY && BANG_HISTORY */
@@ -4427,7 +4797,7 @@ sv_histsize (name)
 	    }
 	  else
 	    {
-	      history_truncate_file (get_string_value ("HISTFILE"), hmax);
+	      maybe_truncate_history_file (get_string_value ("HISTFILE"), hmax);
 	      if (hmax <= history_lines_in_file)
 		history_lines_in_file = hmax;
 	    }
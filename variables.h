@@ -93,6 +93,14 @@ typedef struct variable {
   int context;			/* Which context this variable belongs to. */
 } SHELL_VAR;
 
+/* Where to find the definition of an autoloaded shell function that has
+   not been read yet. */
+typedef struct _autoload_def {
+  char *file_name;		/* absolute pathname of the file to read */
+  intmax_t offset;		/* byte offset of the definition in the file */
+  intmax_t length;		/* bytes to read, or -1 for the rest of the file */
+} AUTOLOAD_DEF;
+
 typedef struct _vlist {
   SHELL_VAR **list;
   int list_size;	/* allocated size */
@@ -124,6 +132,7 @@ typedef struct _vlist {
 #define att_imported	0x0008000	/* came from environment */
 #define att_special	0x0010000	/* requires special handling */
 #define att_nofree	0x0020000	/* do not free value on unset */
+#define att_autoload	0x0040000	/* function definition not yet read */
 
 #define	attmask_int	0x00ff000
 
@@ -151,6 +160,7 @@ typedef struct _vlist {
 #define imported_p(var)		((((var)->attributes) & (att_imported)))
 #define specialvar_p(var)	((((var)->attributes) & (att_special)))
 #define nofree_p(var)		((((var)->attributes) & (att_nofree)))
+#define autoload_p(var)		((((var)->attributes) & (att_autoload)))
 
 #define tempvar_p(var)		((((var)->attributes) & (att_tempvar)))
 
@@ -231,7 +241,9 @@ extern void make_funcname_visible __P((int));
 extern SHELL_VAR *var_lookup __P((const char *, VAR_CONTEXT *));
 
 extern SHELL_VAR *find_function __P((const char *));
+extern SHELL_VAR *find_function_noload __P((const char *));
 extern FUNCTION_DEF *find_function_def __P((const char *));
+extern AUTOLOAD_DEF *find_function_autoload __P((const char *));
 extern SHELL_VAR *find_variable __P((const char *));
 extern SHELL_VAR *find_variable_internal __P((const char *, int));
 extern SHELL_VAR *find_tempenv_variable __P((const char *));
@@ -241,6 +253,8 @@ extern SHELL_VAR *bind_variable __P((const char *, char *, int));
 extern SHELL_VAR *bind_function __P((const char *, COMMAND *));
 
 extern void bind_function_def __P((const char *, FUNCTION_DEF *));
+extern SHELL_VAR *bind_function_autoload __P((const char *, const char *, intmax_t, intmax_t));
+extern SHELL_VAR *autoload_function __P((SHELL_VAR *));
 
 extern SHELL_VAR **map_over __P((sh_var_map_func_t *, VAR_CONTEXT *));
 SHELL_VAR **map_over_funcs __P((sh_var_map_func_t *));
@@ -314,6 +328,7 @@ extern void sort_variables __P((SHELL_VAR **));
 
 extern void maybe_make_export_env __P((void));
 extern void update_export_env_inplace __P((char *, int, char *));
+extern void update_export_variable __P((SHELL_VAR *));
 extern void put_command_name_into_env __P((char *));
 extern void put_gnu_argv_flags_into_env __P((intmax_t, char *));
 
@@ -19,9 +19,19 @@
    This code was originally developed by Vyatta, Inc.
    Portions created by Vyatta are Copyright (C) 2007 Vyatta, Inc. */
 
+#include "config.h"
+
 #include <unistd.h>
 
+#include "bashtypes.h"
+#include "posixstat.h"
+#include "posixtime.h"
+#include "filecntl.h"
+#include "maxpath.h"
+#include <errno.h>
+
 #include "shell.h"
+#include "hashlib.h"
 #include "bashhist.h"
 #include "vyatta-restricted.h"
 
@@ -32,11 +42,14 @@
 
 static char *prev_cmdline = NULL;
 
-/* allowed commands lists */
-static char **allowed_op_cmds = NULL;
-static char **allowed_cfg_cmds = NULL;
-static char **allowed_pipe_cmds = NULL;
-static int *pipe_cmd_args = NULL;
+/* allowed commands tables, keyed by command name */
+static HASH_TABLE *allowed_op_cmds = NULL;
+static HASH_TABLE *allowed_cfg_cmds = NULL;
+/* pipe command data is a bitmap of the allowed number of words */
+static HASH_TABLE *allowed_pipe_cmds = NULL;
+
+#define PIPE_ARGS_MAX 256
+#define PIPE_ARGS_MAPSIZE ((PIPE_ARGS_MAX / 8) + 1)
 
 static char *vyatta_user_level_dir = NULL;
 
@@ -50,14 +63,57 @@ static char *expand_disable_cmds[] = { "_vyatta_op_run",
                                        "/opt/vyatta/sbin/my_commit",
                                        NULL };
 
+/* values of the environment variables that control restricted mode.
+   they are looked up again only after sv_vyatta_env() reports a change,
+   or while a temporary environment may be overriding them. */
+enum vyatta_env_mode { MODE_DEFAULT, MODE_NONE, MODE_OUTPUT, MODE_FULL };
+
+static int vyatta_env_valid = 0;
+static enum vyatta_env_mode vyatta_env_restricted_mode = MODE_DEFAULT;
+static int vyatta_env_in_cfg = 0;
+static int vyatta_env_expansion_disabled = 1;
+
+static void
+update_vyatta_env()
+{
+  char *val;
+
+  if (vyatta_env_valid && !temporary_env) {
+    return;
+  }
+
+  val = getenv("VYATTA_RESTRICTED_MODE");
+  if (!val) {
+    vyatta_env_restricted_mode = MODE_DEFAULT;
+  } else if (strcmp(val, "output") == 0) {
+    vyatta_env_restricted_mode = MODE_OUTPUT;
+  } else if (strcmp(val, "full") == 0) {
+    vyatta_env_restricted_mode = MODE_FULL;
+  } else {
+    vyatta_env_restricted_mode = MODE_NONE;
+  }
+
+  val = getenv("_OFR_CONFIGURE");
+  vyatta_env_in_cfg = (val) ? (strcmp(val, "ok") == 0) : 0;
+
+  vyatta_env_expansion_disabled = !getenv("VYATTA_ENABLE_SHELL_EXPANSION");
+
+  vyatta_env_valid = !temporary_env;
+}
+
+/* called through the special variable table when one of the variables
+   above is assigned, unset, or has its export attribute changed. */
+void
+sv_vyatta_env(char *name)
+{
+  vyatta_env_valid = 0;
+}
+
 static int
 is_expansion_disabled()
 {
-  char *exp = getenv("VYATTA_ENABLE_SHELL_EXPANSION");
-  if (!exp) {
-    return 1;
-  }
-  return 0;
+  update_vyatta_env();
+  return vyatta_env_expansion_disabled;
 }
 
 void
@@ -88,19 +144,24 @@ static int
 is_vyatta_restricted_pipe_command(WORD_LIST *words)
 {
   WORD_LIST *w = words;
+  BUCKET_CONTENTS *item;
+  unsigned char *argmap;
   int count = 1;
   while (w = w->next) {
     count++;
   }
   if (words) {
-    int i = 0;
     if (!allowed_pipe_cmds) {
       /* no restriction */
       return 1;
     }
-    for (i = 0; allowed_pipe_cmds[i]; i++) {
-      if (strcmp(words->word->word, allowed_pipe_cmds[i]) == 0
-          && count == pipe_cmd_args[i]) {
+    if (count > PIPE_ARGS_MAX) {
+      return 0;
+    }
+    item = hash_search(words->word->word, allowed_pipe_cmds, 0);
+    if (item) {
+      argmap = (unsigned char *) item->data;
+      if (argmap[count / 8] & (1 << (count % 8))) {
         return 1;
       }
     }
@@ -259,7 +320,7 @@ is_vyatta_cfg_command(const char *cmd)
     /* no restriction */
     return 1;
   }
-  return is_in_command_list(cmd, allowed_cfg_cmds);
+  return (hash_search(cmd, allowed_cfg_cmds, 0) != NULL);
 }
 
 static int
@@ -269,19 +330,21 @@ is_vyatta_op_command(const char *cmd)
     /* no restriction */
     return 1;
   }
-  return is_in_command_list(cmd, allowed_op_cmds);
+  return (hash_search(cmd, allowed_op_cmds, 0) != NULL);
 }
 
 int
 is_vyatta_command(char *cmdline, COMMAND *cmd)
 {
-  char *cfg = getenv("_OFR_CONFIGURE");
-  int in_cfg = (cfg) ? (strcmp(cfg, "ok") == 0) : 0;
+  int in_cfg = 0;
   char *start = cmdline;
   char *end = NULL;
   char save = 0;
   int ret = 0;
 
+  update_vyatta_env();
+  in_cfg = vyatta_env_in_cfg;
+
   /* check expansions (full) */
   vyatta_check_expansion(cmd, 1);
 
@@ -327,59 +390,96 @@ is_vyatta_command(char *cmdline, COMMAND *cmd)
   return ret;
 }
 
-static FILE *
-fopen_level_file(char *file_name)
+/* Read FILE_NAME from the level directory with a single read.  The
+   returned buffer is the arena for everything loaded from the file: each
+   line is cut at its first blank or non-printable character, so the
+   entries can be used in place.  *NLINES gets the number of lines. */
+static char *
+read_level_file(char *file_name, int *nlines)
 {
-  FILE *f = NULL;
-#define BUF_SIZE 1024
-  char *buf = (char *) xmalloc(BUF_SIZE);
-  if (!buf) {
+  char path[PATH_MAX];
+  struct stat st;
+  char *buf, *p;
+  size_t size = 0;
+  ssize_t n;
+  int fd;
+
+  *nlines = 0;
+  if (snprintf(path, sizeof(path), "%s/%s", vyatta_user_level_dir,
+               file_name) >= sizeof(path)) {
+    return NULL;
+  }
+  if ((fd = open(path, O_RDONLY)) < 0) {
+    return NULL;
+  }
+  if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
     return NULL;
   }
 
-  do {
-    int r = snprintf(buf, BUF_SIZE, "%s/%s", vyatta_user_level_dir, file_name);
-    if (r >= BUF_SIZE) {
+  buf = (char *) xmalloc(st.st_size + 1);
+  while (size < st.st_size) {
+    n = read(fd, buf + size, st.st_size - size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
       break;
     }
+    size += n;
+  }
+  close(fd);
+  buf[size] = 0;
 
-    f = fopen(buf, "r");
-  } while (0);
-
-  free(buf);
-  return f;
+  for (p = buf; p < buf + size; p++) {
+    if (*p == '\n') {
+      (*nlines)++;
+    }
+  }
+  if (size && buf[size - 1] != '\n') {
+    (*nlines)++;
+  }
+  return buf;
 }
 
+/* Return the entry at *POS in a buffer from read_level_file() and advance
+   *POS to the next line, or return NULL at END. */
 static char *
-fgets_level_file(char *buf, int size, FILE *lfile)
+next_level_entry(char **pos, char *end)
 {
-  if (fgets(buf, size, lfile)) {
-    int end = 0;
-    while (buf[end] && isprint(buf[end]) && !isspace(buf[end])) {
-      end++;
-    }
-    buf[end] = 0;
-    return buf;
-  } else {
+  char *entry = *pos;
+  char *eol, *c;
+
+  if (entry >= end) {
     return NULL;
   }
+  if (!(eol = memchr(entry, '\n', end - entry))) {
+    eol = end;
+  }
+  for (c = entry; c < eol && isprint(*c) && !isspace(*c); c++) {
+    ;
+  }
+  *c = 0;
+  *pos = eol + 1;
+  return entry;
 }
 
 static void
 set_default_mode()
 {
-  FILE *lfile = NULL;
-  char *line = NULL;
-  char buf[256];
+  char *buf, *pos, *end, *line;
+  int count = 0;
 
   /* default to full restricted */
   vyatta_default_output_restricted = 0;
   vyatta_default_full_restricted = 1;
 
-  if (!(lfile = fopen_level_file(FILENAME_MODE))) {
+  if (!(buf = read_level_file(FILENAME_MODE, &count))) {
     return;
   }
-  while (line = fgets_level_file(buf, 256, lfile)) {
+  pos = buf;
+  end = buf + strlen(buf);
+  while (line = next_level_entry(&pos, end)) {
     if (strcmp(line, "output") == 0) {
       vyatta_default_output_restricted = 1;
       vyatta_default_full_restricted = 0;
@@ -391,142 +491,121 @@ set_default_mode()
       break;
     }
   }
-  fclose(lfile);
+  free(buf);
   return;
 }
 
-static void
-set_allowed_op_cmds()
+/* hash table size for COUNT entries: a power of two with a load factor
+   of at most one, so lookups do not have to walk long chains. */
+static int
+level_table_size(int count)
 {
-  FILE *lfile = NULL;
-  char *line = NULL;
-  char buf[256];
-  int count = 1;
-
-  if (allowed_op_cmds) {
-    return;
+  int size = DEFAULT_HASH_BUCKETS;
+  while (size < count) {
+    size <<= 1;
   }
+  return size;
+}
 
-  if (!(lfile = fopen_level_file(FILENAME_OP))) {
-    return;
-  }
-  while (line = fgets_level_file(buf, 256, lfile)) {
-    count++;
+/* The table keys point into the level file buffer, which is never freed,
+   so these tables must not be flushed. */
+static HASH_TABLE *
+load_allowed_cmds(char *file_name)
+{
+  HASH_TABLE *table = NULL;
+  char *buf, *pos, *end, *line;
+  int count = 0;
+
+  if (!(buf = read_level_file(file_name, &count))) {
+    return NULL;
   }
-  fclose(lfile);
+  table = hash_create(level_table_size(count));
 
-  /* count is 1 more than number of lines */
-  allowed_op_cmds = (char **) xmalloc(sizeof(char *) * count);
-  memset(allowed_op_cmds, 0, sizeof(char *) * count);
+  pos = buf;
+  end = buf + strlen(buf);
+  while (line = next_level_entry(&pos, end)) {
+    if (!hash_search(line, table, 0)) {
+      hash_insert(line, table, HASH_NOSRCH);
+    }
+  }
+  return table;
+}
 
-  if (!(lfile = fopen_level_file(FILENAME_OP))) {
+static void
+set_allowed_op_cmds()
+{
+  if (allowed_op_cmds) {
     return;
   }
-  count = 0;
-  while (line = fgets_level_file(buf, 256, lfile)) {
-    allowed_op_cmds[count] = strdup(line);
-    count++;
-  }
-  fclose(lfile);
-  return;
+  allowed_op_cmds = load_allowed_cmds(FILENAME_OP);
 }
 
 static void
 set_allowed_cfg_cmds()
 {
-  FILE *lfile = NULL;
-  char *line = NULL;
-  char buf[256];
-  int count = 1;
-
   if (allowed_cfg_cmds) {
     return;
   }
-
-  if (!(lfile = fopen_level_file(FILENAME_CFG))) {
-    return;
-  }
-  while (line = fgets_level_file(buf, 256, lfile)) {
-    count++;
-  }
-  fclose(lfile);
-
-  /* count is 1 more than number of lines */
-  allowed_cfg_cmds = (char **) xmalloc(sizeof(char *) * count);
-  memset(allowed_cfg_cmds, 0, sizeof(char *) * count);
-
-  if (!(lfile = fopen_level_file(FILENAME_CFG))) {
-    return;
-  }
-  count = 0;
-  while (line = fgets_level_file(buf, 256, lfile)) {
-    allowed_cfg_cmds[count] = strdup(line);
-    count++;
-  }
-  fclose(lfile);
-  return;
+  allowed_cfg_cmds = load_allowed_cmds(FILENAME_CFG);
 }
 
 static void
 set_allowed_pipe_cmds()
 {
-  FILE *lfile = NULL;
-  char *line = NULL;
-  char buf[256];
+  BUCKET_CONTENTS *item;
+  unsigned char *argmaps;
+  char *buf, *pos, *end, *line;
   int count = 0;
+  int args = 0;
 
   if (allowed_pipe_cmds) {
     return;
   }
 
-  if (!(lfile = fopen_level_file(FILENAME_PIPE))) {
-    return;
-  }
-  while (line = fgets_level_file(buf, 256, lfile)) {
-    count++;
-  }
-  fclose(lfile);
-
-  count = (count / 2) + 2;
-  /* count is 1 more than entries */
-  allowed_pipe_cmds = (char **) xmalloc(sizeof(char *) * count);
-  memset(allowed_pipe_cmds, 0, sizeof(char *) * count);
-  pipe_cmd_args = (int *) xmalloc(sizeof(int *) * count);
-  memset(pipe_cmd_args, 0, sizeof(int *) * count);
-
-  if (!(lfile = fopen_level_file(FILENAME_PIPE))) {
+  if (!(buf = read_level_file(FILENAME_PIPE, &count))) {
     return;
   }
-  count = 0;
-  while (line = fgets_level_file(buf, 256, lfile)) {
-    allowed_pipe_cmds[count] = strdup(line);
-    if (!(line = fgets_level_file(buf, 256, lfile))) {
-      free(allowed_pipe_cmds[count]);
-      allowed_pipe_cmds[count] = NULL;
+  /* entries are pairs of lines: command name, then number of words */
+  count = (count / 2) + 1;
+  allowed_pipe_cmds = hash_create(level_table_size(count));
+  argmaps = (unsigned char *) xmalloc(count * PIPE_ARGS_MAPSIZE);
+  memset(argmaps, 0, count * PIPE_ARGS_MAPSIZE);
+
+  pos = buf;
+  end = buf + strlen(buf);
+  while (line = next_level_entry(&pos, end)) {
+    item = hash_search(line, allowed_pipe_cmds, 0);
+    if (!item) {
+      item = hash_insert(line, allowed_pipe_cmds, HASH_NOSRCH);
+      item->data = argmaps;
+      argmaps += PIPE_ARGS_MAPSIZE;
+    }
+    if (!(line = next_level_entry(&pos, end))) {
       break;
     }
-    pipe_cmd_args[count] = atoi(line);
+    args = atoi(line);
     /* limit to between 1 and 256 */
-    if (pipe_cmd_args[count] < 1 || pipe_cmd_args[count] > 256) {
-      free(allowed_pipe_cmds[count]);
-      allowed_pipe_cmds[count] = NULL;
-      pipe_cmd_args[count] = 0;
+    if (args < 1 || args > PIPE_ARGS_MAX) {
       break;
     }
-    count++;
+    ((unsigned char *) item->data)[args / 8] |= (1 << (args % 8));
   }
-  fclose(lfile);
   return;
 }
 
 static int
 init_vyatta_restricted_mode()
 {
+  struct timeval before, after;
+  char usec[INT_STRLEN_BOUND(intmax_t) + 1];
+
   if (!(vyatta_user_level_dir = getenv("VYATTA_USER_LEVEL_DIR"))) {
     /* level dir not set, return failure */
     return 0;
   }
 
+  gettimeofday(&before, NULL);
+
   /* set the default restricted mode based on level */
   set_default_mode();
 
@@ -535,13 +614,19 @@ init_vyatta_restricted_mode()
   set_allowed_cfg_cmds();
   set_allowed_pipe_cmds();
 
+  /* record how long loading the level files took, in microseconds */
+  gettimeofday(&after, NULL);
+  bind_variable("VYATTA_LEVEL_LOAD_TIME",
+                inttostr((after.tv_sec - before.tv_sec) * 1000000L
+                         + (after.tv_usec - before.tv_usec),
+                         usec, sizeof(usec)), 0);
+
   return 1;
 }
 
 int
 in_vyatta_restricted_mode(enum vyatta_restricted_type type)
 {
-  char *rval = getenv("VYATTA_RESTRICTED_MODE");
   int output = 0;
   int full = 0;
 
@@ -554,9 +639,10 @@ in_vyatta_restricted_mode(enum vyatta_restricted_type type)
   full = vyatta_default_full_restricted;
   
   /* environment var overrides default */
-  if (rval) {
-    output = (strcmp(rval, "output") == 0);
-    full = (strcmp(rval, "full") == 0);
+  update_vyatta_env();
+  if (vyatta_env_restricted_mode != MODE_DEFAULT) {
+    output = (vyatta_env_restricted_mode == MODE_OUTPUT);
+    full = (vyatta_env_restricted_mode == MODE_FULL);
   }
 
   if (type == OUTPUT && (output || full)) {
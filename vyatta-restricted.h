@@ -31,6 +31,7 @@ extern int in_vyatta_restricted_mode __P((enum vyatta_restricted_type));
 extern int is_vyatta_command __P((char *, COMMAND *));
 extern void vyatta_check_expansion __P((COMMAND *, int));
 extern void vyatta_reset_hist_expansion();
+extern void sv_vyatta_env __P((char *));
 
 #endif /* _VYATTA_RESTRICTED_H_ */
 